@@ -25,6 +25,10 @@ UTILS_PATH = $(VESC_C_LIB_PATH)/utils/
 
 SOURCES += $(UTILS_PATH)/rb.c
 SOURCES += $(UTILS_PATH)/utils.c
+SOURCES += $(UTILS_PATH)/biquad.c
+SOURCES += $(UTILS_PATH)/fast_math.c
+SOURCES += $(UTILS_PATH)/kalman_pitch.c
+SOURCES += $(UTILS_PATH)/footpad_filter.c
 
 OBJECTS = $(SOURCES:.c=.so)
 
@@ -0,0 +1,112 @@
+/*
+	Copyright 2022 Benjamin Vedder	benjamin@vedder.se
+	Copyright 2024 Lukas Hrazky
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+
+#include "biquad.h"
+
+#include <math.h>
+
+void biquad_configure(Biquad *biquad, BiquadType type, float frequency) {
+	biquad_configure_q(biquad, type, frequency, 0.707, 0.0);
+}
+
+void biquad_configure_q(Biquad *biquad, BiquadType type, float frequency, float q, float gain_db) {
+	float K = tanf(M_PI * frequency);
+	float KK = K * K;
+	float norm = 1 / (1 + K / q + KK);
+
+	switch (type) {
+	case BQ_LOWPASS:
+		biquad->a0 = KK * norm;
+		biquad->a1 = 2 * biquad->a0;
+		biquad->a2 = biquad->a0;
+		break;
+	case BQ_HIGHPASS:
+		biquad->a0 = 1 * norm;
+		biquad->a1 = -2 * biquad->a0;
+		biquad->a2 = biquad->a0;
+		break;
+	case BQ_BANDPASS:
+		biquad->a0 = K / q * norm;
+		biquad->a1 = 0;
+		biquad->a2 = -biquad->a0;
+		break;
+	case BQ_NOTCH:
+		biquad->a0 = (1 + KK) * norm;
+		biquad->a1 = 2 * (KK - 1) * norm;
+		biquad->a2 = biquad->a0;
+		break;
+	case BQ_PEAKING: {
+		float V = powf(10, fabsf(gain_db) / 20);
+		if (gain_db >= 0) {
+			biquad->a0 = (1 + V * K / q + KK) * norm;
+			biquad->a1 = 2 * (KK - 1) * norm;
+			biquad->a2 = (1 - V * K / q + KK) * norm;
+		} else {
+			// A cut is the inverse of a boost, the poles and zeros swap
+			norm = 1 / (1 + V * K / q + KK);
+			biquad->a0 = (1 + K / q + KK) * norm;
+			biquad->a1 = 2 * (KK - 1) * norm;
+			biquad->a2 = (1 - K / q + KK) * norm;
+			biquad->b1 = biquad->a1;
+			biquad->b2 = (1 - V * K / q + KK) * norm;
+			return;
+		}
+		break;
+	}
+	}
+
+	biquad->b1 = 2 * (KK - 1) * norm;
+	biquad->b2 = (1 - K / q + KK) * norm;
+}
+
+void biquad_reset(Biquad *biquad) {
+	biquad->z1 = 0;
+	biquad->z2 = 0;
+}
+
+void biquad_cascade_clear(BiquadCascade *cascade) {
+	cascade->count = 0;
+}
+
+bool biquad_cascade_add(BiquadCascade *cascade, BiquadType type, float frequency, float q,
+		float gain_db) {
+	if (cascade->count >= BIQUAD_CASCADE_MAX || !(frequency > 0 && frequency < 0.5)) {
+		return false;
+	}
+
+	Biquad *stage = &cascade->stages[cascade->count++];
+	biquad_configure_q(stage, type, frequency, q, gain_db);
+	biquad_reset(stage);
+	return true;
+}
+
+float biquad_cascade_process(BiquadCascade *cascade, float in) {
+	for (int i = 0; i < cascade->count; i++) {
+		in = biquad_process(&cascade->stages[i], in);
+	}
+	return in;
+}
+
+void biquad_cascade_reset(BiquadCascade *cascade) {
+	for (int i = 0; i < cascade->count; i++) {
+		biquad_reset(&cascade->stages[i]);
+	}
+}
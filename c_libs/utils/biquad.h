@@ -0,0 +1,83 @@
+/*
+	Copyright 2022 Benjamin Vedder	benjamin@vedder.se
+	Copyright 2024 Lukas Hrazky
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+
+#ifndef BIQUAD_H_
+#define BIQUAD_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Second order IIR sections (biquads) in transposed direct form II, with the
+ * RBJ cookbook designs through the bilinear transform. Frequencies are
+ * normalized to the sample rate (f / fs) and have to be below 0.5.
+ *
+ * a0..a2 are the feed-forward and b1, b2 the feedback coefficients:
+ * y = a0 * x + a1 * x[-1] + a2 * x[-2] - b1 * y[-1] - b2 * y[-2]
+ */
+
+typedef struct {
+	float a0, a1, a2, b1, b2;
+	float z1, z2;
+} Biquad;
+
+typedef enum {
+	BQ_LOWPASS,
+	BQ_HIGHPASS,
+	BQ_BANDPASS,  // Unity gain at the center frequency
+	BQ_NOTCH,
+	BQ_PEAKING
+} BiquadType;
+
+#define BIQUAD_CASCADE_MAX	4
+
+// Sections processed in series
+typedef struct {
+	Biquad stages[BIQUAD_CASCADE_MAX];
+	uint8_t count;
+} BiquadCascade;
+
+static inline float biquad_process(Biquad *biquad, float in) {
+	float out = in * biquad->a0 + biquad->z1;
+	biquad->z1 = in * biquad->a1 + biquad->z2 - biquad->b1 * out;
+	biquad->z2 = in * biquad->a2 - biquad->b2 * out;
+	return out;
+}
+
+// Q of 0.707 (Butterworth), the peaking gain is 0 dB
+void biquad_configure(Biquad *biquad, BiquadType type, float frequency);
+
+// gain_db is only used by BQ_PEAKING
+void biquad_configure_q(Biquad *biquad, BiquadType type, float frequency, float q, float gain_db);
+
+void biquad_reset(Biquad *biquad);
+
+void biquad_cascade_clear(BiquadCascade *cascade);
+
+// Returns false if the cascade is full or the frequency is not in (0, 0.5)
+bool biquad_cascade_add(BiquadCascade *cascade, BiquadType type, float frequency, float q,
+		float gain_db);
+
+float biquad_cascade_process(BiquadCascade *cascade, float in);
+
+void biquad_cascade_reset(BiquadCascade *cascade);
+
+#endif  /* BIQUAD_H_ */
@@ -0,0 +1,155 @@
+/*
+	Copyright 2024 Lukas Hrazky
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+#include "fast_math.h"
+
+#include <math.h>
+#include <string.h>
+
+// The polynomials are the single precision minimax fits from the Cephes
+// library (Stephen L. Moshier), evaluated without any division.
+
+#define PI_F		3.14159265358979f
+#define PI_2_F		1.57079632679490f
+#define PI_4_F		0.78539816339745f
+#define TAN_PI_8_F	0.41421356237310f
+#define TAN_3PI_8_F	2.41421356237310f
+
+// asin on [-0.5, 0.5]
+static inline float asin_kernel(float x) {
+	float z = x * x;
+	return ((((4.2163199048e-2f * z + 2.4181311049e-2f) * z + 4.5470025998e-2f) * z +
+			7.4953002686e-2f) * z + 1.6666752422e-1f) * z * x + x;
+}
+
+// atan on [-tan(pi / 8), tan(pi / 8)]
+static inline float atan_kernel(float x) {
+	float z = x * x;
+	return (((8.05374449538e-2f * z - 1.38776856032e-1f) * z + 1.99777106478e-1f) * z -
+			3.33329491539e-1f) * z * x + x;
+}
+
+float fast_asinf(float x) {
+	float a = fabsf(x);
+
+	if (a <= 0.5f) {
+		return asin_kernel(x);
+	}
+
+	if (a > 1.0f) {
+		a = 1.0f;
+	}
+
+	// asin(a) = pi / 2 - 2 * asin(sqrt((1 - a) / 2))
+	float r = PI_2_F - 2.0f * asin_kernel(sqrtf(0.5f * (1.0f - a)));
+	return x < 0.0f ? -r : r;
+}
+
+float fast_acosf(float x) {
+	if (x < -0.5f) {
+		if (x < -1.0f) {
+			x = -1.0f;
+		}
+		return PI_F - 2.0f * asin_kernel(sqrtf(0.5f * (1.0f + x)));
+	}
+
+	if (x > 0.5f) {
+		if (x > 1.0f) {
+			x = 1.0f;
+		}
+		return 2.0f * asin_kernel(sqrtf(0.5f * (1.0f - x)));
+	}
+
+	return PI_2_F - asin_kernel(x);
+}
+
+float fast_atan2f(float y, float x) {
+	float ax = fabsf(x);
+	float ay = fabsf(y);
+
+	// Reduce to the first octant, then to [-tan(pi / 8), tan(pi / 8)]
+	bool swap = ay > ax;
+	float num = swap ? ax : ay;
+	float den = swap ? ay : ax;
+	if (den == 0.0f) {
+		return 0.0f;
+	}
+
+	float t = num / den;
+	float r;
+	if (t > TAN_PI_8_F) {
+		r = PI_4_F + atan_kernel((t - 1.0f) / (t + 1.0f));
+	} else {
+		r = atan_kernel(t);
+	}
+
+	if (swap) {
+		r = PI_2_F - r;
+	}
+	if (x < 0.0f) {
+		r = PI_F - r;
+	}
+	return y < 0.0f ? -r : r;
+}
+
+void fast_sincosf(float angle, float *sin, float *cos) {
+	// Reduce to [-pi / 4, pi / 4] around the nearest multiple of pi / 2, the
+	// multiple is subtracted in three parts to keep the precision
+	float a = fabsf(angle);
+	int j = (int) (a * (1.0f / PI_4_F));
+	j = (j + 1) & ~1;
+	float y = (float) j;
+	float x = ((a - y * 0.78515625f) - y * 2.4187564849853515625e-4f) -
+			y * 3.77489497744594108e-8f;
+
+	float z = x * x;
+	float s = ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f) * z * x + x;
+	float c = ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z +
+			4.166664568298827e-2f) * z * z - 0.5f * z + 1.0f;
+
+	switch ((j >> 1) & 3) {
+	case 0: *sin = s; *cos = c; break;
+	case 1: *sin = c; *cos = -s; break;
+	case 2: *sin = -s; *cos = -c; break;
+	default: *sin = -c; *cos = s; break;
+	}
+
+	if (angle < 0.0f) {
+		*sin = -*sin;
+	}
+}
+
+float fast_cosf(float angle) {
+	float s, c;
+	fast_sincosf(angle, &s, &c);
+	return c;
+}
+
+float fast_inv_sqrtf(float x) {
+	uint32_t i;
+	memcpy(&i, &x, sizeof(i));
+	i = 0x5f375a86 - (i >> 1);
+	float y;
+	memcpy(&y, &i, sizeof(y));
+
+	float half_x = 0.5f * x;
+	y = y * (1.5f - half_x * y * y);
+	y = y * (1.5f - half_x * y * y);
+	return y;
+}
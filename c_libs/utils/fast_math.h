@@ -0,0 +1,62 @@
+/*
+	Copyright 2024 Lukas Hrazky
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+#ifndef FAST_MATH_H_
+#define FAST_MATH_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Fast single precision replacements for the libm functions used in the hot
+ * paths of the balance packages. The error bounds are the maximum absolute
+ * error against double precision libm over every float in the domain (for
+ * atan2 every y / x ratio, for sin and cos every angle in [0, 2 * pi]), they
+ * are checked by `refloat_sim -m`.
+ *
+ * The cycle counts are estimates for the Cortex-M4F from the instruction count
+ * (VDIV and VSQRT take 14 cycles, the other FPU instructions 1 to 3), they are
+ * not measured. The newlib versions take several hundred cycles each.
+ *
+ * utils_fast_atan2 and utils_fast_sincos_better in utils.h are cheaper still,
+ * but their errors (1e-2 and 1e-3 rad) are too large for the pitch estimate.
+ */
+
+// Max error 1.7e-7 rad, ~15 cycles for |x| <= 0.5, ~35 above. The argument is
+// clamped to [-1, 1].
+float fast_asinf(float x);
+
+// Max error 3.1e-7 rad, ~15 cycles for |x| <= 0.5, ~35 above. The argument is
+// clamped to [-1, 1].
+float fast_acosf(float x);
+
+// Max error 1.6e-7 rad for x > 0, 3e-7 rad for x < 0 where the result is
+// close to pi. ~35 cycles, ~50 when |y / x| or |x / y| is between tan(pi / 8)
+// and 1. Returns 0 for (0, 0).
+float fast_atan2f(float y, float x);
+
+// Max error 7.8e-8, ~35 cycles for both. The range reduction loses precision
+// above a few thousand radians.
+void fast_sincosf(float angle, float *sin, float *cos);
+float fast_cosf(float angle);
+
+// Max relative error 4.8e-6, ~12 cycles. Only valid for normal positive x.
+float fast_inv_sqrtf(float x);
+
+#endif  /* FAST_MATH_H_ */
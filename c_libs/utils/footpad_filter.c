@@ -0,0 +1,123 @@
+/*
+	Copyright 2024 Lukas Hrazky
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+#include "footpad_filter.h"
+
+void footpad_filter_configure(
+	FootpadFilter *f, int samples, bool median, float release_ratio, float lift_rate, float frequency
+) {
+	if (samples < 1) {
+		samples = 1;
+	} else if (samples > FOOTPAD_FILTER_MAX_SAMPLES) {
+		samples = FOOTPAD_FILTER_MAX_SAMPLES;
+	}
+
+	// The window contents are only valid for the same length
+	if (samples != f->samples) {
+		footpad_filter_reset(f);
+	}
+
+	// A ratio of 0 would never release the pad, above 1 it would never engage
+	if (release_ratio < 0.5f) {
+		release_ratio = 0.5f;
+	} else if (release_ratio > 1.0f) {
+		release_ratio = 1.0f;
+	}
+
+	f->samples = samples;
+	f->median = median;
+	f->release_ratio = release_ratio;
+	f->lift_drop = frequency > 0.0f ? lift_rate / frequency : 0.0f;
+}
+
+void footpad_filter_reset(FootpadFilter *f) {
+	f->idx = 0;
+	f->count = 0;
+	f->last_samples[0] = 0.0f;
+	f->last_samples[1] = 0.0f;
+	f->value = 0.0f;
+	f->engaged = false;
+}
+
+static float window_median(const FootpadFilter *f) {
+	float sorted[FOOTPAD_FILTER_MAX_SAMPLES];
+
+	// Insertion sort, the window is at most a handful of samples
+	for (int i = 0; i < f->count; ++i) {
+		float v = f->window[i];
+		int j = i;
+		for (; j > 0 && sorted[j - 1] > v; --j) {
+			sorted[j] = sorted[j - 1];
+		}
+		sorted[j] = v;
+	}
+
+	if (f->count % 2 == 0) {
+		return (sorted[f->count / 2 - 1] + sorted[f->count / 2]) * 0.5f;
+	}
+	return sorted[f->count / 2];
+}
+
+static float window_average(const FootpadFilter *f) {
+	float sum = 0.0f;
+	for (int i = 0; i < f->count; ++i) {
+		sum += f->window[i];
+	}
+	return sum / f->count;
+}
+
+bool footpad_filter_update(FootpadFilter *f, float sample, float threshold) {
+	f->window[f->idx] = sample;
+	f->idx = (f->idx + 1) % f->samples;
+	if (f->count < f->samples) {
+		++f->count;
+	}
+
+	if (f->count == 1) {
+		f->value = sample;
+	} else if (f->median) {
+		f->value = window_median(f);
+	} else {
+		f->value = window_average(f);
+	}
+
+	float release_threshold = threshold * f->release_ratio;
+	if (f->engaged) {
+		if (f->value <= release_threshold) {
+			f->engaged = false;
+		} else if (f->lift_drop > 0.0f && sample <= release_threshold &&
+				f->last_samples[0] <= release_threshold &&
+				f->last_samples[1] - sample > 2.0f * f->lift_drop) {
+			// Drop the samples from before the lift, they would keep the
+			// filtered value above the threshold and engage the pad again
+			for (int i = 0; i < f->count; ++i) {
+				f->window[i] = sample;
+			}
+			f->value = sample;
+			f->engaged = false;
+		}
+	} else if (f->value > threshold) {
+		f->engaged = true;
+	}
+
+	f->last_samples[1] = f->last_samples[0];
+	f->last_samples[0] = sample;
+
+	return f->engaged;
+}
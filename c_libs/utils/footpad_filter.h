@@ -0,0 +1,72 @@
+/*
+	Copyright 2024 Lukas Hrazky
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+#ifndef FOOTPAD_FILTER_H_
+#define FOOTPAD_FILTER_H_
+
+#include <stdbool.h>
+
+/*
+ * Processing of one footpad sensor (ADC) channel: a window of the last
+ * samples reduced by an average or a median, and a thresholded state with
+ * hysteresis. The pad engages when the filtered voltage goes above the
+ * threshold and only disengages once it falls to threshold * release_ratio.
+ *
+ * The window delays the filtered value by (samples - 1) / 2 loop periods, so
+ * there is a fast path on the raw samples as well: when the last two samples
+ * are below the release threshold and the voltage fell faster than lift_rate
+ * over them, the pad is released right away, without waiting for the
+ * filtered value. A clean step-off looks like that, a single-sample spike or
+ * shifting weight doesn't. The window is then refilled with the raw sample,
+ * so the values from before the lift can't engage the pad again.
+ *
+ * With one sample, a release ratio of 1 and no lift rate, the state is the
+ * plain "voltage > threshold" comparison.
+ */
+
+#define FOOTPAD_FILTER_MAX_SAMPLES 7
+
+typedef struct {
+	int samples;
+	bool median;
+	float release_ratio;
+	// Minimum drop between two samples for the fast path [V], 0 disables it
+	float lift_drop;
+
+	float window[FOOTPAD_FILTER_MAX_SAMPLES];
+	int idx;
+	int count;
+	float last_samples[2];
+
+	float value;  // The filtered voltage
+	bool engaged;
+} FootpadFilter;
+
+// lift_rate is in V/s, frequency is the rate of footpad_filter_update() calls,
+// release_ratio is limited to [0.5, 1]
+void footpad_filter_configure(
+	FootpadFilter *f, int samples, bool median, float release_ratio, float lift_rate, float frequency
+);
+
+void footpad_filter_reset(FootpadFilter *f);
+
+// Returns whether the pad is engaged
+bool footpad_filter_update(FootpadFilter *f, float sample, float threshold);
+
+#endif /* FOOTPAD_FILTER_H_ */
@@ -0,0 +1,66 @@
+/*
+	Copyright 2024 Lukas Hrazky
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+#include "kalman_pitch.h"
+
+void kalman_pitch_configure(KalmanPitch *k, float q_angle, float q_bias, float r_measure) {
+	k->q_angle = q_angle;
+	k->q_bias = q_bias;
+	k->r_measure = r_measure;
+}
+
+void kalman_pitch_reset(KalmanPitch *k, float angle) {
+	k->angle = angle;
+	k->bias = 0.0f;
+	k->rate = 0.0f;
+	k->p00 = 0.0f;
+	k->p01 = 0.0f;
+	k->p11 = 0.0f;
+}
+
+void kalman_pitch_predict(KalmanPitch *k, float rate, float dt) {
+	// Project the state ahead
+	k->rate = rate - k->bias;
+	k->angle += dt * k->rate;
+
+	// Project the error covariance ahead
+	k->p00 += dt * (dt * k->p11 - 2.0f * k->p01 + k->q_angle);
+	k->p01 -= dt * k->p11;
+	k->p11 += dt * k->q_bias;
+}
+
+void kalman_pitch_update(KalmanPitch *k, float angle) {
+	kalman_pitch_update_r(k, angle, k->r_measure);
+}
+
+void kalman_pitch_update_r(KalmanPitch *k, float angle, float r_measure) {
+	float s = k->p00 + r_measure;
+	float k0 = k->p00 / s;
+	float k1 = k->p01 / s;
+
+	float y = angle - k->angle;
+	k->angle += k0 * y;
+	k->bias += k1 * y;
+
+	float p00 = k->p00;
+	float p01 = k->p01;
+	k->p00 -= k0 * p00;
+	k->p01 -= k0 * p01;
+	k->p11 -= k1 * p01;
+}
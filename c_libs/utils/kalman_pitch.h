@@ -0,0 +1,63 @@
+/*
+	Copyright 2024 Lukas Hrazky
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+#ifndef KALMAN_PITCH_H_
+#define KALMAN_PITCH_H_
+
+/*
+ * Two state (angle, gyro bias) Kalman filter for the pitch angle, after the
+ * filter by Kristian Lauszus (TKJ Electronics), see
+ * http://blog.tkjelectronics.dk/2012/09/a-practical-approach-to-kalman-filter-and-how-to-implement-it
+ *
+ * The gyro rate drives the prediction and an absolute angle (from the
+ * accelerometer or another attitude estimate) corrects it. The two steps are
+ * separate, so the prediction can run for every IMU sample and the correction
+ * only when a new angle is available. Angle and rate units are up to the
+ * caller, the noise terms have to match them.
+ *
+ * The covariance is symmetric, only one of the off-diagonal terms is kept.
+ */
+
+typedef struct {
+	// Noise terms, q_angle and q_bias are per second
+	float q_angle;
+	float q_bias;
+	float r_measure;
+
+	float angle;
+	float bias;
+	float rate;  // The last unbiased rate
+
+	float p00, p01, p11;
+} KalmanPitch;
+
+void kalman_pitch_configure(KalmanPitch *k, float q_angle, float q_bias, float r_measure);
+
+// Starts from angle with zero bias and covariance, like the original filter
+void kalman_pitch_reset(KalmanPitch *k, float angle);
+
+void kalman_pitch_predict(KalmanPitch *k, float rate, float dt);
+
+void kalman_pitch_update(KalmanPitch *k, float angle);
+
+// Update with a different measurement noise for this angle only, e.g. a
+// less trusted accelerometer angle while accelerating
+void kalman_pitch_update_r(KalmanPitch *k, float angle, float r_measure);
+
+#endif /* KALMAN_PITCH_H_ */
@@ -63,6 +63,16 @@ bool rb_insert(rb_t *rb, const void *data) {
 	return res;
 }
 
+// Inserts an item, discarding the oldest one if the buffer is full
+void rb_insert_overwrite(rb_t *rb, const void *data) {
+	VESC_IF->mutex_lock(rb->mutex);
+	if (rb->full) {
+		pop(rb, NULL);
+	}
+	insert(rb, data);
+	VESC_IF->mutex_unlock(rb->mutex);
+}
+
 unsigned int rb_insert_multi(rb_t *rb, const void *data, unsigned int count) {
 	unsigned int cnt = 0;
 	VESC_IF->mutex_lock(rb->mutex);
@@ -96,6 +106,20 @@ unsigned int rb_pop_multi(rb_t *rb, void *data, unsigned int count) {
 	return cnt;
 }
 
+// Copies up to count items, starting offset items from the oldest one, without removing them
+unsigned int rb_peek_multi(rb_t *rb, unsigned int offset, void *data, unsigned int count) {
+	unsigned int cnt = 0;
+	VESC_IF->mutex_lock(rb->mutex);
+	unsigned int items = get_item_count(rb);
+	while (offset + cnt < items && cnt < count) {
+		unsigned int ind = (rb->tail + offset + cnt) % rb->item_count;
+		memcpy((char*)data + rb->item_size * cnt, (char*)(rb->data) + ind * rb->item_size, rb->item_size);
+		cnt++;
+	}
+	VESC_IF->mutex_unlock(rb->mutex);
+	return cnt;
+}
+
 bool rb_is_full(rb_t *rb) {
 	VESC_IF->mutex_lock(rb->mutex);
 	bool res = rb->full;
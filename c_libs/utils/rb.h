@@ -39,9 +39,11 @@ void rb_init_alloc(rb_t *rb, int item_size, int item_count);
 void rb_free(rb_t *rb);
 void rb_flush(rb_t *rb);
 bool rb_insert(rb_t *rb, const void *data);
+void rb_insert_overwrite(rb_t *rb, const void *data);
 unsigned int rb_insert_multi(rb_t *rb, const void *data, unsigned int count);
 bool rb_pop(rb_t *rb, void *data);
 unsigned int rb_pop_multi(rb_t *rb, void *data, unsigned int count);
+unsigned int rb_peek_multi(rb_t *rb, unsigned int offset, void *data, unsigned int count);
 bool rb_is_full(rb_t *rb);
 bool rb_is_empty(rb_t *rb);
 unsigned int rb_get_item_count(rb_t *rb);
@@ -23,6 +23,26 @@
 #define APPCONF_FLOAT_MAHONY_KP 2
 #endif
 
+// Kalman Pitch Filter
+#ifndef APPCONF_FLOAT_KALMAN_PITCH_ENABLED
+#define APPCONF_FLOAT_KALMAN_PITCH_ENABLED 0
+#endif
+
+// Kalman Q Angle
+#ifndef APPCONF_FLOAT_KALMAN_Q_ANGLE
+#define APPCONF_FLOAT_KALMAN_Q_ANGLE 0.001
+#endif
+
+// Kalman Q Bias
+#ifndef APPCONF_FLOAT_KALMAN_Q_BIAS
+#define APPCONF_FLOAT_KALMAN_Q_BIAS 0.003
+#endif
+
+// Kalman R Measure
+#ifndef APPCONF_FLOAT_KALMAN_R_MEASURE
+#define APPCONF_FLOAT_KALMAN_R_MEASURE 100
+#endif
+
 // Angle P (Braking)
 #ifndef APPCONF_FLOAT_KP_BRAKE
 #define APPCONF_FLOAT_KP_BRAKE 1
@@ -58,6 +78,26 @@
 #define APPCONF_FLOAT_FAULT_ADC2 2
 #endif
 
+// Footpad Filter Samples
+#ifndef APPCONF_FLOAT_FAULT_ADC_SAMPLES
+#define APPCONF_FLOAT_FAULT_ADC_SAMPLES 1
+#endif
+
+// Footpad Filter Median
+#ifndef APPCONF_FLOAT_FAULT_ADC_MEDIAN
+#define APPCONF_FLOAT_FAULT_ADC_MEDIAN 0
+#endif
+
+// Footpad Release Threshold
+#ifndef APPCONF_FLOAT_FAULT_ADC_RELEASE
+#define APPCONF_FLOAT_FAULT_ADC_RELEASE 1
+#endif
+
+// Footpad Fast Lift Rate
+#ifndef APPCONF_FLOAT_FAULT_ADC_LIFT_RATE
+#define APPCONF_FLOAT_FAULT_ADC_LIFT_RATE 0
+#endif
+
 // Beep on Sensor Fault
 #ifndef APPCONF_FLOAT_IS_FOOTBEEP_ENABLED
 #define APPCONF_FLOAT_IS_FOOTBEEP_ENABLED 1
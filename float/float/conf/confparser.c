@@ -14,6 +14,10 @@ int32_t confparser_serialize_float_config(uint8_t *buffer, const float_config *c
 	buffer_append_float16(buffer, conf->kp2, 100, &ind);
 	buffer_append_float16(buffer, conf->ki, 100000, &ind);
 	buffer_append_float16(buffer, conf->mahony_kp, 100, &ind);
+	buffer[ind++] = conf->kalman_pitch_enabled;
+	buffer_append_float16(buffer, conf->kalman_q_angle, 10000, &ind);
+	buffer_append_float16(buffer, conf->kalman_q_bias, 10000, &ind);
+	buffer_append_float16(buffer, conf->kalman_r_measure, 10, &ind);
 	buffer_append_float16(buffer, conf->kp_brake, 10, &ind);
 	buffer_append_float16(buffer, conf->kp2_brake, 10, &ind);
 	buffer_append_uint16(buffer, conf->hertz, &ind);
@@ -21,6 +25,10 @@ int32_t confparser_serialize_float_config(uint8_t *buffer, const float_config *c
 	buffer_append_float16(buffer, conf->fault_roll, 10, &ind);
 	buffer_append_float16(buffer, conf->fault_adc1, 1000, &ind);
 	buffer_append_float16(buffer, conf->fault_adc2, 1000, &ind);
+	buffer_append_uint16(buffer, conf->fault_adc_samples, &ind);
+	buffer[ind++] = conf->fault_adc_median;
+	buffer_append_float16(buffer, conf->fault_adc_release, 100, &ind);
+	buffer_append_float16(buffer, conf->fault_adc_lift_rate, 10, &ind);
 	buffer[ind++] = conf->is_footbeep_enabled;
 	buffer_append_uint16(buffer, conf->fault_delay_pitch, &ind);
 	buffer_append_uint16(buffer, conf->fault_delay_roll, &ind);
@@ -147,6 +155,10 @@ bool confparser_deserialize_float_config(const uint8_t *buffer, float_config *co
 	conf->kp2 = buffer_get_float16(buffer, 100, &ind);
 	conf->ki = buffer_get_float16(buffer, 100000, &ind);
 	conf->mahony_kp = buffer_get_float16(buffer, 100, &ind);
+	conf->kalman_pitch_enabled = buffer[ind++];
+	conf->kalman_q_angle = buffer_get_float16(buffer, 10000, &ind);
+	conf->kalman_q_bias = buffer_get_float16(buffer, 10000, &ind);
+	conf->kalman_r_measure = buffer_get_float16(buffer, 10, &ind);
 	conf->kp_brake = buffer_get_float16(buffer, 10, &ind);
 	conf->kp2_brake = buffer_get_float16(buffer, 10, &ind);
 	conf->hertz = buffer_get_uint16(buffer, &ind);
@@ -154,6 +166,10 @@ bool confparser_deserialize_float_config(const uint8_t *buffer, float_config *co
 	conf->fault_roll = buffer_get_float16(buffer, 10, &ind);
 	conf->fault_adc1 = buffer_get_float16(buffer, 1000, &ind);
 	conf->fault_adc2 = buffer_get_float16(buffer, 1000, &ind);
+	conf->fault_adc_samples = buffer_get_uint16(buffer, &ind);
+	conf->fault_adc_median = buffer[ind++];
+	conf->fault_adc_release = buffer_get_float16(buffer, 100, &ind);
+	conf->fault_adc_lift_rate = buffer_get_float16(buffer, 10, &ind);
 	conf->is_footbeep_enabled = buffer[ind++];
 	conf->fault_delay_pitch = buffer_get_uint16(buffer, &ind);
 	conf->fault_delay_roll = buffer_get_uint16(buffer, &ind);
@@ -273,6 +289,10 @@ void confparser_set_defaults_float_config(float_config *conf) {
 	conf->kp2 = APPCONF_FLOAT_KP2;
 	conf->ki = APPCONF_FLOAT_KI;
 	conf->mahony_kp = APPCONF_FLOAT_MAHONY_KP;
+	conf->kalman_pitch_enabled = APPCONF_FLOAT_KALMAN_PITCH_ENABLED;
+	conf->kalman_q_angle = APPCONF_FLOAT_KALMAN_Q_ANGLE;
+	conf->kalman_q_bias = APPCONF_FLOAT_KALMAN_Q_BIAS;
+	conf->kalman_r_measure = APPCONF_FLOAT_KALMAN_R_MEASURE;
 	conf->kp_brake = APPCONF_FLOAT_KP_BRAKE;
 	conf->kp2_brake = APPCONF_FLOAT_KP2_BRAKE;
 	conf->hertz = APPCONF_FLOAT_HERTZ;
@@ -280,6 +300,10 @@ void confparser_set_defaults_float_config(float_config *conf) {
 	conf->fault_roll = APPCONF_FLOAT_FAULT_ROLL;
 	conf->fault_adc1 = APPCONF_FLOAT_FAULT_ADC1;
 	conf->fault_adc2 = APPCONF_FLOAT_FAULT_ADC2;
+	conf->fault_adc_samples = APPCONF_FLOAT_FAULT_ADC_SAMPLES;
+	conf->fault_adc_median = APPCONF_FLOAT_FAULT_ADC_MEDIAN;
+	conf->fault_adc_release = APPCONF_FLOAT_FAULT_ADC_RELEASE;
+	conf->fault_adc_lift_rate = APPCONF_FLOAT_FAULT_ADC_LIFT_RATE;
 	conf->is_footbeep_enabled = APPCONF_FLOAT_IS_FOOTBEEP_ENABLED;
 	conf->fault_delay_pitch = APPCONF_FLOAT_FAULT_DELAY_PITCH;
 	conf->fault_delay_roll = APPCONF_FLOAT_FAULT_DELAY_ROLL;
@@ -47,6 +47,10 @@ typedef struct {
 	float ki;
 	float kp2;
 	float mahony_kp;
+	bool kalman_pitch_enabled;
+	float kalman_q_angle;
+	float kalman_q_bias;
+	float kalman_r_measure;
 	float kp_brake;
 	float kp2_brake;
 	uint16_t kp_brake_erpm;
@@ -55,6 +59,10 @@ typedef struct {
 	float fault_roll;
 	float fault_adc1;
 	float fault_adc2;
+	uint16_t fault_adc_samples;
+	bool fault_adc_median;
+	float fault_adc_release;
+	float fault_adc_lift_rate;
 	uint16_t fault_delay_pitch;
 	uint16_t fault_delay_roll;
 	uint16_t fault_delay_switch_half;
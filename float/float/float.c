@@ -30,6 +30,8 @@
 #include "./led.h"
 
 #include "konami.h"
+#include "biquad.h"
+#include "kalman_pitch.h"
 
 #include <math.h>
 #include <string.h>
@@ -92,16 +94,6 @@ typedef enum {
 	TILTBACK_TEMP
 } SetpointAdjustmentType;
 
-typedef struct{
-	float a0, a1, a2, b1, b2;
-	float z1, z2;
-} Biquad;
-
-typedef enum {
-	BQ_LOWPASS,
-	BQ_HIGHPASS
-} BiquadType;
-
 typedef enum {
 	NO_LIGHTS = 0,
 	INTERNAL = 1,
@@ -168,6 +160,9 @@ typedef struct {
 
 	// Feature: True Pitch
 	ATTITUDE_INFO m_att_ref;
+	// Replaces the firmware pitch when kalman_pitch_enabled, in radians
+	bool kalman_pitch_enabled;
+	KalmanPitch pitch_kalman;
 
 	// Runtime values read from elsewhere
 	float pitch_angle, last_pitch_angle, roll_angle, abs_roll_angle, abs_roll_angle_sin, last_gyro_y;
@@ -350,37 +345,6 @@ void beep_on(data *d, bool force)
 		EXT_BEEPER_ON();
 }
 
-// Utility Functions
-static float biquad_process(Biquad *biquad, float in) {
-    float out = in * biquad->a0 + biquad->z1;
-    biquad->z1 = in * biquad->a1 + biquad->z2 - biquad->b1 * out;
-    biquad->z2 = in * biquad->a2 - biquad->b2 * out;
-    return out;
-}
-
-static void biquad_config(Biquad *biquad, BiquadType type, float Fc) {
-	float K = tanf(M_PI * Fc);	// -0.0159;
-	float Q = 0.707; // maximum sharpness (0.5 = maximum smoothness)
-	float norm = 1 / (1 + K / Q + K * K);
-	if (type == BQ_LOWPASS) {
-		biquad->a0 = K * K * norm;
-		biquad->a1 = 2 * biquad->a0;
-		biquad->a2 = biquad->a0;
-	}
-	else if (type == BQ_HIGHPASS) {
-		biquad->a0 = 1 * norm;
-		biquad->a1 = -2 * biquad->a0;
-		biquad->a2 = biquad->a0;
-	}
-	biquad->b1 = 2 * (K * K - 1) * norm;
-	biquad->b2 = (1 - K / Q + K * K) * norm;
-}
-
-static void biquad_reset(Biquad *biquad) {
-	biquad->z1 = 0;
-	biquad->z2 = 0;
-}
-
 // First start only, set initial state
 static void app_init(data *d) {
 	if (d->state != DISABLED) {
@@ -431,6 +395,17 @@ static void configure(data *d) {
 	// Feature: Dirty Landings
 	d->startup_pitch_trickmargin = d->float_conf.startup_dirtylandings_enabled ? 10 : 0;
 
+	// Kalman pitch filter, configured in degrees
+	const float deg2rad_sq = (M_PI / 180.0) * (M_PI / 180.0);
+	kalman_pitch_configure(&d->pitch_kalman, d->float_conf.kalman_q_angle * deg2rad_sq,
+			d->float_conf.kalman_q_bias * deg2rad_sq, d->float_conf.kalman_r_measure * deg2rad_sq);
+	if (d->float_conf.kalman_pitch_enabled && !d->kalman_pitch_enabled) {
+		kalman_pitch_reset(&d->pitch_kalman, VESC_IF->imu_get_pitch());
+	}
+	d->kalman_pitch_enabled = d->float_conf.kalman_pitch_enabled;
+
+	footpad_sensor_configure(&d->footpad_sensor, &d->float_conf);
+
 	// Overwrite App CFG Mahony KP to Float CFG Value
 	if (VESC_IF->get_cfg_float(CFG_PARAM_IMU_mahony_kp) != d->float_conf.mahony_kp) {
 		VESC_IF->set_cfg_float(CFG_PARAM_IMU_mahony_kp, d->float_conf.mahony_kp);
@@ -472,7 +447,7 @@ static void configure(data *d) {
 
 	if (d->float_conf.atr_filter > 0) { // ATR Current Biquad
 		float Fc = d->float_conf.atr_filter / d->float_conf.hertz;
-		biquad_config(&d->atr_current_biquad, BQ_LOWPASS, Fc);
+		biquad_configure(&d->atr_current_biquad, BQ_LOWPASS, Fc);
 	}
 
 	// Feature: ATR:
@@ -1745,6 +1720,21 @@ static void imu_ref_callback(float *acc, float *gyro, float *mag, float dt) {
 	UNUSED(mag);
 	data *d = (data*)ARG;
 	VESC_IF->ahrs_update_mahony_imu(gyro, acc, dt, &d->m_att_ref);
+
+	if (d->kalman_pitch_enabled) {
+		kalman_pitch_predict(&d->pitch_kalman, gyro[1], dt);
+
+		// Trust the accelerometer less the further its magnitude is from 1g, the
+		// same confidence the Mahony filter uses, skip the correction below 0
+		float acc_yz = acc[1] * acc[1] + acc[2] * acc[2];
+		float acc_mag = sqrtf(acc[0] * acc[0] + acc_yz);
+		float confidence = 1.0 - d->m_att_ref.acc_confidence_decay * sqrtf(fabsf(acc_mag - 1.0));
+		if (confidence > 0) {
+			// Same convention as the firmware pitch: asin(-ax / |a|)
+			kalman_pitch_update_r(&d->pitch_kalman, atan2f(-acc[0], sqrtf(acc_yz)),
+					d->pitch_kalman.r_measure / (confidence * confidence));
+		}
+	}
 }
 
 static void float_thd(void *arg) {
@@ -1797,7 +1787,11 @@ static void float_thd(void *arg) {
 
 		// True pitch is derived from the secondary IMU filter running with kp=0.2
 		d->true_pitch_angle = RAD2DEG_f(VESC_IF->ahrs_get_pitch(&d->m_att_ref));
-		d->pitch_angle = RAD2DEG_f(VESC_IF->imu_get_pitch());
+		if (d->kalman_pitch_enabled) {
+			d->pitch_angle = RAD2DEG_f(d->pitch_kalman.angle);
+		} else {
+			d->pitch_angle = RAD2DEG_f(VESC_IF->imu_get_pitch());
+		}
 		if (d->is_flywheel_mode) {
 			// flip sign and use offsets
 			d->true_pitch_angle = d->flywheel_pitch_offset - d->true_pitch_angle;
@@ -38,14 +38,36 @@ FootpadSensorState footpad_sensor_state_evaluate(const FootpadSensor *fs, const
 	return FS_NONE;
 }
 
+void footpad_sensor_configure(FootpadSensor *fs, const float_config *config) {
+	FootpadFilter *filters[] = {&fs->filter1, &fs->filter2};
+	for (int i = 0; i < 2; ++i) {
+		footpad_filter_configure(filters[i], config->fault_adc_samples, config->fault_adc_median,
+				config->fault_adc_release, config->fault_adc_lift_rate, config->hertz);
+	}
+}
+
 void footpad_sensor_update(FootpadSensor *fs, const float_config *config) {
-	fs->adc1 = VESC_IF->io_read_analog(VESC_PIN_ADC1);
-	fs->adc2 = VESC_IF->io_read_analog(VESC_PIN_ADC2); // Returns -1.0 if the pin is missing on the hardware
-	if (fs->adc2 < 0.0) {
-		fs->adc2 = 0.0;
+	float adc1 = VESC_IF->io_read_analog(VESC_PIN_ADC1);
+	float adc2 = VESC_IF->io_read_analog(VESC_PIN_ADC2); // Returns -1.0 if the pin is missing on the hardware
+	if (adc2 < 0.0) {
+		adc2 = 0.0;
 	}
 
-	fs->state = footpad_sensor_state_evaluate(fs, config, false);
+	bool pad1 = footpad_filter_update(&fs->filter1, adc1, config->fault_adc1);
+	bool pad2 = footpad_filter_update(&fs->filter2, adc2, config->fault_adc2);
+	fs->adc1 = fs->filter1.value;
+	fs->adc2 = fs->filter2.value;
+
+	// Same sensor layouts as footpad_sensor_state_evaluate(), on the filter states
+	if (config->fault_adc1 == 0 && config->fault_adc2 == 0) { // No sensors
+		fs->state = FS_BOTH;
+	} else if (config->fault_adc2 == 0) { // Single sensor on ADC1
+		fs->state = pad1 ? FS_BOTH : FS_NONE;
+	} else if (config->fault_adc1 == 0) { // Single sensor on ADC2
+		fs->state = pad2 ? FS_BOTH : FS_NONE;
+	} else { // Double sensor
+		fs->state = pad1 ? (pad2 ? FS_BOTH : FS_LEFT) : (pad2 ? FS_RIGHT : FS_NONE);
+	}
 }
 
 int footpad_sensor_state_to_switch_compat(FootpadSensorState v) {
@@ -2,6 +2,8 @@
 
 #include "conf/datatypes.h"
 
+#include "footpad_filter.h"
+
 typedef enum {
 	FS_NONE = 0,
 	FS_LEFT = 1,
@@ -10,12 +12,16 @@ typedef enum {
 } FootpadSensorState;
 
 typedef struct {
+	FootpadFilter filter1, filter2;
+	// Filtered ADC voltages
 	float adc1, adc2;
 	FootpadSensorState state;
 } FootpadSensor;
 
 FootpadSensorState footpad_sensor_state_evaluate(const FootpadSensor *fs, const float_config *config, bool handpress);
 
+void footpad_sensor_configure(FootpadSensor *fs, const float_config *config);
+
 void footpad_sensor_update(FootpadSensor *fs, const float_config *config);
 
 int footpad_sensor_state_to_switch_compat(FootpadSensorState v);
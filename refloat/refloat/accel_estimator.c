@@ -0,0 +1,145 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "accel_estimator.h"
+
+#include <math.h>
+
+// Alpha-beta tracker bandwidth [Hz], both poles are placed here
+#define ALPHA_BETA_BANDWIDTH 16.0f
+
+// Kalman measurement noise [ERPM] and acceleration random walk [ERPM/s per sqrt(s)]
+#define KALMAN_ERPM_NOISE 20.0f
+#define KALMAN_ACCEL_NOISE 8000.0f
+// Initial acceleration uncertainty after a reset [ERPM/iteration]
+#define KALMAN_INITIAL_ACCEL 10.0f
+
+// Sums of the sample ages 0..N-1 and of their squares for the Savitzky-Golay fit
+#define AGE_SUM ((ACCEL_WINDOW_SIZE - 1) * ACCEL_WINDOW_SIZE / 2.0f)
+#define AGE_SQ_SUM ((ACCEL_WINDOW_SIZE - 1) * ACCEL_WINDOW_SIZE * (2 * ACCEL_WINDOW_SIZE - 1) / 6.0f)
+
+void accel_estimator_configure(AccelEstimator *e, AccelEstimatorType type, float frequency) {
+    float dt = 1.0f / frequency;
+
+    float pole = expf(-2.0f * M_PI * ALPHA_BETA_BANDWIDTH * dt);
+    e->alpha = 1.0f - pole * pole;
+    e->beta = (1.0f - pole) * (1.0f - pole);
+
+    // Discrete white noise acceleration model, in ERPM per iteration
+    e->q = KALMAN_ACCEL_NOISE * KALMAN_ACCEL_NOISE * dt * dt * dt;
+
+    if (type != e->type) {
+        e->type = type;
+        accel_estimator_reset(e);
+    }
+}
+
+void accel_estimator_reset(AccelEstimator *e) {
+    e->acceleration = 0.0f;
+
+    e->idx = 0;
+    for (int i = 0; i < ACCEL_WINDOW_SIZE; ++i) {
+        e->history[i] = 0.0f;
+    }
+    e->sum = 0.0f;
+    e->weighted_sum = 0.0f;
+
+    e->erpm = e->last_erpm;
+    e->p[0] = KALMAN_ERPM_NOISE * KALMAN_ERPM_NOISE;
+    e->p[1] = 0.0f;
+    e->p[2] = KALMAN_INITIAL_ACCEL * KALMAN_INITIAL_ACCEL;
+}
+
+static void moving_average_update(AccelEstimator *e, float diff) {
+    e->acceleration += (diff - e->history[e->idx]) / ACCEL_WINDOW_SIZE;
+    e->history[e->idx] = diff;
+    e->idx = (e->idx + 1) % ACCEL_WINDOW_SIZE;
+}
+
+static void savitzky_golay_update(AccelEstimator *e, float diff) {
+    // Every sample ages by one, the oldest one drops out of the window
+    float oldest = e->history[e->idx];
+    e->weighted_sum += e->sum - ACCEL_WINDOW_SIZE * oldest;
+    e->sum += diff - oldest;
+    e->history[e->idx] = diff;
+    e->idx = (e->idx + 1) % ACCEL_WINDOW_SIZE;
+
+    if (e->idx == 0) {
+        // The newest sample is the last one in the array
+        e->sum = 0.0f;
+        e->weighted_sum = 0.0f;
+        for (int i = 0; i < ACCEL_WINDOW_SIZE; ++i) {
+            e->sum += e->history[i];
+            e->weighted_sum += e->history[i] * (ACCEL_WINDOW_SIZE - 1 - i);
+        }
+    }
+
+    // A line fitted over the ERPM differences by their age (a quadratic fit of
+    // the ERPM), evaluated at age 0
+    e->acceleration = (AGE_SQ_SUM * e->sum - AGE_SUM * e->weighted_sum) /
+        (ACCEL_WINDOW_SIZE * AGE_SQ_SUM - AGE_SUM * AGE_SUM);
+}
+
+static void alpha_beta_update(AccelEstimator *e, float erpm) {
+    e->erpm += e->acceleration;
+    float residual = erpm - e->erpm;
+    e->erpm += e->alpha * residual;
+    e->acceleration += e->beta * residual;
+}
+
+static void kalman_update(AccelEstimator *e, float erpm) {
+    float *p = e->p;
+
+    // Predict with constant acceleration
+    e->erpm += e->acceleration;
+    p[0] += 2.0f * p[1] + p[2] + 0.25f * e->q;
+    p[1] += p[2] + 0.5f * e->q;
+    p[2] += e->q;
+
+    // Correct with the measured ERPM
+    float k0 = p[0] / (p[0] + KALMAN_ERPM_NOISE * KALMAN_ERPM_NOISE);
+    float k1 = p[1] / (p[0] + KALMAN_ERPM_NOISE * KALMAN_ERPM_NOISE);
+    float residual = erpm - e->erpm;
+    e->erpm += k0 * residual;
+    e->acceleration += k1 * residual;
+
+    p[2] -= k1 * p[1];
+    p[1] -= k0 * p[1];
+    p[0] -= k0 * p[0];
+}
+
+float accel_estimator_update(AccelEstimator *e, float erpm) {
+    float diff = erpm - e->last_erpm;
+    e->last_erpm = erpm;
+
+    switch (e->type) {
+    case ACCEL_ESTIMATOR_MOVING_AVERAGE:
+        moving_average_update(e, diff);
+        break;
+    case ACCEL_ESTIMATOR_SAVITZKY_GOLAY:
+        savitzky_golay_update(e, diff);
+        break;
+    case ACCEL_ESTIMATOR_ALPHA_BETA:
+        alpha_beta_update(e, erpm);
+        break;
+    case ACCEL_ESTIMATOR_KALMAN:
+        kalman_update(e, erpm);
+        break;
+    }
+
+    return e->acceleration;
+}
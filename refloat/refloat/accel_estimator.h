@@ -0,0 +1,68 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "conf/datatypes.h"
+
+#include <stdint.h>
+
+#define ACCEL_WINDOW_SIZE 40
+
+/**
+ * Estimates the motor acceleration from the ERPM, once per control loop
+ * iteration. All estimators output the acceleration in ERPM per loop
+ * iteration, the unit of the original 40 sample moving average, so the
+ * traction control and ATR thresholds stay the same for all of them.
+ *
+ * - Moving average: mean of the last 40 ERPM differences, a 20 sample delay.
+ * - Alpha-beta: a critically damped position / velocity tracker on the ERPM.
+ * - Savitzky-Golay: a quadratic least squares fit over the last 40 ERPM
+ *   values, differentiated at the newest one. No delay on constant
+ *   acceleration, settles in 40 samples after a change.
+ * - Kalman: a constant acceleration Kalman filter on the ERPM, the gains
+ *   adapt after a reset and converge to those of an alpha-beta tracker.
+ *
+ * Every update is O(1), the Savitzky-Golay running sums are recomputed from
+ * the window once per 40 samples to keep float rounding from accumulating.
+ * The alpha-beta and Kalman parameters are in seconds, the moving average
+ * and Savitzky-Golay windows are in samples (as the original average was).
+ */
+typedef struct {
+    AccelEstimatorType type;
+    float acceleration;  // [ERPM / iteration]
+    float last_erpm;
+
+    // moving average and Savitzky-Golay: window of ERPM differences
+    float history[ACCEL_WINDOW_SIZE];
+    uint8_t idx;
+    float sum;
+    float weighted_sum;  // sum of history[i] * age of the sample
+
+    // alpha-beta and Kalman: ERPM and acceleration estimate
+    float erpm;
+    float alpha;
+    float beta;
+    float p[3];  // covariance: erpm, cross, acceleration
+    float q;  // per-iteration acceleration process noise variance
+} AccelEstimator;
+
+void accel_estimator_configure(AccelEstimator *e, AccelEstimatorType type, float frequency);
+
+void accel_estimator_reset(AccelEstimator *e);
+
+float accel_estimator_update(AccelEstimator *e, float erpm);
@@ -32,8 +32,11 @@ void atr_reset(ATR *atr) {
 }
 
 void atr_configure(ATR *atr, const RefloatConfig *config) {
-    atr->on_step_size = config->atr_on_speed / config->hertz;
-    atr->off_step_size = config->atr_off_speed / config->hertz;
+    atr->on_speed = config->atr_on_speed;
+    atr->off_speed = config->atr_off_speed;
+
+    atr->accel_mult = 1.0f / config->atr_amps_accel_ratio;
+    atr->decel_mult = 1.0f / config->atr_amps_decel_ratio;
 
     atr->speed_boost_mult = 1.0f / 3000.0f;
     if (fabsf(config->atr_speed_boost) > 0.4f) {
@@ -48,15 +51,16 @@ void atr_configure(ATR *atr, const RefloatConfig *config) {
         // incorporate negative sign into braketilt factor instead of adding it each balance loop
         atr->braketilt_factor = -(0.5f + (20 - config->braketilt_strength) / 5.0f);
     }
+    atr->braketilt_off_speed = atr->off_speed / config->braketilt_lingering;
 }
 
-static void atr_update(ATR *atr, const MotorData *motor, const RefloatConfig *config) {
+// Updates the difference between the expected and measured acceleration,
+// returns the expected acceleration
+static float accel_diff_update(ATR *atr, const MotorData *motor) {
     float abs_torque = fabsf(motor->atr_filtered_current);
     float torque_offset = 8;  // hard-code to 8A for now (shouldn't really be changed much anyways)
-    float atr_threshold = motor->braking ? config->atr_threshold_down : config->atr_threshold_up;
-    float accel_factor =
-        motor->braking ? config->atr_amps_decel_ratio : config->atr_amps_accel_ratio;
-    float accel_factor2 = accel_factor * 1.3;
+    float accel_mult = motor->braking ? atr->decel_mult : atr->accel_mult;
+    float accel_mult2 = accel_mult * (1.0f / 1.3f);
 
     // compare measured acceleration to expected acceleration
     float measured_acc = fmaxf(motor->acceleration, -5);
@@ -67,17 +71,12 @@ static void atr_update(ATR *atr, const MotorData *motor, const RefloatConfig *co
     float expected_acc;
     if (abs_torque < 25) {
         expected_acc =
-            (motor->atr_filtered_current - motor->erpm_sign * torque_offset) / accel_factor;
+            (motor->atr_filtered_current - motor->erpm_sign * torque_offset) * accel_mult;
     } else {
         // primitive linear approximation of non-linear torque-accel relationship
         int torque_sign = sign(motor->atr_filtered_current);
-        expected_acc = (torque_sign * 25 - motor->erpm_sign * torque_offset) / accel_factor;
-        expected_acc += torque_sign * (abs_torque - 25) / accel_factor2;
-    }
-
-    bool forward = motor->erpm > 0;
-    if (motor->abs_erpm < 250 && abs_torque > 30) {
-        forward = (expected_acc > 0);
+        expected_acc = (torque_sign * 25 - motor->erpm_sign * torque_offset) * accel_mult;
+        expected_acc += torque_sign * (abs_torque - 25) * accel_mult2;
     }
 
     float new_accel_diff = expected_acc - measured_acc;
@@ -91,6 +90,18 @@ static void atr_update(ATR *atr, const MotorData *motor, const RefloatConfig *co
         atr->accel_diff = 0;
     }
 
+    return expected_acc;
+}
+
+static void atr_update(ATR *atr, const MotorData *motor, const RefloatConfig *config, float dt) {
+    float atr_threshold = motor->braking ? config->atr_threshold_down : config->atr_threshold_up;
+    float expected_acc = accel_diff_update(atr, motor);
+
+    bool forward = motor->erpm > 0;
+    if (motor->abs_erpm < 250 && fabsf(motor->atr_filtered_current) > 30) {
+        forward = (expected_acc > 0);
+    }
+
     // atr->accel_diff | > 0  | <= 0
     // -------------+------+-------
     //         forward | up   | down
@@ -133,34 +144,34 @@ static void atr_update(ATR *atr, const MotorData *motor, const RefloatConfig *co
     // Key to keeping the board level and consistent is to determine the appropriate step size!
     // We want to react quickly to changes, but we don't want to overreact to glitches in
     // acceleration data or trigger oscillations...
-    float atr_step_size = 0;
+    float atr_speed = 0;
     const float TT_BOOST_MARGIN = 2;
     if (forward) {
         if (atr->offset < 0) {
             // downhill
             if (atr->offset < atr->target_offset) {
                 // to avoid oscillations we go down slower than we go up
-                atr_step_size = atr->off_step_size;
+                atr_speed = atr->off_speed;
                 if ((atr->target_offset > 0) &&
                     ((atr->target_offset - atr->offset) > TT_BOOST_MARGIN) &&
                     motor->abs_erpm > 2000) {
                     // boost the speed if tilt target has reversed (and if there's a significant
                     // margin)
-                    atr_step_size = atr->off_step_size * config->atr_transition_boost;
+                    atr_speed = atr->off_speed * config->atr_transition_boost;
                 }
             } else {
                 // ATR is increasing
-                atr_step_size = atr->on_step_size * response_boost;
+                atr_speed = atr->on_speed * response_boost;
             }
         } else {
             // uphill or other heavy resistance (grass, mud, etc)
             if ((atr->target_offset > -3) && (atr->offset > atr->target_offset)) {
                 // ATR winding down (current ATR is bigger than the target)
                 // normal wind down case: to avoid oscillations we go down slower than we go up
-                atr_step_size = atr->off_step_size;
+                atr_speed = atr->off_speed;
             } else {
                 // standard case of increasing ATR
-                atr_step_size = atr->on_step_size * response_boost;
+                atr_speed = atr->on_speed * response_boost;
             }
         }
     } else {
@@ -168,40 +179,38 @@ static void atr_update(ATR *atr, const MotorData *motor, const RefloatConfig *co
             // downhill
             if (atr->offset > atr->target_offset) {
                 // to avoid oscillations we go down slower than we go up
-                atr_step_size = atr->off_step_size;
+                atr_speed = atr->off_speed;
                 if ((atr->target_offset < 0) &&
                     ((atr->offset - atr->target_offset) > TT_BOOST_MARGIN) &&
                     motor->abs_erpm > 2000) {
                     // boost the speed if tilt target has reversed (and if there's a significant
                     // margin)
-                    atr_step_size = atr->off_step_size * config->atr_transition_boost;
+                    atr_speed = atr->off_speed * config->atr_transition_boost;
                 }
             } else {
                 // ATR is increasing
-                atr_step_size = atr->on_step_size * response_boost;
+                atr_speed = atr->on_speed * response_boost;
             }
         } else {
             // uphill or other heavy resistance (grass, mud, etc)
             if ((atr->target_offset < 3) && (atr->offset < atr->target_offset)) {
                 // normal wind down case: to avoid oscillations we go down slower than we go up
-                atr_step_size = atr->off_step_size;
+                atr_speed = atr->off_speed;
             } else {
                 // standard case of increasing torquetilt
-                atr_step_size = atr->on_step_size * response_boost;
+                atr_speed = atr->on_speed * response_boost;
             }
         }
     }
 
     if (motor->abs_erpm < 500) {
-        atr_step_size /= 2;
+        atr_speed /= 2;
     }
 
-    rate_limitf(&atr->offset, atr->target_offset, atr_step_size);
+    rate_limitf(&atr->offset, atr->target_offset, atr_speed * dt);
 }
 
-static void braketilt_update(
-    ATR *atr, const MotorData *motor, const RefloatConfig *config, float proportional
-) {
+static void braketilt_update(ATR *atr, const MotorData *motor, float proportional, float dt) {
     // braking also should cause setpoint change lift, causing a delayed lingering nose lift
     if (atr->braketilt_factor < 0 && motor->braking && motor->abs_erpm > 2000) {
         // negative currents alone don't necessarily consitute active braking, look at proportional:
@@ -223,25 +232,29 @@ static void braketilt_update(
         atr->braketilt_target_offset = 0;
     }
 
-    float braketilt_step_size = atr->off_step_size / config->braketilt_lingering;
+    float braketilt_speed = atr->braketilt_off_speed;
     if (fabsf(atr->braketilt_target_offset) > fabsf(atr->braketilt_offset)) {
-        braketilt_step_size = atr->on_step_size * 1.5;
+        braketilt_speed = atr->on_speed * 1.5;
     } else if (motor->abs_erpm < 800) {
-        braketilt_step_size = atr->on_step_size;
+        braketilt_speed = atr->on_speed;
     }
 
     if (motor->abs_erpm < 500) {
-        braketilt_step_size /= 2;
+        braketilt_speed /= 2;
     }
 
-    rate_limitf(&atr->braketilt_offset, atr->braketilt_target_offset, braketilt_step_size);
+    rate_limitf(&atr->braketilt_offset, atr->braketilt_target_offset, braketilt_speed * dt);
 }
 
 void atr_and_braketilt_update(
-    ATR *atr, const MotorData *motor, const RefloatConfig *config, float proportional
+    ATR *atr, const MotorData *motor, const RefloatConfig *config, float proportional, float dt
 ) {
-    atr_update(atr, motor, config);
-    braketilt_update(atr, motor, config, proportional);
+    atr_update(atr, motor, config, dt);
+    braketilt_update(atr, motor, proportional, dt);
+}
+
+void atr_track_accel_diff(ATR *atr, const MotorData *motor) {
+    accel_diff_update(atr, motor);
 }
 
 void atr_and_braketilt_winddown(ATR *atr) {
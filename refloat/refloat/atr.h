@@ -23,8 +23,9 @@
 
 // includes braketilt as well, at least for now
 typedef struct {
-    float on_step_size;
-    float off_step_size;
+    // [deg/s]
+    float on_speed;
+    float off_speed;
 
     float accel_diff;
     float speed_boost;
@@ -33,8 +34,12 @@ typedef struct {
     float offset;  // rate-limited setpoint offset
 
     float speed_boost_mult;
+    // reciprocals of the configured amps to acceleration ratios
+    float accel_mult;
+    float decel_mult;
 
     float braketilt_factor;
+    float braketilt_off_speed;  // [deg/s]
     float braketilt_target_offset;  // braketilt setpoint target offset
     float braketilt_offset;  // rate-limited braketilt setpoint offset
 } ATR;
@@ -44,7 +49,13 @@ void atr_reset(ATR *atr);
 void atr_configure(ATR *atr, const RefloatConfig *config);
 
 void atr_and_braketilt_update(
-    ATR *atr, const MotorData *motor, const RefloatConfig *config, float proportional
+    ATR *atr, const MotorData *motor, const RefloatConfig *config, float proportional, float dt
 );
 
+/**
+ * Only updates the acceleration difference, for the telemetry when ATR and
+ * braketilt are disabled.
+ */
+void atr_track_accel_diff(ATR *atr, const MotorData *motor);
+
 void atr_and_braketilt_winddown(ATR *atr);
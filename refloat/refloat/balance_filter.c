@@ -31,12 +31,15 @@
 
 #include "balance_filter.h"
 
+#include "utils.h"
+
+#include "fast_math.h"
 #include "vesc_c_if.h"
 
 #include <math.h>
 
 static inline float inv_sqrt(float x) {
-    return 1.0 / sqrtf(x);
+    return fast_inv_sqrtf(x);
 }
 
 static float calculate_acc_confidence(float new_acc_mag, BalanceFilterData *data) {
@@ -65,9 +68,61 @@ void balance_filter_configure(BalanceFilterData *data, const RefloatConfig *conf
     data->kp_pitch = config->mahony_kp;
     data->kp_roll = config->mahony_kp_roll;
     data->kp_yaw = config->mahony_kp_yaw;
+
+    // Configured in degrees
+    const float deg2rad_sq = deg2rad(1.0f) * deg2rad(1.0f);
+    kalman_pitch_configure(
+        &data->kalman,
+        config->bf_kalman_q_angle * deg2rad_sq,
+        config->bf_kalman_q_bias * deg2rad_sq,
+        config->bf_kalman_r_measure * deg2rad_sq
+    );
+
+    bool kalman_enabled = config->bf_pitch_estimator == BF_PITCH_KALMAN;
+    if (kalman_enabled && !data->kalman_enabled) {
+        kalman_pitch_reset(&data->kalman, balance_filter_get_pitch(data));
+    }
+    data->kalman_enabled = kalman_enabled;
+}
+
+static void kalman_update(BalanceFilterData *data, float *gyro_xyz, float *accel_xyz, float dt) {
+    float ax = accel_xyz[0];
+    float ay = accel_xyz[1];
+    float az = accel_xyz[2];
+
+    kalman_pitch_predict(&data->kalman, gyro_xyz[1], dt);
+
+    // Like the Mahony gain, the correction backs off while the board
+    // accelerates: the measurement noise grows with the inverse square of the
+    // accelerometer confidence (acc_mag was just updated by the Mahony update)
+    float confidence =
+        1.0f - data->acc_confidence_decay * sqrtf(fabsf(data->acc_mag - 1.0f));
+    if (confidence <= 0.0f) {
+        return;
+    }
+
+    // The same pitch convention as balance_filter_get_pitch(): asin(-ax / |a|)
+    float r_measure = data->kalman.r_measure / (confidence * confidence);
+    kalman_pitch_update_r(
+        &data->kalman, fast_atan2f(-ax, sqrtf(ay * ay + az * az)), r_measure
+    );
 }
 
 void balance_filter_update(BalanceFilterData *data, float *gyro_xyz, float *accel_xyz, float dt) {
+#ifdef BALANCE_FILTER_CMSIS
+    balance_filter_update_cmsis(data, gyro_xyz, accel_xyz, dt);
+#else
+    balance_filter_update_scalar(data, gyro_xyz, accel_xyz, dt);
+#endif
+
+    if (data->kalman_enabled) {
+        kalman_update(data, gyro_xyz, accel_xyz, dt);
+    }
+}
+
+void balance_filter_update_scalar(
+    BalanceFilterData *data, float *gyro_xyz, float *accel_xyz, float dt
+) {
     float gx = gyro_xyz[0];
     float gy = gyro_xyz[1];
     float gz = gyro_xyz[2];
@@ -136,10 +191,14 @@ float balance_filter_get_roll(BalanceFilterData *data) {
     const float q2 = data->q2;
     const float q3 = data->q3;
 
-    return -atan2f(q0 * q1 + q2 * q3, 0.5 - (q1 * q1 + q2 * q2));
+    return -fast_atan2f(q0 * q1 + q2 * q3, 0.5 - (q1 * q1 + q2 * q2));
 }
 
 float balance_filter_get_pitch(BalanceFilterData *data) {
+    if (data->kalman_enabled) {
+        return data->kalman.angle;
+    }
+
     float sin = -2.0 * (data->q1 * data->q3 - data->q0 * data->q2);
 
     if (sin < -1) {
@@ -148,7 +207,7 @@ float balance_filter_get_pitch(BalanceFilterData *data) {
         return M_PI / 2;
     }
 
-    return asinf(sin);
+    return fast_asinf(sin);
 }
 
 float balance_filter_get_yaw(BalanceFilterData *data) {
@@ -157,5 +216,5 @@ float balance_filter_get_yaw(BalanceFilterData *data) {
     const float q2 = data->q2;
     const float q3 = data->q3;
 
-    return -atan2f(q0 * q3 + q1 * q2, 0.5 - (q2 * q2 + q3 * q3));
+    return -fast_atan2f(q0 * q3 + q1 * q2, 0.5 - (q2 * q2 + q3 * q3));
 }
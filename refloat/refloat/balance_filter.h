@@ -20,6 +20,10 @@
 
 #include "conf/datatypes.h"
 
+#include "kalman_pitch.h"
+
+#include <stdbool.h>
+
 typedef struct {
     float q0;
     float q1;
@@ -32,14 +36,32 @@ typedef struct {
     float kp_pitch;
     float kp_roll;
     float kp_yaw;
+
+    // Replaces the Mahony pitch when bf_pitch_estimator is Kalman, runs in
+    // radians next to the Mahony update (which still provides roll and yaw)
+    bool kalman_enabled;
+    KalmanPitch kalman;
 } BalanceFilterData;
 
 void balance_filter_init(BalanceFilterData *data);
 
 void balance_filter_configure(BalanceFilterData *data, const RefloatConfig *config);
 
+// Runs balance_filter_update_cmsis when built with BALANCE_FILTER_CMSIS,
+// balance_filter_update_scalar otherwise, and the Kalman pitch filter if enabled
 void balance_filter_update(BalanceFilterData *data, float *gyro_xyz, float *accel_xyz, float dt);
 
+void balance_filter_update_scalar(
+    BalanceFilterData *data, float *gyro_xyz, float *accel_xyz, float dt
+);
+
+// The same update ordered for the Cortex-M4 FPU: fused multiply-adds, one
+// VSQRT for each normalization (through CMSIS arm_sqrt_f32) and the
+// accelerometer norm computed only once. Implemented in balance_filter_cmsis.c.
+void balance_filter_update_cmsis(
+    BalanceFilterData *data, float *gyro_xyz, float *accel_xyz, float dt
+);
+
 float balance_filter_get_roll(BalanceFilterData *data);
 float balance_filter_get_pitch(BalanceFilterData *data);
 float balance_filter_get_yaw(BalanceFilterData *data);
@@ -0,0 +1,107 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "balance_filter.h"
+
+// arm_math.h needs the core and FPU selected, it would otherwise fall back to
+// the Cortex-M0 definitions
+#define ARM_MATH_CM4
+#define __FPU_PRESENT 1
+#include "arm_math.h"
+
+#include <math.h>
+
+// Square root for non-negative x. With the FPU, arm_sqrt_f32 is a single VSQRT.
+static inline float sqrt_nn(float x) {
+    float32_t out;
+    arm_sqrt_f32(x, &out);
+    return out;
+}
+
+void balance_filter_update_cmsis(
+    BalanceFilterData *data, float *gyro_xyz, float *accel_xyz, float dt
+) {
+    float gx = gyro_xyz[0];
+    float gy = gyro_xyz[1];
+    float gz = gyro_xyz[2];
+
+    float ax = accel_xyz[0];
+    float ay = accel_xyz[1];
+    float az = accel_xyz[2];
+
+    float q0 = data->q0;
+    float q1 = data->q1;
+    float q2 = data->q2;
+    float q3 = data->q3;
+
+    float accel_norm = sqrt_nn(fmaf(ax, ax, fmaf(ay, ay, az * az)));
+
+    // Compute feedback only if accelerometer abs(vector)is not too small to avoid a division
+    // by a small number
+    if (accel_norm > 0.01f) {
+        // G.K. Egan (C) accelerometer confidence, see calculate_acc_confidence()
+        data->acc_mag = fmaf(data->acc_mag, 0.9f, accel_norm * 0.1f);
+        float accel_confidence =
+            fmaf(-data->acc_confidence_decay, sqrt_nn(fabsf(data->acc_mag - 1.0f)), 1.0f);
+        if (accel_confidence < 0.0f) {
+            accel_confidence = 0.0f;
+        }
+
+        float two_confidence = 2.0f * accel_confidence;
+        float two_kp_pitch = data->kp_pitch * two_confidence;
+        float two_kp_roll = data->kp_roll * two_confidence;
+        float two_kp_yaw = data->kp_yaw * two_confidence;
+
+        // Normalise accelerometer measurement, the norm is already known
+        float recip_norm = 1.0f / accel_norm;
+        ax *= recip_norm;
+        ay *= recip_norm;
+        az *= recip_norm;
+
+        // Estimated direction of gravity and vector perpendicular to magnetic flux
+        float halfvx = fmaf(q1, q3, -q0 * q2);
+        float halfvy = fmaf(q0, q1, q2 * q3);
+        float halfvz = fmaf(q0, q0, fmaf(q3, q3, -0.5f));
+
+        // Error is sum of cross product between estimated and measured direction of gravity
+        float halfex = fmaf(ay, halfvz, -az * halfvy);
+        float halfey = fmaf(az, halfvx, -ax * halfvz);
+        float halfez = fmaf(ax, halfvy, -ay * halfvx);
+
+        // Apply proportional feedback
+        gx = fmaf(two_kp_roll, halfex, gx);
+        gy = fmaf(two_kp_pitch, halfey, gy);
+        gz = fmaf(two_kp_yaw, halfez, gz);
+    }
+
+    // Integrate rate of change of quaternion
+    float half_dt = 0.5f * dt;
+    gx *= half_dt;
+    gy *= half_dt;
+    gz *= half_dt;
+    float n0 = fmaf(-q1, gx, fmaf(-q2, gy, fmaf(-q3, gz, q0)));
+    float n1 = fmaf(q0, gx, fmaf(q2, gz, fmaf(-q3, gy, q1)));
+    float n2 = fmaf(q0, gy, fmaf(-q1, gz, fmaf(q3, gx, q2)));
+    float n3 = fmaf(q0, gz, fmaf(q1, gy, fmaf(-q2, gx, q3)));
+
+    // Normalize quaternion
+    float recip_norm = 1.0f / sqrt_nn(fmaf(n0, n0, fmaf(n1, n1, fmaf(n2, n2, n3 * n3))));
+    data->q0 = n0 * recip_norm;
+    data->q1 = n1 * recip_norm;
+    data->q2 = n2 * recip_norm;
+    data->q3 = n3 * recip_norm;
+}
@@ -0,0 +1,136 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "blackbox.h"
+
+#include "utils.h"
+
+#include "vesc_c_if.h"
+
+static void set_state(Blackbox *bb, BlackboxState state) {
+    __atomic_store_n(&bb->state, state, __ATOMIC_RELEASE);
+}
+
+void blackbox_init(Blackbox *bb, const RefloatConfig *config) {
+    bb->allocated = false;
+    bb->record_size = telemetry_packed_size(BLACKBOX_MASK);
+    blackbox_configure(bb, config);
+    bb->state = BLACKBOX_DISABLED;
+    bb->rearm_request = false;
+    bb->event = BLACKBOX_EVENT_NONE;
+    bb->stop_condition = 0;
+    bb->last_iteration = 0;
+    bb->trigger_iteration = 0;
+    bb->post_left = 0;
+
+    uint32_t records = (config->blackbox_pre_ms + config->blackbox_post_ms) * config->hertz / 1000;
+    if (records == 0) {
+        return;
+    }
+    if (records > UINT16_MAX) {
+        records = UINT16_MAX;
+    }
+
+    void *buffer = VESC_IF->malloc(records * bb->record_size);
+    if (!buffer) {
+        log_error("Failed to init black box, out of memory.");
+        return;
+    }
+
+    rb_init(&bb->rb, buffer, bb->record_size, records);
+    bb->allocated = true;
+    set_state(bb, BLACKBOX_ARMED);
+}
+
+void blackbox_configure(Blackbox *bb, const RefloatConfig *config) {
+    uint32_t post_records = config->blackbox_post_ms * config->hertz / 1000;
+    bb->post_records = post_records > UINT16_MAX ? UINT16_MAX : post_records;
+}
+
+void blackbox_destroy(Blackbox *bb) {
+    if (bb->allocated) {
+        rb_free(&bb->rb);
+        bb->allocated = false;
+    }
+    bb->state = BLACKBOX_DISABLED;
+}
+
+void blackbox_record(Blackbox *bb, const Snapshot *s) {
+    if (bb->state == BLACKBOX_DISABLED) {
+        return;
+    }
+
+    if (__atomic_exchange_n(&bb->rearm_request, false, __ATOMIC_ACQUIRE)) {
+        rb_flush(&bb->rb);
+        bb->event = BLACKBOX_EVENT_NONE;
+        set_state(bb, BLACKBOX_ARMED);
+    }
+
+    if (bb->state == BLACKBOX_FROZEN) {
+        return;
+    }
+
+    uint8_t record[bb->record_size];
+    int32_t ind = 0;
+    telemetry_pack(s, BLACKBOX_MASK, record, &ind);
+
+    rb_insert_overwrite(&bb->rb, record);
+    bb->last_iteration = s->iteration;
+
+    if (bb->state == BLACKBOX_TRIGGERED) {
+        if (bb->post_left == 0) {
+            set_state(bb, BLACKBOX_FROZEN);
+        } else {
+            --bb->post_left;
+        }
+    }
+}
+
+void blackbox_trigger(Blackbox *bb, BlackboxEvent event, uint8_t stop_condition) {
+    if (bb->state == BLACKBOX_DISABLED || bb->state == BLACKBOX_FROZEN || event <= bb->event) {
+        return;
+    }
+
+    bb->event = event;
+    bb->stop_condition = stop_condition;
+    bb->trigger_iteration = bb->last_iteration + 1;
+    bb->post_left = bb->post_records;
+    set_state(bb, BLACKBOX_TRIGGERED);
+}
+
+BlackboxState blackbox_state(const Blackbox *bb) {
+    return __atomic_load_n(&bb->state, __ATOMIC_ACQUIRE);
+}
+
+uint16_t blackbox_record_count(Blackbox *bb) {
+    return bb->allocated ? rb_get_item_count(&bb->rb) : 0;
+}
+
+uint16_t blackbox_trigger_index(Blackbox *bb) {
+    return blackbox_record_count(bb) - 1 - (bb->last_iteration - bb->trigger_iteration);
+}
+
+uint16_t blackbox_read(Blackbox *bb, uint16_t first, uint8_t *buffer, uint16_t count) {
+    if (blackbox_state(bb) != BLACKBOX_FROZEN) {
+        return 0;
+    }
+    return rb_peek_multi(&bb->rb, first, buffer, count);
+}
+
+void blackbox_rearm(Blackbox *bb) {
+    __atomic_store_n(&bb->rearm_request, true, __ATOMIC_RELEASE);
+}
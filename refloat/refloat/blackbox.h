@@ -0,0 +1,126 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "snapshot.h"
+#include "telemetry.h"
+#include "conf/datatypes.h"
+
+#include "rb.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Fields of a black box record, ~28 bytes per loop iteration
+#define BLACKBOX_MASK                                                                              \
+    (1ULL << TF_STATE | 1ULL << TF_STOP_CONDITION | 1ULL << TF_FOOTPAD_STATE |                     \
+     1ULL << TF_WHEELSLIP | 1ULL << TF_PITCH | 1ULL << TF_BALANCE_PITCH | 1ULL << TF_ROLL |        \
+     1ULL << TF_ADC1 | 1ULL << TF_ADC2 | 1ULL << TF_ERPM | 1ULL << TF_DUTY_CYCLE |                 \
+     1ULL << TF_SETPOINT | 1ULL << TF_PID_VALUE | 1ULL << TF_RATE_P | 1ULL << TF_MOTOR_CURRENT)
+
+typedef enum {
+    BLACKBOX_DISABLED = 0,
+    BLACKBOX_ARMED,  // recording, waiting for an event
+    BLACKBOX_TRIGGERED,  // recording the time after an event
+    BLACKBOX_FROZEN  // holding the recording until rearmed
+} BlackboxState;
+
+// In the order of priority, a higher priority event during the time after an
+// event replaces it
+typedef enum {
+    BLACKBOX_EVENT_NONE = 0,
+    BLACKBOX_EVENT_WHEELSLIP,
+    BLACKBOX_EVENT_CURRENT_LIMIT,
+    BLACKBOX_EVENT_FAULT
+} BlackboxEvent;
+
+/**
+ * Black box recorder: the loop appends a record of every iteration to a ring
+ * holding the configured time before and after an event, the oldest record
+ * makes room for the newest. An event lets the ring record the time after it
+ * and then freezes it until it's rearmed, so the first event is kept.
+ *
+ * The loop does all the recording and state changes. The command handler
+ * only reads the frozen ring and posts rearm requests, which the loop picks
+ * up on its next record.
+ */
+typedef struct {
+    rb_t rb;
+    bool allocated;
+    uint8_t record_size;  // [bytes]
+    uint16_t post_records;
+
+    BlackboxState state;  // written by the loop, read by the command handler
+    bool rearm_request;
+
+    // Valid while frozen
+    BlackboxEvent event;
+    uint8_t stop_condition;
+    uint32_t last_iteration;  // loop iteration of the newest record
+    uint32_t trigger_iteration;  // loop iteration the event happened in
+    uint16_t post_left;
+} Blackbox;
+
+/**
+ * Allocates the ring for the configured durations, the black box stays
+ * disabled if they are 0 or the memory isn't available.
+ */
+void blackbox_init(Blackbox *bb, const RefloatConfig *config);
+
+/**
+ * Recomputes the records kept after an event for the loop frequency, the ring
+ * keeps the size it was allocated with.
+ */
+void blackbox_configure(Blackbox *bb, const RefloatConfig *config);
+
+void blackbox_destroy(Blackbox *bb);
+
+/**
+ * Call from the loop, once per iteration, with the snapshot just published.
+ */
+void blackbox_record(Blackbox *bb, const Snapshot *s);
+
+/**
+ * Call from the loop when an event happens, before the iteration's record.
+ * @p stop_condition is recorded with the fault events.
+ */
+void blackbox_trigger(Blackbox *bb, BlackboxEvent event, uint8_t stop_condition);
+
+BlackboxState blackbox_state(const Blackbox *bb);
+
+uint16_t blackbox_record_count(Blackbox *bb);
+
+/**
+ * Index of the record of the event's iteration, call only when frozen.
+ */
+uint16_t blackbox_trigger_index(Blackbox *bb);
+
+/**
+ * Copies up to @p count records from index @p first (0 is the oldest) into
+ * @p buffer. Returns the number of records copied, 0 if not frozen.
+ *
+ * Call from the command handler.
+ */
+uint16_t blackbox_read(Blackbox *bb, uint16_t first, uint8_t *buffer, uint16_t count);
+
+/**
+ * Discards the recording and starts recording for the next event.
+ *
+ * Call from the command handler.
+ */
+void blackbox_rearm(Blackbox *bb);
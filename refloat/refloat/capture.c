@@ -0,0 +1,130 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "capture.h"
+
+#include <stddef.h>
+
+static bool adopt_request(Capture *c) {
+    uint32_t seq = __atomic_load_n(&c->request_seq, __ATOMIC_ACQUIRE);
+    if (seq == c->last_seq || (seq & 1)) {
+        return false;
+    }
+
+    uint16_t batches = c->request_batches;
+    uint8_t samples = c->request_samples;
+    uint64_t mask = c->request_mask;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (seq != __atomic_load_n(&c->request_seq, __ATOMIC_RELAXED)) {
+        return false;
+    }
+    c->last_seq = seq;
+
+    mask &= TELEMETRY_MASK_ALL;
+    int32_t sample_size = telemetry_packed_size(mask);
+    if (batches == 0 || sample_size == 0 || sample_size > CAPTURE_BATCH_BYTES) {
+        c->batches_left = 0;
+        return true;
+    }
+
+    int32_t max_samples = CAPTURE_BATCH_BYTES / sample_size;
+    if (max_samples > UINT8_MAX) {
+        max_samples = UINT8_MAX;
+    }
+
+    c->mask = mask;
+    c->samples_per_batch = samples > 0 && samples < max_samples ? samples : max_samples;
+    c->batches_left = batches;
+    c->batches[c->filled % CAPTURE_BATCHES].samples = 0;
+    return true;
+}
+
+void capture_init(Capture *c) {
+    c->request_seq = 0;
+    c->request_batches = 0;
+    c->request_samples = 0;
+    c->request_mask = 0;
+    c->last_seq = 0;
+
+    c->mask = 0;
+    c->samples_per_batch = 0;
+    c->batches_left = 0;
+    c->sequence = 0;
+
+    c->filled = 0;
+    c->sent = 0;
+}
+
+void capture_request(Capture *c, uint16_t batches, uint8_t samples, uint64_t mask) {
+    __atomic_store_n(&c->request_seq, c->request_seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    c->request_batches = batches;
+    c->request_samples = samples;
+    c->request_mask = mask;
+    __atomic_store_n(&c->request_seq, c->request_seq + 1, __ATOMIC_RELEASE);
+}
+
+void capture_sample(Capture *c, const Snapshot *s, float period) {
+    adopt_request(c);
+
+    if (c->batches_left == 0) {
+        return;
+    }
+
+    // Only the loop writes filled
+    uint32_t filled = c->filled;
+    CaptureBatch *batch = &c->batches[filled % CAPTURE_BATCHES];
+    if (batch->samples == 0) {
+        batch->sequence = c->sequence;
+        batch->first_iteration = s->iteration;
+        batch->duration = 0;
+        batch->mask = c->mask;
+        batch->size = 0;
+    }
+
+    int32_t ind = batch->size;
+    telemetry_pack(s, c->mask, batch->data, &ind);
+    batch->size = ind;
+    batch->duration += period;
+    if (++batch->samples < c->samples_per_batch) {
+        return;
+    }
+
+    ++c->sequence;
+    --c->batches_left;
+    if (filled - __atomic_load_n(&c->sent, __ATOMIC_ACQUIRE) < CAPTURE_BATCHES - 1) {
+        // Hands the batch over to the telemetry thread
+        __atomic_store_n(&c->filled, ++filled, __ATOMIC_RELEASE);
+    }
+    // Otherwise the link can't keep up, the same batch gets refilled and the
+    // client sees the skipped sequence number
+    c->batches[filled % CAPTURE_BATCHES].samples = 0;
+}
+
+const CaptureBatch *capture_oldest(const Capture *c) {
+    if (c->sent == __atomic_load_n(&c->filled, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    return &c->batches[c->sent % CAPTURE_BATCHES];
+}
+
+void capture_release(Capture *c) {
+    if (c->sent != __atomic_load_n(&c->filled, __ATOMIC_ACQUIRE)) {
+        // Hands the batch back to the loop
+        __atomic_store_n(&c->sent, c->sent + 1, __ATOMIC_RELEASE);
+    }
+}
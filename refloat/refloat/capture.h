@@ -0,0 +1,106 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "snapshot.h"
+#include "telemetry.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CAPTURE_BATCH_BYTES 240
+// A power of 2, the batch counts in Capture wrap around
+#define CAPTURE_BATCHES 4
+
+// Fields captured when the request doesn't specify them
+#define CAPTURE_DEFAULT_MASK                                                                       \
+    (1ULL << TF_PITCH | 1ULL << TF_SETPOINT | 1ULL << TF_PID_VALUE | 1ULL << TF_RATE_P |            \
+     1ULL << TF_MOTOR_CURRENT | 1ULL << TF_ERPM)
+
+typedef struct {
+    uint16_t sequence;
+    uint32_t first_iteration;  // loop iteration of the first sample
+    float duration;  // sum of the measured loop periods of the samples [s]
+    uint64_t mask;
+    uint8_t samples;
+    uint8_t size;  // [bytes]
+    uint8_t data[CAPTURE_BATCH_BYTES];  // samples packed by telemetry_pack()
+} CaptureBatch;
+
+/**
+ * Full loop rate capture of a set of telemetry fields: every loop iteration
+ * appends a sample to the batch being filled, filled batches wait in a small
+ * ring until the telemetry thread sends them.
+ *
+ * Every batch gets the next sequence number, including those dropped
+ * because the ring was full, so the client sees gaps from both the ring and
+ * the link.
+ *
+ * The command handler posts the request under a sequence number, the loop
+ * picks it up on its next sample without waiting.
+ *
+ * The ring has a single producer and a single consumer: the loop only
+ * advances the count of filled batches, the telemetry thread only the count
+ * of sent ones. A batch belongs to the telemetry thread from the moment it's
+ * counted as filled until it's counted as sent.
+ */
+typedef struct {
+    // Posted by the command handler, the sequence number is odd while writing
+    uint32_t request_seq;
+    uint16_t request_batches;
+    uint8_t request_samples;
+    uint64_t request_mask;
+    uint32_t last_seq;
+
+    uint64_t mask;
+    uint8_t samples_per_batch;
+    uint16_t batches_left;  // including the one being filled, 0 when not capturing
+    uint16_t sequence;  // of the batch being filled
+
+    CaptureBatch batches[CAPTURE_BATCHES];
+    // Batch counts, wrapping around, the loop fills the batch at index
+    // filled % CAPTURE_BATCHES
+    uint32_t filled;
+    uint32_t sent;
+} Capture;
+
+void capture_init(Capture *c);
+
+/**
+ * Captures @p batches batches of @p samples samples (as many as fit if 0) of
+ * the fields in @p mask. 0 @p batches stops the capture, the batches already
+ * filled are still sent.
+ *
+ * Call from the command handler.
+ */
+void capture_request(Capture *c, uint16_t batches, uint8_t samples, uint64_t mask);
+
+/**
+ * Call from the loop, once per iteration, with the snapshot just published
+ * and the measured @p period of the iteration in seconds.
+ */
+void capture_sample(Capture *c, const Snapshot *s, float period);
+
+/**
+ * Returns the oldest filled batch or NULL, release it once sent.
+ *
+ * Call from the telemetry thread.
+ */
+const CaptureBatch *capture_oldest(const Capture *c);
+
+void capture_release(Capture *c);
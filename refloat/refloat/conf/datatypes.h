@@ -27,6 +27,18 @@ typedef enum {
     INPUTTILT_PPM
 } FLOAT_INPUTTILT_REMOTE_TYPE;
 
+typedef enum {
+    ACCEL_ESTIMATOR_MOVING_AVERAGE = 0,
+    ACCEL_ESTIMATOR_ALPHA_BETA,
+    ACCEL_ESTIMATOR_SAVITZKY_GOLAY,
+    ACCEL_ESTIMATOR_KALMAN,
+} AccelEstimatorType;
+
+typedef enum {
+    BF_PITCH_MAHONY = 0,
+    BF_PITCH_KALMAN,
+} BalanceFilterPitchEstimator;
+
 typedef enum {
     LED_TYPE_NONE = 0,
     LED_TYPE_RGB,
@@ -151,14 +163,32 @@ typedef struct {
     float mahony_kp_roll;
     float mahony_kp_yaw;
     float bf_accel_confidence_decay;
+    BalanceFilterPitchEstimator bf_pitch_estimator;
+    float bf_kalman_q_angle;
+    float bf_kalman_q_bias;
+    float bf_kalman_r_measure;
+    float gyro_notch_frequency;
+    float gyro_notch2_frequency;
+    float gyro_notch_q;
+    bool gyro_notch_auto;
     float kp_brake;
     float kp2_brake;
     uint16_t kp_brake_erpm;
     uint16_t hertz;
+    bool hertz_imu_sync;
+    float latency_compensation;
+    uint16_t blackbox_pre_ms;
+    uint16_t blackbox_post_ms;
+    bool blackbox_on_wheelslip;
+    bool blackbox_on_current_limit;
     float fault_pitch;
     float fault_roll;
     float fault_adc1;
     float fault_adc2;
+    uint16_t fault_adc_samples;
+    bool fault_adc_median;
+    float fault_adc_release;
+    float fault_adc_lift_rate;
     uint16_t fault_delay_pitch;
     uint16_t fault_delay_roll;
     uint16_t fault_delay_switch_half;
@@ -226,6 +256,7 @@ typedef struct {
     float atr_filter;
     float atr_amps_accel_ratio;
     float atr_amps_decel_ratio;
+    AccelEstimatorType accel_estimator;
     float braketilt_strength;
     float braketilt_lingering;
     float turntilt_strength;
@@ -19,35 +19,54 @@
 
 #include "vesc_c_if.h"
 
+void footpad_sensor_configure(FootpadSensor *fs, const RefloatConfig *config) {
+    FootpadFilter *filters[] = {&fs->filter1, &fs->filter2};
+    for (int i = 0; i < 2; ++i) {
+        footpad_filter_configure(
+            filters[i],
+            config->fault_adc_samples,
+            config->fault_adc_median,
+            config->fault_adc_release,
+            config->fault_adc_lift_rate,
+            config->hertz
+        );
+    }
+}
+
 void footpad_sensor_update(FootpadSensor *fs, const RefloatConfig *config) {
-    fs->adc1 = VESC_IF->io_read_analog(VESC_PIN_ADC1);
+    float adc1 = VESC_IF->io_read_analog(VESC_PIN_ADC1);
     // Returns -1.0 if the pin is missing on the hardware
-    fs->adc2 = VESC_IF->io_read_analog(VESC_PIN_ADC2);
-    if (fs->adc2 < 0.0) {
-        fs->adc2 = 0.0;
+    float adc2 = VESC_IF->io_read_analog(VESC_PIN_ADC2);
+    if (adc2 < 0.0) {
+        adc2 = 0.0;
     }
 
+    bool pad1 = footpad_filter_update(&fs->filter1, adc1, config->fault_adc1);
+    bool pad2 = footpad_filter_update(&fs->filter2, adc2, config->fault_adc2);
+    fs->adc1 = fs->filter1.value;
+    fs->adc2 = fs->filter2.value;
+
     fs->state = FS_NONE;
 
     if (config->fault_adc1 == 0 && config->fault_adc2 == 0) {  // No sensors
         fs->state = FS_BOTH;
     } else if (config->fault_adc2 == 0) {  // Single sensor on ADC1
-        if (fs->adc1 > config->fault_adc1) {
+        if (pad1) {
             fs->state = FS_BOTH;
         }
     } else if (config->fault_adc1 == 0) {  // Single sensor on ADC2
-        if (fs->adc2 > config->fault_adc2) {
+        if (pad2) {
             fs->state = FS_BOTH;
         }
     } else {  // Double sensor
-        if (fs->adc1 > config->fault_adc1) {
-            if (fs->adc2 > config->fault_adc2) {
+        if (pad1) {
+            if (pad2) {
                 fs->state = FS_BOTH;
             } else {
                 fs->state = FS_LEFT;
             }
         } else {
-            if (fs->adc2 > config->fault_adc2) {
+            if (pad2) {
                 fs->state = FS_RIGHT;
             }
         }
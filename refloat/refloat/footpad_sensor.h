@@ -19,6 +19,8 @@
 
 #include "conf/datatypes.h"
 
+#include "footpad_filter.h"
+
 typedef enum {
     FS_NONE = 0,
     FS_LEFT = 1,
@@ -27,10 +29,14 @@ typedef enum {
 } FootpadSensorState;
 
 typedef struct {
+    FootpadFilter filter1, filter2;
+    // Filtered ADC voltages
     float adc1, adc2;
     FootpadSensorState state;
 } FootpadSensor;
 
+void footpad_sensor_configure(FootpadSensor *fs, const RefloatConfig *config);
+
 void footpad_sensor_update(FootpadSensor *fs, const RefloatConfig *config);
 
 int footpad_sensor_state_to_switch_compat(FootpadSensorState v);
@@ -0,0 +1,103 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "imu_data.h"
+
+#include "utils.h"
+
+#include "fast_math.h"
+#include "vesc_c_if.h"
+
+#include <math.h>
+
+static void bypass(Biquad *biquad) {
+    biquad->a0 = 1.0f;
+    biquad->a1 = 0.0f;
+    biquad->a2 = 0.0f;
+    biquad->b1 = 0.0f;
+    biquad->b2 = 0.0f;
+}
+
+void imu_data_configure(ImuData *imu, const RefloatConfig *config) {
+    imu->dynamic_notch = -1;
+    imu->notch_q = config->gyro_notch_q;
+
+    for (int i = 0; i < 3; ++i) {
+        BiquadCascade *filters = &imu->gyro_filters[i];
+        biquad_cascade_clear(filters);
+
+        // Notches outside (0, hertz / 2) are not added
+        float notches[] = {config->gyro_notch_frequency, config->gyro_notch2_frequency};
+        for (unsigned int j = 0; j < sizeof(notches) / sizeof(notches[0]); ++j) {
+            biquad_cascade_add(
+                filters, BQ_NOTCH, notches[j] / config->hertz, config->gyro_notch_q, 0.0f
+            );
+        }
+
+        if (config->gyro_notch_auto &&
+            biquad_cascade_add(filters, BQ_NOTCH, 0.25f, config->gyro_notch_q, 0.0f)) {
+            imu->dynamic_notch = filters->count - 1;
+            bypass(&filters->stages[imu->dynamic_notch]);
+        }
+    }
+}
+
+void imu_data_set_dynamic_notch(ImuData *imu, float frequency) {
+    if (imu->dynamic_notch < 0) {
+        return;
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        // Only the coefficients change, the state carries over
+        Biquad *notch = &imu->gyro_filters[i].stages[imu->dynamic_notch];
+        if (frequency > 0.0f && frequency < 0.5f) {
+            biquad_configure_q(notch, BQ_NOTCH, frequency, imu->notch_q, 0.0f);
+        } else {
+            bypass(notch);
+        }
+    }
+}
+
+void imu_data_update(ImuData *imu, BalanceFilterData *balance_filter) {
+    ImuSnapshot *s = &imu->snapshots[imu->current ^ 1];
+
+    // One read of the firmware orientation instead of a getter per angle,
+    // same conversions as the firmware (and balance filter) getters, with the
+    // fast_math versions of the libm functions (errors below 1e-6 rad)
+    float q[4];
+    VESC_IF->imu_get_quaternions(q);
+
+    s->roll = rad2deg(-fast_atan2f(q[0] * q[1] + q[2] * q[3], 0.5f - (q[1] * q[1] + q[2] * q[2])));
+    s->pitch = rad2deg(fast_asinf(-2.0f * (q[1] * q[3] - q[0] * q[2])));
+
+    // The firmware yaw getter negates the angle
+    float gyro_derotated[3];
+    VESC_IF->imu_get_gyro_derotated(gyro_derotated);
+    s->yaw_rate = -gyro_derotated[2];
+
+    s->balance_pitch = rad2deg(balance_filter_get_pitch(balance_filter));
+    VESC_IF->imu_get_gyro(s->gyro_raw);
+    for (int i = 0; i < 3; ++i) {
+        s->gyro[i] = biquad_cascade_process(&imu->gyro_filters[i], s->gyro_raw[i]);
+    }
+
+    imu->current ^= 1;
+}
+
+const ImuSnapshot *imu_data_get(const ImuData *imu) {
+    return &imu->snapshots[imu->current];
+}
@@ -0,0 +1,71 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "balance_filter.h"
+#include "conf/datatypes.h"
+
+#include "biquad.h"
+
+#include <stdint.h>
+
+/**
+ * The IMU values of one loop iteration.
+ */
+typedef struct {
+    // [deg], from the firmware IMU orientation
+    float pitch;
+    float roll;
+    // [deg/s], derotated gyro Z, positive in the direction the firmware yaw
+    // angle increases
+    float yaw_rate;
+
+    float balance_pitch;  // [deg], from the balance filter
+    float gyro[3];  // [deg/s], through the gyro notch filters
+    float gyro_raw[3];  // [deg/s], before the notch filters
+} ImuSnapshot;
+
+/**
+ * Reads the IMU once per loop iteration and publishes the values as a
+ * snapshot, so that other threads don't need to query the firmware again.
+ *
+ * The snapshots are double-buffered, a published snapshot isn't modified
+ * until the next one is published.
+ */
+typedef struct {
+    ImuSnapshot snapshots[2];
+    volatile uint8_t current;
+
+    // Per axis, run at the loop frequency
+    BiquadCascade gyro_filters[3];
+    // Index of the notch moved by imu_data_set_dynamic_notch(), -1 if none
+    int8_t dynamic_notch;
+    float notch_q;
+} ImuData;
+
+void imu_data_configure(ImuData *imu, const RefloatConfig *config);
+
+/**
+ * Moves the dynamic notch (present when gyro_notch_auto is on) to @p frequency
+ * (normalized to the loop frequency), or bypasses it if the frequency is 0.
+ */
+void imu_data_set_dynamic_notch(ImuData *imu, float frequency);
+
+void imu_data_update(ImuData *imu, BalanceFilterData *balance_filter);
+
+const ImuSnapshot *imu_data_get(const ImuData *imu);
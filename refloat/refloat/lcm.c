@@ -69,13 +69,7 @@ void lcm_poll_request(LcmData *lcm, uint8_t *buffer, size_t len) {
     }
 }
 
-void lcm_poll_response(
-    LcmData *lcm,
-    const State *state,
-    FootpadSensorState fs_state,
-    const MotorData *motor,
-    const float pitch
-) {
+void lcm_poll_response(LcmData *lcm, const Snapshot *snapshot) {
     if (!lcm->enabled) {
         return;
     }
@@ -87,23 +81,23 @@ void lcm_poll_response(
     buffer[ind++] = 101;  // Package ID
     buffer[ind++] = COMMAND_LCM_POLL;
 
-    uint8_t send_state = state_compat(state) & 0xF;
-    send_state += fs_state << 4;
-    if (state->mode == MODE_HANDTEST) {
+    uint8_t send_state = state_compat(&snapshot->state) & 0xF;
+    send_state += snapshot->footpad_state << 4;
+    if (snapshot->state.mode == MODE_HANDTEST) {
         send_state |= 0x80;
     }
 
     buffer[ind++] = send_state;
     buffer[ind++] = VESC_IF->mc_get_fault();
 
-    if (state->state == STATE_RUNNING) {
-        buffer[ind++] = fminf(100, fabsf(motor->duty_cycle * 100));
+    if (snapshot->state.state == STATE_RUNNING) {
+        buffer[ind++] = fminf(100, fabsf(snapshot->duty_cycle * 100));
     } else {
         // pitch is a value between -180 and +180, so abs(pitch) fits into uint8
-        buffer[ind++] = lcm->lights_off_when_lifted ? fabsf(pitch) : 0;
+        buffer[ind++] = lcm->lights_off_when_lifted ? fabsf(snapshot->pitch) : 0;
     }
 
-    buffer_append_float16(buffer, motor->erpm, 1e0, &ind);
+    buffer_append_float16(buffer, snapshot->erpm, 1e0, &ind);
     buffer_append_float16(buffer, VESC_IF->mc_get_tot_current_in(), 1e0, &ind);
     buffer_append_float16(buffer, VESC_IF->mc_get_input_voltage_filtered(), 1e1, &ind);
 
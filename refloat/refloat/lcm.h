@@ -17,8 +17,7 @@
 
 #pragma once
 
-#include "footpad_sensor.h"
-#include "motor_data.h"
+#include "snapshot.h"
 #include "state.h"
 
 #include <stddef.h>
@@ -60,13 +59,7 @@ void lcm_poll_request(LcmData *lcm, uint8_t *buffer, size_t len);
 /**
  * Response to the LCM poll request to get data from the package.
  */
-void lcm_poll_response(
-    LcmData *lcm,
-    const State *state,
-    FootpadSensorState fs_state,
-    const MotorData *motor,
-    const float pitch
-);
+void lcm_poll_response(LcmData *lcm, const Snapshot *snapshot);
 
 /**
  * Command for apps to call to get info about lighting.
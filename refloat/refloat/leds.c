@@ -696,7 +696,7 @@ void leds_configure(Leds *leds, const CfgLeds *cfg) {
     leds->status_on_front_idle_time = current_time;
 }
 
-void leds_update(Leds *leds, const State *state, FootpadSensorState fs_state) {
+void leds_update(Leds *leds, const State *state, FootpadSensorState fs_state, float pitch) {
     if (!leds->led_data) {
         return;
     }
@@ -722,7 +722,7 @@ void leds_update(Leds *leds, const State *state, FootpadSensorState fs_state) {
         rate_limitf(&leds->on_off_fade, 0.0f, BR_RATE);
     }
 
-    leds->pitch = rad2deg(VESC_IF->imu_get_pitch());
+    leds->pitch = pitch;
 
     if (fs_state != FS_NONE) {
         leds->status_idle_time = current_time;
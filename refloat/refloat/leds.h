@@ -100,6 +100,6 @@ bool leds_init(Leds *leds, CfgHwLeds *hw_cfg, const CfgLeds *cfg, FootpadSensorS
 
 void leds_configure(Leds *leds, const CfgLeds *cfg);
 
-void leds_update(Leds *leds, const State *state, FootpadSensorState fs_state);
+void leds_update(Leds *leds, const State *state, FootpadSensorState fs_state, float pitch);
 
 void leds_destroy(Leds *leds);
@@ -0,0 +1,150 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "loop_timing.h"
+
+#include <float.h>
+#include <string.h>
+
+static void stats_reset(LoopTimingStats *stats) {
+    memset(stats, 0, sizeof(LoopTimingStats));
+    stats->compute_min = FLT_MAX;
+    stats->period_min = FLT_MAX;
+    stats->sample_age_min = FLT_MAX;
+}
+
+static void histogram_add(LoopTimingHistogram *histogram, float value, float bucket_width) {
+    int bucket = value / bucket_width;
+    if (bucket >= LOOP_TIMING_BUCKETS) {
+        bucket = LOOP_TIMING_BUCKETS - 1;
+    } else if (bucket < 0) {
+        bucket = 0;
+    }
+
+    if (histogram->buckets[bucket] == UINT16_MAX) {
+        // halve all buckets, keeps the shape of the distribution and makes
+        // it slowly favor recent samples
+        for (int i = 0; i < LOOP_TIMING_BUCKETS; ++i) {
+            histogram->buckets[i] /= 2;
+        }
+    }
+    ++histogram->buckets[bucket];
+}
+
+void loop_timing_reset(LoopTiming *lt) {
+    for (int i = 0; i < LOOP_TIMING_STATES; ++i) {
+        stats_reset(&lt->stats[i]);
+    }
+    memset(lt->stages, 0, sizeof(lt->stages));
+}
+
+void loop_timing_configure(LoopTiming *lt, float frequency) {
+    lt->bucket_width = 1.0f / frequency / LOOP_TIMING_BUCKETS_PER_PERIOD;
+    // the buckets are relative to the period, old samples would be misplaced
+    loop_timing_reset(lt);
+}
+
+void loop_timing_update(LoopTiming *lt, const Scheduler *scheduler, RunState state) {
+    if (state >= LOOP_TIMING_STATES) {
+        return;
+    }
+
+    LoopTimingStats *stats = &lt->stats[state];
+    float compute = scheduler->compute_time;
+    float period = scheduler->last_period;
+    float sample_age = scheduler->sample_age;
+
+    ++stats->iterations;
+    if (scheduler->overrun) {
+        ++stats->overruns;
+    }
+    if (scheduler->stale) {
+        ++stats->stale;
+    }
+
+    if (compute < stats->compute_min) {
+        stats->compute_min = compute;
+    }
+    if (compute > stats->compute_max) {
+        stats->compute_max = compute;
+    }
+    if (period < stats->period_min) {
+        stats->period_min = period;
+    }
+    if (period > stats->period_max) {
+        stats->period_max = period;
+    }
+    if (sample_age < stats->sample_age_min) {
+        stats->sample_age_min = sample_age;
+    }
+    if (sample_age > stats->sample_age_max) {
+        stats->sample_age_max = sample_age;
+    }
+
+    // running mean, avoids a sum that would overflow or lose precision
+    stats->compute_mean += (compute - stats->compute_mean) / stats->iterations;
+    stats->period_mean += (period - stats->period_mean) / stats->iterations;
+    stats->sample_age_mean += (sample_age - stats->sample_age_mean) / stats->iterations;
+
+    histogram_add(&stats->compute_histogram, compute, lt->bucket_width);
+    histogram_add(&stats->period_histogram, period, lt->bucket_width);
+    histogram_add(&stats->sample_age_histogram, sample_age, lt->bucket_width);
+}
+
+void loop_timing_stage_update(LoopTiming *lt, int stage, float time) {
+    if (stage < 0 || stage >= LOOP_TIMING_STAGES) {
+        return;
+    }
+
+    LoopTimingStage *s = &lt->stages[stage];
+    ++s->runs;
+    if (time > s->max) {
+        s->max = time;
+    }
+    s->mean += (time - s->mean) / s->runs;
+}
+
+void loop_timing_stage_skip(LoopTiming *lt, int stage) {
+    if (stage < 0 || stage >= LOOP_TIMING_STAGES) {
+        return;
+    }
+
+    ++lt->stages[stage].skips;
+}
+
+float loop_timing_p99(const LoopTiming *lt, const LoopTimingHistogram *histogram) {
+    uint32_t total = 0;
+    for (int i = 0; i < LOOP_TIMING_BUCKETS; ++i) {
+        total += histogram->buckets[i];
+    }
+
+    if (total == 0) {
+        return 0;
+    }
+
+    // the number of samples allowed above the percentile
+    uint32_t above_limit = total / 100;
+    uint32_t above = 0;
+    for (int i = LOOP_TIMING_BUCKETS - 1; i >= 0; --i) {
+        above += histogram->buckets[i];
+        if (above > above_limit) {
+            return (i + 1) * lt->bucket_width;
+        }
+    }
+
+    return lt->bucket_width;
+}
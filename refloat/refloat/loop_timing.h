@@ -0,0 +1,94 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "scheduler.h"
+#include "state.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define LOOP_TIMING_BUCKETS 24
+// Histogram bucket width as a fraction of the nominal loop period, the
+// buckets cover 0 to 1.5 periods, the last one collects everything above
+#define LOOP_TIMING_BUCKETS_PER_PERIOD 16
+#define LOOP_TIMING_STATES (STATE_RUNNING + 1)
+// Slots for the per-stage timing of the setpoint pipeline
+#define LOOP_TIMING_STAGES 8
+
+typedef struct {
+    uint16_t buckets[LOOP_TIMING_BUCKETS];
+} LoopTimingHistogram;
+
+// All times in seconds
+typedef struct {
+    uint32_t iterations;
+    uint32_t overruns;  // iterations which missed their deadline
+    uint32_t stale;  // iterations which ran without a new IMU sample
+
+    float compute_min, compute_mean, compute_max;
+    float period_min, period_mean, period_max;
+    // Age of the newest IMU sample at the start of the iteration
+    float sample_age_min, sample_age_mean, sample_age_max;
+
+    LoopTimingHistogram compute_histogram;
+    LoopTimingHistogram period_histogram;
+    LoopTimingHistogram sample_age_histogram;
+} LoopTimingStats;
+
+// Compute time of one setpoint stage, in seconds
+typedef struct {
+    uint32_t runs;
+    uint32_t skips;  // iterations the stage was planned, but idle
+    float mean, max;
+} LoopTimingStage;
+
+/**
+ * Always-on main loop instrumentation: compute time, period and IMU sample
+ * age of each iteration, collected separately for each RunState.
+ */
+typedef struct {
+    float bucket_width;
+    LoopTimingStats stats[LOOP_TIMING_STATES];
+    LoopTimingStage stages[LOOP_TIMING_STAGES];
+} LoopTiming;
+
+void loop_timing_reset(LoopTiming *lt);
+
+void loop_timing_configure(LoopTiming *lt, float frequency);
+
+/**
+ * Records the last iteration measured by the scheduler in @p state.
+ */
+void loop_timing_update(LoopTiming *lt, const Scheduler *scheduler, RunState state);
+
+/**
+ * Records a run of setpoint stage @p stage which took @p time seconds.
+ */
+void loop_timing_stage_update(LoopTiming *lt, int stage, float time);
+
+/**
+ * Records an iteration in which setpoint stage @p stage was skipped as idle.
+ */
+void loop_timing_stage_skip(LoopTiming *lt, int stage);
+
+/**
+ * Returns the upper bound of the histogram bucket containing the 99th
+ * percentile.
+ */
+float loop_timing_p99(const LoopTiming *lt, const LoopTimingHistogram *histogram);
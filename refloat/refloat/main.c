@@ -22,13 +22,24 @@
 #include "vesc_c_if.h"
 
 #include "atr.h"
+#include "blackbox.h"
+#include "capture.h"
 #include "charging.h"
 #include "footpad_sensor.h"
+#include "imu_data.h"
 #include "lcm.h"
 #include "leds.h"
+#include "loop_timing.h"
 #include "motor_data.h"
+#include "pitch_predictor.h"
+#include "rt_stream.h"
+#include "scheduler.h"
+#include "snapshot.h"
+#include "spectrum.h"
 #include "state.h"
+#include "telemetry.h"
 #include "torque_tilt.h"
+#include "tune_handoff.h"
 #include "utils.h"
 
 #include "conf/buffer.h"
@@ -62,27 +73,111 @@ static const FootpadSensorState flywheel_konami_sequence[] = {
     FS_LEFT, FS_NONE, FS_RIGHT, FS_NONE, FS_LEFT, FS_NONE, FS_RIGHT
 };
 
+typedef struct Data data;
+
+// Time constant of the turntilt yaw aggregate decay [s]
+#define YAW_AGGREGATE_LEAK_TIME 5.0f
+
+#define TELEMETRY_THREAD_HZ 100
+
+// Exponentially decaying setpoint adjustments are snapped to their target
+// below this difference [deg], so that they settle exactly and their stages
+// become idle, instead of decaying through denormals
+#define SETPOINT_SETTLE_EPSILON 1e-4f
+
+// Setpoint stages in the order they apply, the ids index the stage timing
+// in COMMAND_LOOP_TIMING and mustn't change
+typedef enum {
+    SETPOINT_STAGE_TARGET = 0,  // target and its interpolation, always runs
+    SETPOINT_STAGE_SURGE,
+    SETPOINT_STAGE_INPUTTILT,
+    SETPOINT_STAGE_NOSEANGLING,
+    SETPOINT_STAGE_TURNTILT,
+    SETPOINT_STAGE_TORQUETILT,
+    SETPOINT_STAGE_ATR,
+    SETPOINT_STAGE_COUNT
+} SetpointStageId;
+
+// A setpoint modifier stage of the balance loop
+typedef struct {
+    void (*apply)(data *d);
+    // Whether apply() would leave the setpoint and the stage state as they
+    // are, the stage is skipped then. NULL if the stage is never idle.
+    bool (*idle)(const data *d);
+    SetpointStageId id;
+    // A disabled feature's stage kept only until its offset winds down, it's
+    // dropped from the plan once idle
+    bool wind_down;
+} SetpointStage;
+
+#define SETPOINT_STAGES_MAX 4
+
+typedef struct {
+    float current;
+    float angle;
+    float ramp_mult;  // 1 / ramp
+} BoosterPlan;
+
+// The hot path of the balance loop compiled from float_conf by compile_plan(),
+// whenever the config changes. Disabled setpoint modifiers aren't part of the
+// plan at all, so they cost nothing, and idle ones are skipped at run time.
+// Modifiers disabled while riding stay in the plan until their offsets wind
+// down, so that the setpoint doesn't jump.
+typedef struct {
+    // Applied in all modes
+    SetpointStage setpoint_stages[SETPOINT_STAGES_MAX];
+    uint8_t setpoint_stage_count;
+
+    // Applied unless in darkride or wheelslip
+    SetpointStage tilt_stages[SETPOINT_STAGES_MAX];
+    uint8_t tilt_stage_count;
+
+    bool winding_down;  // some of the stages are wind_down ones
+
+    // Targets the brake scales blend into once rolling
+    float kp_brake_blend, kp2_brake_blend;
+
+    BoosterPlan booster;
+    BoosterPlan brkbooster;
+} ControlPlan;
+
 // This is all persistent state of the application, which will be allocated in init. It
 // is put here because variables can only be read-only when this program is loaded
 // in flash without virtual memory in RAM (as all RAM already is dedicated to the
 // main firmware and managed from there). This is probably the main limitation of
 // loading applications in runtime, but it is not too bad to work around.
-typedef struct {
+struct Data {
     lib_thread main_thread;
     lib_thread led_thread;
+    lib_thread telemetry_thread;
 
     RefloatConfig float_conf;
+    ControlPlan plan;
+    // Runtime tunes from the command handler, adopted by the loop
+    TuneHandoff tune_handoff;
+    // State for the LED, telemetry and LCM readers, published by the loop
+    SnapshotLock snapshot;
+    uint32_t iteration;
+    // Pushed realtime data, COMMAND_RTDATA_STREAM
+    RtStream rt_stream;
+    // Full loop rate captures, COMMAND_CAPTURE
+    Capture capture;
+    // Recording around the first fault, COMMAND_BLACKBOX
+    Blackbox blackbox;
 
     // Firmware version, passed in from Lisp
     int fw_version_major, fw_version_minor, fw_version_beta;
 
+    Scheduler scheduler;
+    LoopTiming loop_timing;
     MotorData motor;
     TorqueTilt torque_tilt;
     ATR atr;
+    PitchPredictor pitch_predictor;
 
     // Beeper
     int beep_num_left;
-    int beep_duration;
+    int beep_duration;  // in mid tier periods
     int beep_countdown;
     int beep_reason;
     bool beeper_enabled;
@@ -95,7 +190,6 @@ typedef struct {
     Charging charging;
 
     // Config values
-    uint32_t loop_time_us;
     unsigned int start_counter_clicks, start_counter_clicks_max;
     float startup_pitch_trickmargin, startup_pitch_tolerance;
     float startup_step_size;
@@ -112,11 +206,16 @@ typedef struct {
 
     // IMU data for the balancing filter
     BalanceFilterData balance_filter;
+    ImuData imu;
+
+    // Vibration analysis for the automatic gyro notch and COMMAND_SPECTRUM
+    Spectrum spectrum;
+    float spectrum_request_time;
 
     // Runtime values read from elsewhere
     float pitch, roll;
     float balance_pitch;
-    float gyro[3];
+    float balance_pitch_rate;  // [deg/s], from the gyro
 
     float throttle_val;
     float max_duty_with_margin;
@@ -124,7 +223,7 @@ typedef struct {
     FootpadSensor footpad_sensor;
 
     // Feature: Turntilt
-    float last_yaw_angle, yaw_angle, abs_yaw_change, last_yaw_change, yaw_change, yaw_aggregate;
+    float abs_yaw_change, yaw_change, yaw_aggregate;
     float turntilt_boost_per_erpm, yaw_aggregate_target;
 
     // Rumtime state values
@@ -185,12 +284,16 @@ typedef struct {
     float rc_current;
 
     Konami flywheel_konami;
-} data;
+};
 
 static void brake(data *d);
 static void set_current(data *d, float current);
+static void configure(data *d);
 static void flywheel_stop(data *d);
 static void cmd_flywheel_toggle(data *d, unsigned char *cfg, int len);
+static void send_rt_stream_frame(data *d);
+static void send_capture_batches(data *d);
+static void compile_plan(data *d);
 
 const VESC_PIN beeper_pin = VESC_PIN_PPM;
 
@@ -229,7 +332,7 @@ void beep_alert(data *d, int num_beeps, bool longbeep) {
     }
     if (d->beep_num_left == 0) {
         d->beep_num_left = num_beeps * 2 + 1;
-        d->beep_duration = longbeep ? 300 : 80;
+        d->beep_duration = longbeep ? 36 : 10;
         d->beep_countdown = d->beep_duration;
     }
 }
@@ -252,26 +355,19 @@ void beep_on(data *d, bool force) {
 }
 
 static void reconfigure(data *d) {
-    motor_data_configure(&d->motor, d->float_conf.atr_filter / d->float_conf.hertz);
+    motor_data_configure(&d->motor, &d->float_conf);
     balance_filter_configure(&d->balance_filter, &d->float_conf);
+    imu_data_configure(&d->imu, &d->float_conf);
+    footpad_sensor_configure(&d->footpad_sensor, &d->float_conf);
+    spectrum_configure(&d->spectrum, d->float_conf.hertz);
     torque_tilt_configure(&d->torque_tilt, &d->float_conf);
     atr_configure(&d->atr, &d->float_conf);
+    pitch_predictor_configure(&d->pitch_predictor, &d->float_conf);
+    compile_plan(d);
 }
 
-static void configure(data *d) {
-    state_init(&d->state, d->float_conf.disabled);
-
-    lcm_configure(&d->lcm, &d->float_conf.leds);
-
-    // This timer is used to determine how long the board has been disengaged / idle
-    d->disengage_timer = d->current_time;
-
-    // Loop time in microseconds
-    d->loop_time_us = 1e6 / d->float_conf.hertz;
-
-    // Loop time in seconds times 20 for a nice long grace period
-    d->motor_timeout_s = 20.0f / d->float_conf.hertz;
-
+// Values derived from the parts of the config runtime tunes can change
+static void configure_tune(data *d) {
     d->startup_step_size = d->float_conf.startup_speed / d->float_conf.hertz;
     d->tiltback_duty_step_size = d->float_conf.tiltback_duty_speed / d->float_conf.hertz;
     d->tiltback_hv_step_size = d->float_conf.tiltback_hv_speed / d->float_conf.hertz;
@@ -286,13 +382,111 @@ static void configure(data *d) {
     d->surge_angle3 = d->float_conf.surge_angle * 3;
     d->surge_enable = d->surge_angle > 0;
 
-    // Feature: Stealthy start vs normal start (noticeable click when engaging) - 0-20A
-    d->start_counter_clicks_max = 3;
-    // Feature: Soft Start
-    d->softstart_ramp_step_size = (float) 100 / d->float_conf.hertz;
     // Feature: Dirty Landings
     d->startup_pitch_trickmargin = d->float_conf.startup_dirtylandings_enabled ? 10 : 0;
 
+    // Feature: Turntilt
+    d->yaw_aggregate_target = fmaxf(50, d->float_conf.turntilt_yaw_aggregate);
+    d->turntilt_boost_per_erpm = (float) d->float_conf.turntilt_erpm_boost / 100.0 /
+        (float) d->float_conf.turntilt_erpm_boost_end;
+
+    // Speed above which to warn users about an impending full switch fault
+    d->switch_warn_beep_erpm = d->float_conf.is_footbeep_enabled ? 2000 : 100000;
+
+    // Variable nose angle adjustment / tiltback (setting is per 1000erpm, convert to per erpm)
+    d->tiltback_variable = d->float_conf.tiltback_variable / 1000;
+    if (d->tiltback_variable > 0) {
+        d->tiltback_variable_max_erpm =
+            fabsf(d->float_conf.tiltback_variable_max / d->tiltback_variable);
+    } else {
+        d->tiltback_variable_max_erpm = 100000;
+    }
+
+    d->beeper_enabled = d->float_conf.is_beeper_enabled;
+}
+
+// Adopts a runtime tune or a mode switch published by a command handler,
+// called at the start of a loop iteration
+static void adopt_tune(data *d) {
+    const TuneUpdate *update = tune_handoff_acquire(&d->tune_handoff);
+    if (!update) {
+        return;
+    }
+
+    d->float_conf = update->config;
+    TuneApply apply = update->apply;
+    if (update->current_max > 0) {
+        d->mc_current_max = update->current_max;
+    }
+    if (update->current_min > 0) {
+        d->mc_current_min = update->current_min;
+    }
+    tune_handoff_release(&d->tune_handoff);
+
+    if (apply == TUNE_APPLY_CONFIGURE) {
+        configure(d);
+        return;
+    }
+
+    configure_tune(d);
+    if (apply == TUNE_APPLY_RECONFIGURE) {
+        reconfigure(d);
+    } else {
+        compile_plan(d);
+    }
+}
+
+// With the loop synchronized to the IMU, it runs at a whole divisor of the IMU
+// rate, snap the configured frequency to it so that everything derived from it
+// matches the actual rate. Returns whether the frequency changed.
+static bool snap_hertz(data *d) {
+    if (!d->float_conf.hertz_imu_sync) {
+        return false;
+    }
+
+    float hertz = scheduler_imu_frequency(&d->scheduler, d->float_conf.hertz);
+    // Tolerate the residual jitter of the measured IMU rate
+    if (fabsf(hertz - d->float_conf.hertz) <= d->float_conf.hertz * 0.01f) {
+        return false;
+    }
+
+    d->float_conf.hertz = roundf(hertz);
+    return true;
+}
+
+// Values derived from the loop frequency, outside of the tune and the modules
+static void configure_rate(data *d) {
+    scheduler_configure(&d->scheduler, d->float_conf.hertz, d->float_conf.hertz_imu_sync);
+    loop_timing_configure(&d->loop_timing, d->float_conf.hertz);
+
+    // Loop time in seconds times 20 for a nice long grace period
+    d->motor_timeout_s = 20.0f / d->float_conf.hertz;
+
+    // Feature: Soft Start
+    d->softstart_ramp_step_size = (float) 100 / d->float_conf.hertz;
+
+    // Feature: Reverse Stop
+    d->reverse_stop_step_size = 100.0 / d->float_conf.hertz;
+
+    blackbox_configure(&d->blackbox, &d->float_conf);
+}
+
+static void configure(data *d) {
+    state_init(&d->state, d->float_conf.disabled);
+
+    lcm_configure(&d->lcm, &d->float_conf.leds);
+
+    // This timer is used to determine how long the board has been disengaged / idle
+    d->disengage_timer = d->current_time;
+
+    snap_hertz(d);
+    configure_rate(d);
+
+    configure_tune(d);
+
+    // Feature: Stealthy start vs normal start (noticeable click when engaging) - 0-20A
+    d->start_counter_clicks_max = 3;
+
     // Backwards compatibility hack:
     // If mahony kp from the firmware internal filter is higher than 1, it's
     // the old setup with it being the main balancing filter. In that case, set
@@ -316,12 +510,6 @@ static void configure(data *d) {
 
     // Feature: Reverse Stop
     d->reverse_tolerance = 50000;
-    d->reverse_stop_step_size = 100.0 / d->float_conf.hertz;
-
-    // Feature: Turntilt
-    d->yaw_aggregate_target = fmaxf(50, d->float_conf.turntilt_yaw_aggregate);
-    d->turntilt_boost_per_erpm = (float) d->float_conf.turntilt_erpm_boost / 100.0 /
-        (float) d->float_conf.turntilt_erpm_boost_end;
 
     // Feature: Darkride
     d->enable_upside_down = false;
@@ -333,20 +521,6 @@ static void configure(data *d) {
     // Allows smoothing of Remote Tilt
     d->inputtilt_ramped_step_size = 0;
 
-    // Speed above which to warn users about an impending full switch fault
-    d->switch_warn_beep_erpm = d->float_conf.is_footbeep_enabled ? 2000 : 100000;
-
-    // Variable nose angle adjustment / tiltback (setting is per 1000erpm, convert to per erpm)
-    d->tiltback_variable = d->float_conf.tiltback_variable / 1000;
-    if (d->tiltback_variable > 0) {
-        d->tiltback_variable_max_erpm =
-            fabsf(d->float_conf.tiltback_variable_max / d->tiltback_variable);
-    } else {
-        d->tiltback_variable_max_erpm = 100000;
-    }
-
-    d->beeper_enabled = d->float_conf.is_beeper_enabled;
-
     konami_init(&d->flywheel_konami, flywheel_konami_sequence, sizeof(flywheel_konami_sequence));
 
     reconfigure(d);
@@ -362,6 +536,7 @@ static void reset_vars(data *d) {
     motor_data_reset(&d->motor);
     atr_reset(&d->atr);
     torque_tilt_reset(&d->torque_tilt);
+    pitch_predictor_reset(&d->pitch_predictor);
 
     // Set values for startup
     d->setpoint = d->balance_pitch;
@@ -388,7 +563,7 @@ static void reset_vars(data *d) {
     d->kp2_accel_scale = 1.0;
 
     // Turntilt:
-    d->last_yaw_angle = 0;
+    d->yaw_change = 0;
     d->yaw_aggregate = 0;
 
     // Feature: click on start
@@ -683,6 +858,9 @@ static void calculate_setpoint_target(data *d) {
     {
         d->state.wheelslip = true;
         d->state.sat = SAT_NONE;
+        if (d->float_conf.blackbox_on_wheelslip) {
+            blackbox_trigger(&d->blackbox, BLACKBOX_EVENT_WHEELSLIP, 0);
+        }
         d->wheelslip_timer = d->current_time;
         if (d->state.darkride) {
             d->traction_control = true;
@@ -837,40 +1015,52 @@ static void calculate_setpoint_interpolated(data *d) {
         rate_limitf(
             &d->setpoint_target_interpolated,
             d->setpoint_target,
-            get_setpoint_adjustment_step_size(d)
+            get_setpoint_adjustment_step_size(d) * d->scheduler.dt_scale
         );
     }
 }
 
-static void add_surge(data *d) {
-    if (d->surge_enable) {
-        float surge_now = 0;
-
-        if (d->motor.duty_smooth > d->float_conf.surge_duty_start + 0.04) {
-            surge_now = d->surge_angle3;
-            beep_alert(d, 3, 1);
-        } else if (d->motor.duty_smooth > d->float_conf.surge_duty_start + 0.02) {
-            surge_now = d->surge_angle2;
-            beep_alert(d, 2, 1);
-        } else if (d->motor.duty_smooth > d->float_conf.surge_duty_start) {
-            surge_now = d->surge_angle;
-            beep_alert(d, 1, 1);
-        }
-        if (surge_now >= d->surge_adder) {
-            // kick in instantly
+// Moves the surge adder towards surge_now and adds it to the setpoint
+static void apply_surge_adder(data *d, float surge_now) {
+    if (surge_now >= d->surge_adder) {
+        // kick in instantly
+        d->surge_adder = surge_now;
+    } else {
+        // release less harshly
+        d->surge_adder = d->surge_adder * 0.98 + surge_now * 0.02;
+        if (d->surge_adder - surge_now < SETPOINT_SETTLE_EPSILON) {
             d->surge_adder = surge_now;
-        } else {
-            // release less harshly
-            d->surge_adder = d->surge_adder * 0.98 + surge_now * 0.02;
         }
+    }
 
-        // Add surge angle to setpoint
-        if (d->motor.erpm > 0) {
-            d->setpoint += d->surge_adder;
-        } else {
-            d->setpoint -= d->surge_adder;
-        }
+    // Add surge angle to setpoint
+    if (d->motor.erpm > 0) {
+        d->setpoint += d->surge_adder;
+    } else {
+        d->setpoint -= d->surge_adder;
+    }
+}
+
+static void add_surge(data *d) {
+    float surge_now = 0;
+
+    if (d->motor.duty_smooth > d->float_conf.surge_duty_start + 0.04) {
+        surge_now = d->surge_angle3;
+        beep_alert(d, 3, 1);
+    } else if (d->motor.duty_smooth > d->float_conf.surge_duty_start + 0.02) {
+        surge_now = d->surge_angle2;
+        beep_alert(d, 2, 1);
+    } else if (d->motor.duty_smooth > d->float_conf.surge_duty_start) {
+        surge_now = d->surge_angle;
+        beep_alert(d, 1, 1);
     }
+
+    apply_surge_adder(d, surge_now);
+}
+
+// Winds the surge of a disabled surge feature down like a released one
+static void release_surge(data *d) {
+    apply_surge_adder(d, 0);
 }
 
 static void apply_noseangling(data *d) {
@@ -890,7 +1080,11 @@ static void apply_noseangling(data *d) {
         noseangling_target += d->float_conf.tiltback_constant * d->motor.erpm_sign;
     }
 
-    rate_limitf(&d->noseangling_interpolated, noseangling_target, d->noseangling_step_size);
+    rate_limitf(
+        &d->noseangling_interpolated,
+        noseangling_target,
+        d->noseangling_step_size * d->scheduler.dt_scale
+    );
 
     d->setpoint += d->noseangling_interpolated;
 }
@@ -905,6 +1099,7 @@ static void apply_inputtilt(data *d) {
     input_tiltback_target *= (d->state.darkride ? -1.0 : 1.0);
 
     float input_tiltback_target_diff = input_tiltback_target - d->inputtilt_interpolated;
+    float step_size = d->inputtilt_step_size * d->scheduler.dt_scale;
 
     // Smoothen changes in tilt angle by ramping the step size
     if (d->float_conf.inputtilt_smoothing_factor > 0) {
@@ -921,13 +1116,13 @@ static void apply_inputtilt(data *d) {
             // Target step size is reduced the closer to center you are (needed for smoothly
             // transitioning away from center)
             d->inputtilt_ramped_step_size =
-                (smoothing_factor * d->inputtilt_step_size * (input_tiltback_target_diff / 2)) +
+                (smoothing_factor * step_size * (input_tiltback_target_diff / 2)) +
                 ((1 - smoothing_factor) * d->inputtilt_ramped_step_size);
             // Linearly ramped down step size is provided as minimum to prevent overshoot
             float centering_step_size =
                 fminf(
                     fabsf(d->inputtilt_ramped_step_size),
-                    fabsf(input_tiltback_target_diff / 2) * d->inputtilt_step_size
+                    fabsf(input_tiltback_target_diff / 2) * step_size
                 ) *
                 sign(input_tiltback_target_diff);
             if (fabsf(input_tiltback_target_diff) < fabsf(centering_step_size)) {
@@ -938,27 +1133,51 @@ static void apply_inputtilt(data *d) {
         } else {
             // Ramp up step size until the configured tilt speed is reached
             d->inputtilt_ramped_step_size =
-                (smoothing_factor * d->inputtilt_step_size * sign(input_tiltback_target_diff)) +
+                (smoothing_factor * step_size * sign(input_tiltback_target_diff)) +
                 ((1 - smoothing_factor) * d->inputtilt_ramped_step_size);
             d->inputtilt_interpolated += d->inputtilt_ramped_step_size;
         }
+
+        if (fabsf(input_tiltback_target - d->inputtilt_interpolated) < SETPOINT_SETTLE_EPSILON) {
+            d->inputtilt_interpolated = input_tiltback_target;
+        }
+        if (fabsf(d->inputtilt_ramped_step_size) < SETPOINT_SETTLE_EPSILON) {
+            d->inputtilt_ramped_step_size = 0;
+        }
     } else {
         // Constant step size; no smoothing
-        if (fabsf(input_tiltback_target_diff) < d->inputtilt_step_size) {
+        if (fabsf(input_tiltback_target_diff) < step_size) {
             d->inputtilt_interpolated = input_tiltback_target;
         } else {
-            d->inputtilt_interpolated += d->inputtilt_step_size * sign(input_tiltback_target_diff);
+            d->inputtilt_interpolated += step_size * sign(input_tiltback_target_diff);
         }
     }
 
     d->setpoint += d->inputtilt_interpolated;
 }
 
-static void apply_turntilt(data *d) {
-    if (d->float_conf.turntilt_strength == 0) {
-        return;
+// The yaw change per loop iteration, from the gyro rate [deg/s]. The yaw
+// aggregate leaks towards 0, so wiggling accumulates less than a turn.
+static void turntilt_yaw_update(data *d, float yaw_rate) {
+    float new_change = yaw_rate * d->scheduler.dt;
+
+    // To avoid overreactions at low speed, limit change here:
+    new_change = clampf(new_change, -0.10f, 0.10f);
+    d->yaw_change = d->yaw_change * 0.8f + 0.2f * new_change;
+    // Clear the aggregate yaw whenever we change direction
+    if (sign(d->yaw_change) != sign(d->yaw_aggregate)) {
+        d->yaw_aggregate = 0;
+    }
+    d->abs_yaw_change = fabsf(d->yaw_change);
+
+    d->yaw_aggregate -= d->yaw_aggregate * d->scheduler.dt / YAW_AGGREGATE_LEAK_TIME;
+    // don't count tiny yaw changes towards aggregate
+    if (d->abs_yaw_change > 0.04f) {
+        d->yaw_aggregate += d->yaw_change;
     }
+}
 
+static void apply_turntilt(data *d) {
     float abs_yaw_aggregate = fabsf(d->yaw_aggregate);
 
     // incremental turn increment since the last iteration
@@ -1032,10 +1251,211 @@ static void apply_turntilt(data *d) {
     }
 
     // Move towards target limited by max speed
-    rate_limitf(&d->turntilt_interpolated, d->turntilt_target, d->turntilt_step_size);
+    rate_limitf(
+        &d->turntilt_interpolated,
+        d->turntilt_target,
+        d->turntilt_step_size * d->scheduler.dt_scale
+    );
     d->setpoint += d->turntilt_interpolated;
 }
 
+static void apply_torque_tilt(data *d) {
+    torque_tilt_update(&d->torque_tilt, &d->motor, &d->float_conf, d->scheduler.dt);
+}
+
+static void apply_atr(data *d) {
+    atr_and_braketilt_update(&d->atr, &d->motor, &d->float_conf, d->proportional, d->scheduler.dt);
+}
+
+static void track_atr_accel_diff(data *d) {
+    atr_track_accel_diff(&d->atr, &d->motor);
+}
+
+static bool surge_idle(const data *d) {
+    return d->surge_adder == 0 && d->motor.duty_smooth <= d->float_conf.surge_duty_start;
+}
+
+static bool inputtilt_idle(const data *d) {
+    return d->throttle_val == 0 && d->inputtilt_interpolated == 0 &&
+        d->inputtilt_ramped_step_size == 0;
+}
+
+static bool turntilt_idle(const data *d) {
+    // Below the thresholds the target stays at 0
+    return d->turntilt_interpolated == 0 && d->turntilt_target == 0 &&
+        (fabsf(d->yaw_aggregate) < d->float_conf.turntilt_start_angle ||
+         d->abs_yaw_change < 0.04);
+}
+
+// The settled predicates of the disabled features' stages, the offsets only
+// wind down then
+static bool surge_settled(const data *d) {
+    return fabsf(d->surge_adder) < SETPOINT_SETTLE_EPSILON;
+}
+
+static bool inputtilt_settled(const data *d) {
+    return fabsf(d->inputtilt_interpolated) < SETPOINT_SETTLE_EPSILON;
+}
+
+static bool noseangling_settled(const data *d) {
+    return fabsf(d->noseangling_interpolated) < SETPOINT_SETTLE_EPSILON;
+}
+
+static bool turntilt_settled(const data *d) {
+    return fabsf(d->turntilt_interpolated) < SETPOINT_SETTLE_EPSILON;
+}
+
+static bool torque_tilt_settled(const data *d) {
+    return fabsf(d->torque_tilt.offset) < SETPOINT_SETTLE_EPSILON;
+}
+
+static bool atr_settled(const data *d) {
+    return fabsf(d->atr.offset) < SETPOINT_SETTLE_EPSILON &&
+        fabsf(d->atr.braketilt_offset) < SETPOINT_SETTLE_EPSILON;
+}
+
+static void plan_stage(
+    SetpointStage *stages,
+    uint8_t *count,
+    void (*apply)(data *d),
+    bool (*idle)(const data *d),
+    SetpointStageId id
+) {
+    stages[*count].apply = apply;
+    stages[*count].idle = idle;
+    stages[*count].id = id;
+    stages[*count].wind_down = false;
+    ++*count;
+}
+
+// Plans the stage of a feature disabled while riding, until its offset settles
+static void plan_wind_down(
+    ControlPlan *plan,
+    SetpointStage *stages,
+    uint8_t *count,
+    void (*apply)(data *d),
+    bool (*settled)(const data *d),
+    SetpointStageId id
+) {
+    plan_stage(stages, count, apply, settled, id);
+    stages[*count - 1].wind_down = true;
+    plan->winding_down = true;
+}
+
+static bool stages_wound_down(const data *d, const SetpointStage *stages, uint8_t count) {
+    for (int i = 0; i < count; ++i) {
+        if (stages[i].wind_down && !stages[i].idle(d)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void run_stages(data *d, const SetpointStage *stages, uint8_t count) {
+    for (int i = 0; i < count; ++i) {
+        const SetpointStage *stage = &stages[i];
+        if (stage->idle && stage->idle(d)) {
+            loop_timing_stage_skip(&d->loop_timing, stage->id);
+            continue;
+        }
+
+        uint32_t start = VESC_IF->timer_time_now();
+        stage->apply(d);
+        loop_timing_stage_update(
+            &d->loop_timing, stage->id, VESC_IF->timer_seconds_elapsed_since(start)
+        );
+    }
+}
+
+static void booster_plan(BoosterPlan *plan, float current, float angle, float ramp) {
+    plan->current = current;
+    plan->angle = angle;
+    // with no ramp, the booster applies fully right above the angle
+    plan->ramp_mult = ramp > 0 ? 1.0f / ramp : INFINITY;
+}
+
+static void compile_plan(data *d) {
+    const RefloatConfig *cfg = &d->float_conf;
+    ControlPlan *plan = &d->plan;
+    plan->winding_down = false;
+
+    // Disabled stages stay planned while riding until their offsets wind down,
+    // the offsets are only zeroed right away when the board isn't running
+    bool running = d->state.state == STATE_RUNNING;
+
+    SetpointStage *stages = plan->setpoint_stages;
+    uint8_t *count = &plan->setpoint_stage_count;
+    *count = 0;
+    if (d->surge_enable) {
+        plan_stage(stages, count, add_surge, surge_idle, SETPOINT_STAGE_SURGE);
+    } else if (running && !surge_settled(d)) {
+        plan_wind_down(plan, stages, count, release_surge, surge_settled, SETPOINT_STAGE_SURGE);
+    } else {
+        d->surge_adder = 0;
+    }
+    if (cfg->inputtilt_remote_type != INPUTTILT_NONE) {
+        plan_stage(stages, count, apply_inputtilt, inputtilt_idle, SETPOINT_STAGE_INPUTTILT);
+    } else if (running && !inputtilt_settled(d)) {
+        // Without a remote, the throttle reads 0 and the tilt returns to 0
+        plan_wind_down(
+            plan, stages, count, apply_inputtilt, inputtilt_settled, SETPOINT_STAGE_INPUTTILT
+        );
+    } else {
+        d->inputtilt_interpolated = 0;
+        d->inputtilt_ramped_step_size = 0;
+    }
+
+    stages = plan->tilt_stages;
+    count = &plan->tilt_stage_count;
+    *count = 0;
+    if (cfg->tiltback_variable != 0 || cfg->tiltback_constant != 0) {
+        plan_stage(stages, count, apply_noseangling, NULL, SETPOINT_STAGE_NOSEANGLING);
+    } else if (running && !noseangling_settled(d)) {
+        plan_wind_down(
+            plan, stages, count, apply_noseangling, noseangling_settled, SETPOINT_STAGE_NOSEANGLING
+        );
+    } else {
+        d->noseangling_interpolated = 0;
+    }
+    if (cfg->turntilt_strength != 0) {
+        plan_stage(stages, count, apply_turntilt, turntilt_idle, SETPOINT_STAGE_TURNTILT);
+    } else if (running && !turntilt_settled(d)) {
+        plan_wind_down(
+            plan, stages, count, apply_turntilt, turntilt_settled, SETPOINT_STAGE_TURNTILT
+        );
+    } else {
+        d->turntilt_target = 0;
+        d->turntilt_interpolated = 0;
+    }
+    if (cfg->torquetilt_strength != 0 || cfg->torquetilt_strength_regen != 0) {
+        plan_stage(stages, count, apply_torque_tilt, NULL, SETPOINT_STAGE_TORQUETILT);
+    } else if (running && !torque_tilt_settled(d)) {
+        plan_wind_down(
+            plan, stages, count, apply_torque_tilt, torque_tilt_settled, SETPOINT_STAGE_TORQUETILT
+        );
+    } else {
+        torque_tilt_reset(&d->torque_tilt);
+    }
+    if (cfg->atr_strength_up != 0 || cfg->atr_strength_down != 0 ||
+        cfg->braketilt_strength != 0) {
+        plan_stage(stages, count, apply_atr, NULL, SETPOINT_STAGE_ATR);
+    } else if (running && !atr_settled(d)) {
+        plan_wind_down(plan, stages, count, apply_atr, atr_settled, SETPOINT_STAGE_ATR);
+    } else {
+        atr_reset(&d->atr);
+        // No offsets, but the acceleration difference is still reported
+        plan_stage(stages, count, track_atr_accel_diff, NULL, SETPOINT_STAGE_ATR);
+    }
+
+    plan->kp_brake_blend = 0.01f * cfg->kp_brake;
+    plan->kp2_brake_blend = 0.01f * cfg->kp2_brake;
+
+    booster_plan(&plan->booster, cfg->booster_current, cfg->booster_angle, cfg->booster_ramp);
+    booster_plan(
+        &plan->brkbooster, cfg->brkbooster_current, cfg->brkbooster_angle, cfg->brkbooster_ramp
+    );
+}
+
 static void brake(data *d) {
     // Brake timeout logic
     float brake_timeout_length = 1;  // Brake Timeout hard-coded to 1s
@@ -1057,26 +1477,181 @@ static void set_current(data *d, float current) {
     VESC_IF->mc_set_current(current);
 }
 
+// The spectrum is only computed when the automatic notch needs it or a client
+// has asked for it recently
+static bool spectrum_active(const data *d) {
+    return d->float_conf.gyro_notch_auto || d->current_time - d->spectrum_request_time < 5.0f;
+}
+
+/**
+ * Housekeeping at about 100 Hz, for tasks that react to the rider.
+ */
+static void mid_tier_update(data *d) {
+    beeper_update(d);
+
+    // The spectrum is analyzed in the telemetry thread, the notch follows the
+    // ERPM here
+    if (d->float_conf.gyro_notch_auto) {
+        float frequency = spectrum_vibration_frequency(&d->spectrum, d->motor.abs_erpm);
+        imu_data_set_dynamic_notch(&d->imu, frequency / d->float_conf.hertz);
+    }
+
+    if (d->footpad_sensor.state == FS_NONE && d->state.state == STATE_RUNNING &&
+        d->state.mode != MODE_FLYWHEEL && d->motor.abs_erpm > d->switch_warn_beep_erpm) {
+        // If we're at riding speed and the switch is off => ALERT the user
+        // set force=true since this could indicate an imminent shutdown/nosedive
+        beep_on(d, true);
+        d->beep_reason = BEEP_SENSORS;
+    } else {
+        // if the switch comes back on we stop beeping
+        beep_off(d, false);
+    }
+
+    if (d->state.state != STATE_READY) {
+        return;
+    }
+
+    if (d->state.mode != MODE_FLYWHEEL && d->pitch > 75 && d->pitch < 105) {
+        if (konami_check(&d->flywheel_konami, &d->footpad_sensor, d->current_time)) {
+            unsigned char enabled[6] = {0x82, 0, 0, 0, 0, 1};
+            cmd_flywheel_toggle(d, enabled, 6);
+        }
+    }
+
+    if ((d->current_time - d->fault_angle_pitch_timer) > 1) {
+        // 1 second after disengaging - set startup tolerance back to normal (aka tighter)
+        d->startup_pitch_tolerance = d->float_conf.startup_pitch_tolerance;
+    }
+}
+
+/**
+ * Housekeeping at about 10 Hz, for timeouts in the order of seconds.
+ */
+static void slow_tier_update(data *d) {
+    charging_timeout(&d->charging, &d->state);
+
+    // The IMU rate is only known once the samples arrive, it's not available
+    // when the config is applied at startup
+    if (d->state.state != STATE_RUNNING && snap_hertz(d)) {
+        configure_rate(d);
+        configure_tune(d);
+        reconfigure(d);
+    }
+
+    if (d->state.state != STATE_READY) {
+        return;
+    }
+
+    if (d->current_time - d->disengage_timer > 10) {
+        // 10 seconds of grace period between flipping the board over and allowing darkride
+        // mode
+        if (d->state.darkride) {
+            beep_alert(d, 1, true);
+        }
+        d->enable_upside_down = false;
+        d->state.darkride = false;
+    }
+    if (d->current_time - d->disengage_timer > 1800) {  // alert user after 30 minutes
+        if (d->current_time - d->nag_timer > 60) {  // beep every 60 seconds
+            d->nag_timer = d->current_time;
+            float input_voltage = VESC_IF->mc_get_input_voltage_filtered();
+            if (input_voltage > d->idle_voltage) {
+                // don't beep if the voltage keeps increasing (board is charging)
+                d->idle_voltage = input_voltage;
+            } else {
+                d->beep_reason = BEEP_IDLE;
+                beep_alert(d, 2, 1);
+            }
+        }
+    } else {
+        d->nag_timer = d->current_time;
+        d->idle_voltage = 0;
+    }
+
+    check_odometer(d);
+}
+
 static void imu_ref_callback(float *acc, float *gyro, [[maybe_unused]] float *mag, float dt) {
     data *d = (data *) ARG;
     balance_filter_update(&d->balance_filter, gyro, acc, dt);
+    scheduler_imu_sample(&d->scheduler, dt);
+}
+
+// From the IMU sample to the motor acting on the current set in this iteration:
+// the sample age, the compute time until the current is set (the last
+// iteration's is the best estimate) and half a period of the current being held
+static float pitch_latency(const data *d) {
+    return d->scheduler.sample_age + d->scheduler.compute_time + 0.5f * d->scheduler.period;
+}
+
+static void publish_snapshot(data *d) {
+    Snapshot *s = snapshot_write_begin(&d->snapshot);
+
+    s->iteration = d->iteration;
+    s->state = d->state;
+    s->footpad_state = d->footpad_sensor.state;
+    s->beep_reason = d->beep_reason;
+
+    s->pitch = d->pitch;
+    s->balance_pitch = d->balance_pitch;
+    s->roll = d->roll;
+    s->imu_pitch = imu_data_get(&d->imu)->pitch;
+    s->adc1 = d->footpad_sensor.adc1;
+    s->adc2 = d->footpad_sensor.adc2;
+    s->throttle = d->throttle_val;
+
+    s->erpm = d->motor.erpm;
+    s->duty_cycle = d->motor.duty_cycle;
+
+    s->setpoint = d->setpoint;
+    s->atr_offset = d->atr.offset;
+    s->braketilt_offset = d->atr.braketilt_offset;
+    s->torque_tilt_offset = d->torque_tilt.offset;
+    s->turntilt = d->turntilt_interpolated;
+    s->inputtilt = d->inputtilt_interpolated;
+
+    s->pid_value = d->pid_value;
+    s->rate_p = d->rate_p;
+    s->current = d->motor.current;
+    s->atr_filtered_current = d->motor.atr_filtered_current;
+    s->atr_accel_diff = d->atr.accel_diff;
+    s->atr_speed_boost = d->atr.speed_boost;
+    s->booster_current = d->applied_booster_current;
+
+    s->charging_current = d->charging.current;
+    s->charging_voltage = d->charging.voltage;
+
+    snapshot_write_end(&d->snapshot);
 }
 
 static void refloat_thd(void *arg) {
     data *d = (data *) arg;
 
     configure(d);
+    scheduler_reset(&d->scheduler);
 
     while (!VESC_IF->should_terminate()) {
-        beeper_update(d);
+        scheduler_update(&d->scheduler);
+        loop_timing_update(&d->loop_timing, &d->scheduler, d->state.state);
 
-        charging_timeout(&d->charging, &d->state);
+        adopt_tune(d);
 
         d->current_time = VESC_IF->system_time();
 
-        d->pitch = rad2deg(VESC_IF->imu_get_pitch());
-        d->roll = rad2deg(VESC_IF->imu_get_roll());
-        d->balance_pitch = rad2deg(balance_filter_get_pitch(&d->balance_filter));
+        if (d->scheduler.mid_tier) {
+            mid_tier_update(d);
+        }
+        if (d->scheduler.slow_tier) {
+            slow_tier_update(d);
+        }
+
+        imu_data_update(&d->imu, &d->balance_filter);
+        const ImuSnapshot *imu = imu_data_get(&d->imu);
+
+        d->pitch = imu->pitch;
+        d->roll = imu->roll;
+        d->balance_pitch = imu->balance_pitch;
+        d->balance_pitch_rate = imu->gyro[1];
 
         // Darkride:
         if (d->float_conf.fault_darkride_enabled) {
@@ -1097,6 +1672,7 @@ static void refloat_thd(void *arg) {
             // flip sign and use offsets
             d->pitch = d->flywheel_pitch_offset - d->pitch;
             d->balance_pitch = d->pitch;
+            d->balance_pitch_rate = -d->balance_pitch_rate;
             d->roll -= d->flywheel_roll_offset;
             if (d->roll < -200) {
                 d->roll += 360;
@@ -1105,13 +1681,16 @@ static void refloat_thd(void *arg) {
             }
         } else if (d->state.darkride) {
             d->balance_pitch = -d->balance_pitch - d->darkride_setpoint_correction;
+            d->balance_pitch_rate = -d->balance_pitch_rate;
             d->pitch = -d->pitch - d->darkride_setpoint_correction;
         }
 
-        VESC_IF->imu_get_gyro(d->gyro);
-
         motor_data_update(&d->motor);
 
+        if (spectrum_active(d)) {
+            spectrum_sample(&d->spectrum, imu->gyro_raw[1], d->motor.current, d->motor.abs_erpm);
+        }
+
         bool remote_connected = false;
         float servo_val = 0;
 
@@ -1148,45 +1727,10 @@ static void refloat_thd(void *arg) {
         d->throttle_val = servo_val;
 
         // Turn Tilt:
-        d->yaw_angle = VESC_IF->imu_get_yaw() * 180.0f / M_PI;
-        float new_change = d->yaw_angle - d->last_yaw_angle;
-        bool unchanged = false;
-        if ((new_change == 0)  // Exact 0's only happen when the IMU is not updating between loops
-            || (fabsf(new_change) > 100))  // yaw flips signs at 180, ignore those changes
-        {
-            new_change = d->last_yaw_change;
-            unchanged = true;
-        }
-        d->last_yaw_change = new_change;
-        d->last_yaw_angle = d->yaw_angle;
-
-        // To avoid overreactions at low speed, limit change here:
-        new_change = fminf(new_change, 0.10);
-        new_change = fmaxf(new_change, -0.10);
-        d->yaw_change = d->yaw_change * 0.8 + 0.2 * (new_change);
-        // Clear the aggregate yaw whenever we change direction
-        if (sign(d->yaw_change) != sign(d->yaw_aggregate)) {
-            d->yaw_aggregate = 0;
-        }
-        d->abs_yaw_change = fabsf(d->yaw_change);
-        // don't count tiny yaw changes towards aggregate
-        if ((d->abs_yaw_change > 0.04) && !unchanged) {
-            d->yaw_aggregate += d->yaw_change;
-        }
+        turntilt_yaw_update(d, imu->yaw_rate);
 
         footpad_sensor_update(&d->footpad_sensor, &d->float_conf);
 
-        if (d->footpad_sensor.state == FS_NONE && d->state.state == STATE_RUNNING &&
-            d->state.mode != MODE_FLYWHEEL && d->motor.abs_erpm > d->switch_warn_beep_erpm) {
-            // If we're at riding speed and the switch is off => ALERT the user
-            // set force=true since this could indicate an imminent shutdown/nosedive
-            beep_on(d, true);
-            d->beep_reason = BEEP_SENSORS;
-        } else {
-            // if the switch comes back on we stop beeping
-            beep_off(d, false);
-        }
-
         float new_pid_value = 0;
 
         // Control Loop State Logic
@@ -1216,6 +1760,10 @@ static void refloat_thd(void *arg) {
         case (STATE_RUNNING):
             // Check for faults
             if (check_faults(d)) {
+                // Dismounts at walking speed aren't worth a recording
+                if (d->motor.abs_erpm > d->float_conf.fault_adc_half_erpm) {
+                    blackbox_trigger(&d->blackbox, BLACKBOX_EVENT_FAULT, d->state.stop_condition);
+                }
                 if (d->state.stop_condition == STOP_SWITCH_FULL && !d->state.darkride) {
                     // dirty landings: add extra margin when rightside up
                     d->startup_pitch_tolerance =
@@ -1230,11 +1778,17 @@ static void refloat_thd(void *arg) {
             d->disengage_timer = d->current_time;
 
             // Calculate setpoint and interpolation
+            uint32_t target_start = VESC_IF->timer_time_now();
             calculate_setpoint_target(d);
             calculate_setpoint_interpolated(d);
+            loop_timing_stage_update(
+                &d->loop_timing,
+                SETPOINT_STAGE_TARGET,
+                VESC_IF->timer_seconds_elapsed_since(target_start)
+            );
             d->setpoint = d->setpoint_target_interpolated;
-            add_surge(d);
-            apply_inputtilt(d);  // Allow Input Tilt for Darkride
+            // Surge and Input Tilt (allowed in Darkride too)
+            run_stages(d, d->plan.setpoint_stages, d->plan.setpoint_stage_count);
             if (!d->state.darkride) {
                 // in case of wheelslip, don't change torque tilts, instead slightly decrease each
                 // cycle
@@ -1242,10 +1796,7 @@ static void refloat_thd(void *arg) {
                     torque_tilt_winddown(&d->torque_tilt);
                     atr_and_braketilt_winddown(&d->atr);
                 } else {
-                    apply_noseangling(d);
-                    apply_turntilt(d);
-                    torque_tilt_update(&d->torque_tilt, &d->motor, &d->float_conf);
-                    atr_and_braketilt_update(&d->atr, &d->motor, &d->float_conf, d->proportional);
+                    run_stages(d, d->plan.tilt_stages, d->plan.tilt_stage_count);
                 }
 
                 // aggregated torque tilts:
@@ -1260,6 +1811,13 @@ static void refloat_thd(void *arg) {
                 }
             }
 
+            // Drop the stages of disabled features once they've wound down
+            if (d->plan.winding_down &&
+                stages_wound_down(d, d->plan.setpoint_stages, d->plan.setpoint_stage_count) &&
+                stages_wound_down(d, d->plan.tilt_stages, d->plan.tilt_stage_count)) {
+                compile_plan(d);
+            }
+
             // Prepare Brake Scaling (ramp scale values as needed for smooth transitions)
             if (d->motor.abs_erpm < 500) {
                 // All scaling should roll back to 1.0x when near a stop for a smooth stand-still
@@ -1271,8 +1829,8 @@ static void refloat_thd(void *arg) {
 
             } else if (d->motor.erpm > 0) {
                 // Once rolling forward, brakes should transition to scaled values
-                d->kp_brake_scale = 0.01 * d->float_conf.kp_brake + 0.99 * d->kp_brake_scale;
-                d->kp2_brake_scale = 0.01 * d->float_conf.kp2_brake + 0.99 * d->kp2_brake_scale;
+                d->kp_brake_scale = d->plan.kp_brake_blend + 0.99 * d->kp_brake_scale;
+                d->kp2_brake_scale = d->plan.kp2_brake_blend + 0.99 * d->kp2_brake_scale;
                 d->kp_accel_scale = 0.01 + 0.99 * d->kp_accel_scale;
                 d->kp2_accel_scale = 0.01 + 0.99 * d->kp2_accel_scale;
 
@@ -1281,12 +1839,22 @@ static void refloat_thd(void *arg) {
                 // scaled values
                 d->kp_brake_scale = 0.01 + 0.99 * d->kp_brake_scale;
                 d->kp2_brake_scale = 0.01 + 0.99 * d->kp2_brake_scale;
-                d->kp_accel_scale = 0.01 * d->float_conf.kp_brake + 0.99 * d->kp_accel_scale;
-                d->kp2_accel_scale = 0.01 * d->float_conf.kp2_brake + 0.99 * d->kp2_accel_scale;
+                d->kp_accel_scale = d->plan.kp_brake_blend + 0.99 * d->kp_accel_scale;
+                d->kp2_accel_scale = d->plan.kp2_brake_blend + 0.99 * d->kp2_accel_scale;
             }
 
             // Do PID maths
-            d->proportional = d->setpoint - d->balance_pitch;
+            float balance_pitch = d->balance_pitch;
+            if (d->pitch_predictor.strength > 0) {
+                balance_pitch = pitch_predictor_update(
+                    &d->pitch_predictor,
+                    d->balance_pitch,
+                    d->balance_pitch_rate,
+                    pitch_latency(d),
+                    d->scheduler.dt
+                );
+            }
+            d->proportional = d->setpoint - balance_pitch;
             bool tail_down = sign(d->proportional) != d->motor.erpm_sign;
 
             // Resume real PID maths
@@ -1317,7 +1885,7 @@ static void refloat_thd(void *arg) {
             if (d->start_counter_clicks == 0) {
 
                 // Rate P (Angle + Rate, rather than Angle-Rate Cascading)
-                float rate_prop = -d->gyro[1];
+                float rate_prop = -imu->gyro[1];
 
                 float scaled_rate_p;
                 // Choose appropriate scale based on board angle (this accomodates backwards riding)
@@ -1334,21 +1902,15 @@ static void refloat_thd(void *arg) {
                 float true_proportional = d->setpoint - d->atr.braketilt_offset - d->pitch;
                 float abs_proportional = fabsf(true_proportional);
 
-                float booster_current, booster_angle, booster_ramp;
-                if (tail_down) {
-                    booster_current = d->float_conf.brkbooster_current;
-                    booster_angle = d->float_conf.brkbooster_angle;
-                    booster_ramp = d->float_conf.brkbooster_ramp;
-                } else {
-                    booster_current = d->float_conf.booster_current;
-                    booster_angle = d->float_conf.booster_angle;
-                    booster_ramp = d->float_conf.booster_ramp;
-                }
+                const BoosterPlan *booster = tail_down ? &d->plan.brkbooster : &d->plan.booster;
+                float booster_current = booster->current;
+                float booster_angle = booster->angle;
 
                 // Make booster a bit stronger at higher speed (up to 2x stronger when braking)
                 const int boost_min_erpm = 3000;
                 if (d->motor.abs_erpm > boost_min_erpm) {
-                    float speedstiffness = fminf(1, (d->motor.abs_erpm - boost_min_erpm) / 10000);
+                    float speedstiffness =
+                        fminf(1, (d->motor.abs_erpm - boost_min_erpm) * (1.0f / 10000));
                     if (tail_down) {
                         // use higher current at speed when braking
                         booster_current += booster_current * speedstiffness;
@@ -1361,9 +1923,9 @@ static void refloat_thd(void *arg) {
                 }
 
                 if (abs_proportional > booster_angle) {
-                    if (abs_proportional - booster_angle < booster_ramp) {
-                        booster_current *= sign(true_proportional) *
-                            ((abs_proportional - booster_angle) / booster_ramp);
+                    float ramp_progress = (abs_proportional - booster_angle) * booster->ramp_mult;
+                    if (ramp_progress < 1) {
+                        booster_current *= sign(true_proportional) * ramp_progress;
                     } else {
                         booster_current *= sign(true_proportional);
                     }
@@ -1378,7 +1940,8 @@ static void refloat_thd(void *arg) {
 
                 if (d->softstart_pid_limit < d->mc_current_max) {
                     d->rate_p = fminf(fabs(d->rate_p), d->softstart_pid_limit) * sign(d->rate_p);
-                    d->softstart_pid_limit += d->softstart_ramp_step_size;
+                    d->softstart_pid_limit +=
+                        d->softstart_ramp_step_size * d->scheduler.dt_scale;
                 }
 
                 new_pid_value += d->rate_p;
@@ -1390,6 +1953,9 @@ static void refloat_thd(void *arg) {
             float current_limit = d->motor.braking ? d->mc_current_min : d->mc_current_max;
             if (fabsf(new_pid_value) > current_limit) {
                 new_pid_value = sign(new_pid_value) * current_limit;
+                if (d->float_conf.blackbox_on_current_limit) {
+                    blackbox_trigger(&d->blackbox, BLACKBOX_EVENT_CURRENT_LIMIT, 0);
+                }
             }
 
             if (d->traction_control) {
@@ -1422,46 +1988,6 @@ static void refloat_thd(void *arg) {
                 }
             }
 
-            if (d->state.mode != MODE_FLYWHEEL && d->pitch > 75 && d->pitch < 105) {
-                if (konami_check(&d->flywheel_konami, &d->footpad_sensor, d->current_time)) {
-                    unsigned char enabled[6] = {0x82, 0, 0, 0, 0, 1};
-                    cmd_flywheel_toggle(d, enabled, 6);
-                }
-            }
-
-            if (d->current_time - d->disengage_timer > 10) {
-                // 10 seconds of grace period between flipping the board over and allowing darkride
-                // mode
-                if (d->state.darkride) {
-                    beep_alert(d, 1, true);
-                }
-                d->enable_upside_down = false;
-                d->state.darkride = false;
-            }
-            if (d->current_time - d->disengage_timer > 1800) {  // alert user after 30 minutes
-                if (d->current_time - d->nag_timer > 60) {  // beep every 60 seconds
-                    d->nag_timer = d->current_time;
-                    float input_voltage = VESC_IF->mc_get_input_voltage_filtered();
-                    if (input_voltage > d->idle_voltage) {
-                        // don't beep if the voltage keeps increasing (board is charging)
-                        d->idle_voltage = input_voltage;
-                    } else {
-                        d->beep_reason = BEEP_IDLE;
-                        beep_alert(d, 2, 1);
-                    }
-                }
-            } else {
-                d->nag_timer = d->current_time;
-                d->idle_voltage = 0;
-            }
-
-            if ((d->current_time - d->fault_angle_pitch_timer) > 1) {
-                // 1 second after disengaging - set startup tolerance back to normal (aka tighter)
-                d->startup_pitch_tolerance = d->float_conf.startup_pitch_tolerance;
-            }
-
-            check_odometer(d);
-
             // Check for valid startup position and switch state
             if (fabsf(d->balance_pitch) < d->startup_pitch_tolerance &&
                 fabsf(d->roll) < d->float_conf.startup_roll_tolerance && is_engaged(d)) {
@@ -1504,11 +2030,17 @@ static void refloat_thd(void *arg) {
             break;
         }
 
-        VESC_IF->sleep_us(d->loop_time_us);
+        ++d->iteration;
+        publish_snapshot(d);
+        // The loop is the only writer, it can read the snapshot directly
+        capture_sample(&d->capture, &d->snapshot.snapshot, d->scheduler.last_period);
+        blackbox_record(&d->blackbox, &d->snapshot.snapshot);
+
+        scheduler_sleep(&d->scheduler);
     }
 }
 
-static void write_cfg_to_eeprom(data *d) {
+static void write_cfg_to_eeprom(data *d, const RefloatConfig *config) {
     uint32_t ints = sizeof(RefloatConfig) / 4 + 1;
     uint32_t *buffer = VESC_IF->malloc(ints * sizeof(uint32_t));
     if (!buffer) {
@@ -1517,7 +2049,7 @@ static void write_cfg_to_eeprom(data *d) {
     }
 
     bool write_ok = true;
-    memcpy(buffer, &(d->float_conf), sizeof(RefloatConfig));
+    memcpy(buffer, config, sizeof(RefloatConfig));
     for (uint32_t i = 0; i < ints; i++) {
         eeprom_var v;
         v.as_u32 = buffer[i];
@@ -1544,11 +2076,34 @@ static void led_thd(void *arg) {
     data *d = (data *) arg;
 
     while (!VESC_IF->should_terminate()) {
-        leds_update(&d->leds, &d->state, d->footpad_sensor.state);
+        Snapshot snapshot;
+        snapshot_read(&d->snapshot, &snapshot);
+        leds_update(&d->leds, &snapshot.state, snapshot.footpad_state, snapshot.imu_pitch);
         VESC_IF->sleep_us(1e6 / LEDS_REFRESH_RATE);
     }
 }
 
+/**
+ * Work that doesn't have to be done by the balance loop: analysis and
+ * telemetry, at a lower priority than the loop.
+ */
+static void telemetry_thd(void *arg) {
+    data *d = (data *) arg;
+
+    while (!VESC_IF->should_terminate()) {
+        spectrum_update(&d->spectrum);
+
+        // The frames are encoded from the snapshot, they need a larger stack
+        // than the loop can spare
+        if (rt_stream_update(&d->rt_stream)) {
+            send_rt_stream_frame(d);
+        }
+        send_capture_batches(d);
+
+        VESC_IF->sleep_us(1e6 / TELEMETRY_THREAD_HZ);
+    }
+}
+
 static void read_cfg_from_eeprom(RefloatConfig *config) {
     uint32_t ints = sizeof(RefloatConfig) / 4 + 1;
     uint32_t *buffer = VESC_IF->malloc(ints * sizeof(uint32_t));
@@ -1589,15 +2144,22 @@ static void data_init(data *d) {
     memset(d, 0, sizeof(data));
 
     read_cfg_from_eeprom(&d->float_conf);
+    tune_handoff_init(&d->tune_handoff);
+    rt_stream_init(&d->rt_stream);
+    capture_init(&d->capture);
+    blackbox_init(&d->blackbox, &d->float_conf);
 
     d->odometer = VESC_IF->mc_get_odometer();
 
     lcm_init(&d->lcm, &d->float_conf.hardware.leds);
     charging_init(&d->charging);
+
+    d->spectrum_request_time = -INFINITY;
 }
 
 static float app_get_debug(int index) {
     data *d = (data *) ARG;
+    const LoopTimingStats *loop_timing_stats = &d->loop_timing.stats[d->state.state];
 
     switch (index) {
     case (1):
@@ -1618,6 +2180,28 @@ static float app_get_debug(int index) {
         return d->motor.current;
     case (9):
         return d->motor.atr_filtered_current;
+    case (10):
+        return 1.0f / loop_timing_stats->period_mean;
+    case (11):
+        return loop_timing_stats->compute_mean * 1e6f;
+    case (12):
+        return loop_timing_stats->compute_max * 1e6f;
+    case (13):
+        return loop_timing_p99(&d->loop_timing, &loop_timing_stats->compute_histogram) * 1e6f;
+    case (14):
+        return loop_timing_p99(&d->loop_timing, &loop_timing_stats->period_histogram) * 1e6f;
+    case (15):
+        return loop_timing_stats->overruns;
+    case (16):
+        return loop_timing_stats->sample_age_mean * 1e6f;
+    case (17):
+        return loop_timing_p99(&d->loop_timing, &loop_timing_stats->sample_age_histogram) * 1e6f;
+    case (18):
+        return loop_timing_stats->stale;
+    case (19):
+        return d->pitch_predictor.latency * 1e6f;
+    case (20):
+        return d->pitch_predictor.offset;
     default:
         return 0;
     }
@@ -1647,8 +2231,22 @@ enum {
     // commands above 200 are unstable and can change protocol at any time
     COMMAND_GET_RTDATA_2 = 201,
     COMMAND_LIGHTS_CONTROL = 202,
+    COMMAND_LOOP_TIMING = 203,
+    COMMAND_SPECTRUM = 204,
+    COMMAND_RTDATA_STREAM = 205,
+    COMMAND_TELEMETRY_DESCRIBE = 206,
+    COMMAND_TELEMETRY_GET = 207,
+    COMMAND_RTDATA_STREAM_COMPACT = 208,
+    COMMAND_CAPTURE = 209,
+    COMMAND_BLACKBOX = 210,
 } Commands;
 
+typedef enum {
+    BLACKBOX_OP_STATUS = 0,
+    BLACKBOX_OP_READ = 1,
+    BLACKBOX_OP_REARM = 2,
+} BlackboxOp;
+
 static void send_realtime_data(data *d) {
     static const int bufsize = 72;
     uint8_t buffer[bufsize];
@@ -1656,41 +2254,45 @@ static void send_realtime_data(data *d) {
     buffer[ind++] = 101;  // Package ID
     buffer[ind++] = COMMAND_GET_RTDATA;
 
-    // RT Data
-    buffer_append_float32_auto(buffer, d->pid_value, &ind);
-    buffer_append_float32_auto(buffer, d->balance_pitch, &ind);
-    buffer_append_float32_auto(buffer, d->roll, &ind);
+    Snapshot snapshot;
+    snapshot_read(&d->snapshot, &snapshot);
+    const Snapshot *s = &snapshot;
 
-    uint8_t state = (state_compat(&d->state) & 0xF);
-    buffer[ind++] = (state & 0xF) + (sat_compat(&d->state) << 4);
-    state = footpad_sensor_state_to_switch_compat(d->footpad_sensor.state);
-    if (d->state.mode == MODE_HANDTEST) {
+    // RT Data
+    buffer_append_float32_auto(buffer, s->pid_value, &ind);
+    buffer_append_float32_auto(buffer, s->balance_pitch, &ind);
+    buffer_append_float32_auto(buffer, s->roll, &ind);
+
+    uint8_t state = (state_compat(&s->state) & 0xF);
+    buffer[ind++] = (state & 0xF) + (sat_compat(&s->state) << 4);
+    state = footpad_sensor_state_to_switch_compat(s->footpad_state);
+    if (s->state.mode == MODE_HANDTEST) {
         state |= 0x8;
     }
-    buffer[ind++] = (state & 0xF) + (d->beep_reason << 4);
-    buffer_append_float32_auto(buffer, d->footpad_sensor.adc1, &ind);
-    buffer_append_float32_auto(buffer, d->footpad_sensor.adc2, &ind);
+    buffer[ind++] = (state & 0xF) + (s->beep_reason << 4);
+    buffer_append_float32_auto(buffer, s->adc1, &ind);
+    buffer_append_float32_auto(buffer, s->adc2, &ind);
 
     // Setpoints
-    buffer_append_float32_auto(buffer, d->setpoint, &ind);
-    buffer_append_float32_auto(buffer, d->atr.offset, &ind);
-    buffer_append_float32_auto(buffer, d->atr.braketilt_offset, &ind);
-    buffer_append_float32_auto(buffer, d->torque_tilt.offset, &ind);
-    buffer_append_float32_auto(buffer, d->turntilt_interpolated, &ind);
-    buffer_append_float32_auto(buffer, d->inputtilt_interpolated, &ind);
+    buffer_append_float32_auto(buffer, s->setpoint, &ind);
+    buffer_append_float32_auto(buffer, s->atr_offset, &ind);
+    buffer_append_float32_auto(buffer, s->braketilt_offset, &ind);
+    buffer_append_float32_auto(buffer, s->torque_tilt_offset, &ind);
+    buffer_append_float32_auto(buffer, s->turntilt, &ind);
+    buffer_append_float32_auto(buffer, s->inputtilt, &ind);
 
     // DEBUG
-    buffer_append_float32_auto(buffer, d->pitch, &ind);
-    buffer_append_float32_auto(buffer, d->motor.atr_filtered_current, &ind);
-    buffer_append_float32_auto(buffer, d->atr.accel_diff, &ind);
-    if (d->state.charging) {
-        buffer_append_float32_auto(buffer, d->charging.current, &ind);
-        buffer_append_float32_auto(buffer, d->charging.voltage, &ind);
+    buffer_append_float32_auto(buffer, s->pitch, &ind);
+    buffer_append_float32_auto(buffer, s->atr_filtered_current, &ind);
+    buffer_append_float32_auto(buffer, s->atr_accel_diff, &ind);
+    if (s->state.charging) {
+        buffer_append_float32_auto(buffer, s->charging_current, &ind);
+        buffer_append_float32_auto(buffer, s->charging_voltage, &ind);
     } else {
-        buffer_append_float32_auto(buffer, d->applied_booster_current, &ind);
-        buffer_append_float32_auto(buffer, d->motor.current, &ind);
+        buffer_append_float32_auto(buffer, s->booster_current, &ind);
+        buffer_append_float32_auto(buffer, s->current, &ind);
     }
-    buffer_append_float32_auto(buffer, d->throttle_val, &ind);
+    buffer_append_float32_auto(buffer, s->throttle, &ind);
 
     SEND_APP_DATA(buffer, bufsize, ind);
 }
@@ -1710,35 +2312,41 @@ static void cmd_send_all_data(data *d, unsigned char mode) {
     } else {
         buffer[ind++] = mode;
 
+        Snapshot snapshot;
+        snapshot_read(&d->snapshot, &snapshot);
+        const Snapshot *s = &snapshot;
+
         // RT Data
-        buffer_append_float16(buffer, d->pid_value, 10, &ind);
-        buffer_append_float16(buffer, d->balance_pitch, 10, &ind);
-        buffer_append_float16(buffer, d->roll, 10, &ind);
+        buffer_append_float16(buffer, s->pid_value, 10, &ind);
+        buffer_append_float16(buffer, s->balance_pitch, 10, &ind);
+        buffer_append_float16(buffer, s->roll, 10, &ind);
 
-        uint8_t state = (state_compat(&d->state) & 0xF) + (sat_compat(&d->state) << 4);
+        uint8_t state = (state_compat(&s->state) & 0xF) + (sat_compat(&s->state) << 4);
         buffer[ind++] = state;
 
         // passed switch-state includes bit3 for handtest, and bits4..7 for beep reason
-        state = footpad_sensor_state_to_switch_compat(d->footpad_sensor.state);
-        if (d->state.mode == MODE_HANDTEST) {
+        state = footpad_sensor_state_to_switch_compat(s->footpad_state);
+        if (s->state.mode == MODE_HANDTEST) {
             state |= 0x8;
         }
-        buffer[ind++] = (state & 0xF) + (d->beep_reason << 4);
-        d->beep_reason = BEEP_NONE;
+        // The beep reason is reported once, read and cleared in one go so
+        // that a newer one set by the loop isn't lost
+        int beep_reason = __atomic_exchange_n(&d->beep_reason, BEEP_NONE, __ATOMIC_RELAXED);
+        buffer[ind++] = (state & 0xF) + (beep_reason << 4);
 
-        buffer[ind++] = d->footpad_sensor.adc1 * 50;
-        buffer[ind++] = d->footpad_sensor.adc2 * 50;
+        buffer[ind++] = s->adc1 * 50;
+        buffer[ind++] = s->adc2 * 50;
 
         // Setpoints (can be positive or negative)
-        buffer[ind++] = d->setpoint * 5 + 128;
-        buffer[ind++] = d->atr.offset * 5 + 128;
-        buffer[ind++] = d->atr.braketilt_offset * 5 + 128;
-        buffer[ind++] = d->torque_tilt.offset * 5 + 128;
-        buffer[ind++] = d->turntilt_interpolated * 5 + 128;
-        buffer[ind++] = d->inputtilt_interpolated * 5 + 128;
+        buffer[ind++] = s->setpoint * 5 + 128;
+        buffer[ind++] = s->atr_offset * 5 + 128;
+        buffer[ind++] = s->braketilt_offset * 5 + 128;
+        buffer[ind++] = s->torque_tilt_offset * 5 + 128;
+        buffer[ind++] = s->turntilt * 5 + 128;
+        buffer[ind++] = s->inputtilt * 5 + 128;
 
-        buffer_append_float16(buffer, d->pitch, 10, &ind);
-        buffer[ind++] = d->applied_booster_current + 128;
+        buffer_append_float16(buffer, s->pitch, 10, &ind);
+        buffer[ind++] = s->booster_current + 128;
 
         // Now send motor stuff:
         buffer_append_float16(buffer, VESC_IF->mc_get_input_voltage_filtered(), 10, &ind);
@@ -1775,8 +2383,8 @@ static void cmd_send_all_data(data *d, unsigned char mode) {
         }
         if (mode >= 4) {
             // make charge current and voltage available in mode 4
-            buffer_append_float16(buffer, d->charging.current, 10, &ind);
-            buffer_append_float16(buffer, d->charging.voltage, 10, &ind);
+            buffer_append_float16(buffer, s->charging_current, 10, &ind);
+            buffer_append_float16(buffer, s->charging_voltage, 10, &ind);
             // ind = 59
         }
     }
@@ -1794,12 +2402,23 @@ static void cmd_print_info([[maybe_unused]] data *d) {
 
 static void cmd_lock(data *d, unsigned char *cfg) {
     if (d->state.state < STATE_RUNNING) {
-        d->float_conf.disabled = cfg[0] ? true : false;
-        d->state.state = cfg[0] ? STATE_DISABLED : STATE_STARTUP;
-        write_cfg_to_eeprom(d);
+        TuneUpdate *update = tune_handoff_begin(&d->tune_handoff, &d->float_conf);
+        // configure() puts the state into STATE_DISABLED or STATE_STARTUP
+        update->config.disabled = cfg[0] ? true : false;
+        // The board isn't running, the adoption can wait for the EEPROM write
+        write_cfg_to_eeprom(d, &update->config);
+        tune_handoff_publish(&d->tune_handoff, TUNE_APPLY_CONFIGURE);
     }
 }
 
+// The loop adopts the config from EEPROM: configures everything anew when
+// leaving a special mode, reconfigures when reverting a tune
+static void restore_cfg(data *d, TuneApply apply) {
+    TuneUpdate *update = tune_handoff_begin(&d->tune_handoff, &d->float_conf);
+    read_cfg_from_eeprom(&update->config);
+    tune_handoff_publish(&d->tune_handoff, apply);
+}
+
 static void cmd_handtest(data *d, unsigned char *cfg) {
     if (d->state.state != STATE_READY) {
         return;
@@ -1811,72 +2430,76 @@ static void cmd_handtest(data *d, unsigned char *cfg) {
 
     d->state.mode = cfg[0] ? MODE_HANDTEST : MODE_NORMAL;
     if (d->state.mode == MODE_HANDTEST) {
+        TuneUpdate *update = tune_handoff_begin(&d->tune_handoff, &d->float_conf);
+        RefloatConfig *conf = &update->config;
         // temporarily reduce max currents to make hand test safer / gentler
-        d->mc_current_max = d->mc_current_min = 7;
+        update->current_max = update->current_min = 7;
         // Disable I-term and all tune modifiers and tilts
-        d->float_conf.ki = 0;
-        d->float_conf.kp_brake = 1;
-        d->float_conf.kp2_brake = 1;
-        d->float_conf.brkbooster_angle = 100;
-        d->float_conf.booster_angle = 100;
-        d->float_conf.torquetilt_strength = 0;
-        d->float_conf.torquetilt_strength_regen = 0;
-        d->float_conf.atr_strength_up = 0;
-        d->float_conf.atr_strength_down = 0;
-        d->float_conf.turntilt_strength = 0;
-        d->float_conf.tiltback_constant = 0;
-        d->float_conf.tiltback_variable = 0;
-        d->float_conf.fault_delay_pitch = 50;
-        d->float_conf.fault_delay_roll = 50;
+        conf->ki = 0;
+        conf->kp_brake = 1;
+        conf->kp2_brake = 1;
+        conf->brkbooster_angle = 100;
+        conf->booster_angle = 100;
+        conf->torquetilt_strength = 0;
+        conf->torquetilt_strength_regen = 0;
+        conf->atr_strength_up = 0;
+        conf->atr_strength_down = 0;
+        conf->turntilt_strength = 0;
+        conf->tiltback_constant = 0;
+        conf->tiltback_variable = 0;
+        conf->fault_delay_pitch = 50;
+        conf->fault_delay_roll = 50;
+        tune_handoff_publish(&d->tune_handoff, TUNE_APPLY_PLAN);
     } else {
-        read_cfg_from_eeprom(&d->float_conf);
-        configure(d);
+        restore_cfg(d, TUNE_APPLY_CONFIGURE);
     }
 }
 
 static void cmd_experiment(data *d, unsigned char *cfg) {
-    d->surge_angle = cfg[0];
-    d->surge_angle /= 10;
-    d->float_conf.surge_duty_start = cfg[1];
-    d->float_conf.surge_duty_start /= 100;
-    if ((d->surge_angle > 1) || (d->float_conf.surge_duty_start < 0.85)) {
-        d->float_conf.surge_duty_start = 0.85;
-        d->surge_angle = 0.6;
+    RefloatConfig *conf = &tune_handoff_begin(&d->tune_handoff, &d->float_conf)->config;
+
+    float surge_angle = cfg[0];
+    surge_angle /= 10;
+    conf->surge_duty_start = cfg[1];
+    conf->surge_duty_start /= 100;
+    if ((surge_angle > 1) || (conf->surge_duty_start < 0.85)) {
+        conf->surge_duty_start = 0.85;
+        // Keep surge enabled or disabled, as it is
+        surge_angle = conf->surge_angle > 0 ? 0.6 : 0;
     } else {
-        d->surge_enable = true;
         beep_alert(d, 2, 0);
     }
-    d->surge_angle2 = d->surge_angle * 2;
-    d->surge_angle3 = d->surge_angle * 3;
-
-    if (d->surge_angle == 0) {
-        d->surge_enable = false;
-    }
+    // Surge is enabled by a non-zero angle
+    conf->surge_angle = surge_angle;
+    tune_handoff_publish(&d->tune_handoff, TUNE_APPLY_PLAN);
 }
 
 static void cmd_booster(data *d, unsigned char *cfg) {
+    RefloatConfig *conf = &tune_handoff_begin(&d->tune_handoff, &d->float_conf)->config;
+
     int h1, h2;
     split(cfg[0], &h1, &h2);
-    d->float_conf.booster_angle = h1 + 5;
-    d->float_conf.booster_ramp = h2 + 2;
+    conf->booster_angle = h1 + 5;
+    conf->booster_ramp = h2 + 2;
 
     split(cfg[1], &h1, &h2);
     if (h1 == 0) {
-        d->float_conf.booster_current = 0;
+        conf->booster_current = 0;
     } else {
-        d->float_conf.booster_current = 8 + h1 * 2;
+        conf->booster_current = 8 + h1 * 2;
     }
 
     split(cfg[2], &h1, &h2);
-    d->float_conf.brkbooster_angle = h1 + 5;
-    d->float_conf.brkbooster_ramp = h2 + 2;
+    conf->brkbooster_angle = h1 + 5;
+    conf->brkbooster_ramp = h2 + 2;
 
     split(cfg[3], &h1, &h2);
     if (h1 == 0) {
-        d->float_conf.brkbooster_current = 0;
+        conf->brkbooster_current = 0;
     } else {
-        d->float_conf.brkbooster_current = 8 + h1 * 2;
+        conf->brkbooster_current = 8 + h1 * 2;
     }
+    tune_handoff_publish(&d->tune_handoff, TUNE_APPLY_PLAN);
 
     beep_alert(d, 1, false);
 }
@@ -1885,225 +2508,213 @@ static void cmd_booster(data *d, unsigned char *cfg) {
  * cmd_runtime_tune		Extract tune info from 20byte message but don't write to EEPROM!
  */
 static void cmd_runtime_tune(data *d, unsigned char *cfg, int len) {
+    TuneUpdate *update = tune_handoff_begin(&d->tune_handoff, &d->float_conf);
+    RefloatConfig *conf = &update->config;
+
     int h1, h2;
     if (len >= 12) {
         split(cfg[0], &h1, &h2);
-        d->float_conf.kp = h1 + 15;
-        d->float_conf.kp2 = ((float) h2) / 10;
+        conf->kp = h1 + 15;
+        conf->kp2 = ((float) h2) / 10;
 
         split(cfg[1], &h1, &h2);
-        d->float_conf.ki = h1;
+        conf->ki = h1;
         if (h1 == 1) {
-            d->float_conf.ki = 0.005;
+            conf->ki = 0.005;
         } else if (h1 > 1) {
-            d->float_conf.ki = ((float) (h1 - 1)) / 100;
+            conf->ki = ((float) (h1 - 1)) / 100;
         }
-        d->float_conf.ki_limit = h2 + 19;
+        conf->ki_limit = h2 + 19;
         if (h2 == 0) {
-            d->float_conf.ki_limit = 0;
+            conf->ki_limit = 0;
         }
 
         split(cfg[2], &h1, &h2);
-        d->float_conf.booster_angle = h1 + 5;
-        d->float_conf.booster_ramp = h2 + 2;
+        conf->booster_angle = h1 + 5;
+        conf->booster_ramp = h2 + 2;
 
         split(cfg[3], &h1, &h2);
         if (h1 == 0) {
-            d->float_conf.booster_current = 0;
+            conf->booster_current = 0;
         } else {
-            d->float_conf.booster_current = 8 + h1 * 2;
+            conf->booster_current = 8 + h1 * 2;
         }
-        d->float_conf.turntilt_strength = h2;
+        conf->turntilt_strength = h2;
 
         split(cfg[4], &h1, &h2);
-        d->float_conf.turntilt_angle_limit = (h1 & 0x3) + 2;
-        d->float_conf.turntilt_start_erpm = (float) (h1 >> 2) * 500 + 1000;
-        d->float_conf.mahony_kp = ((float) h2) / 10 + 1.5;
+        conf->turntilt_angle_limit = (h1 & 0x3) + 2;
+        conf->turntilt_start_erpm = (float) (h1 >> 2) * 500 + 1000;
+        conf->mahony_kp = ((float) h2) / 10 + 1.5;
 
         split(cfg[5], &h1, &h2);
         if (h1 == 0) {
-            d->float_conf.atr_strength_up = 0;
+            conf->atr_strength_up = 0;
         } else {
-            d->float_conf.atr_strength_up = ((float) h1) / 10.0 + 0.5;
+            conf->atr_strength_up = ((float) h1) / 10.0 + 0.5;
         }
         if (h2 == 0) {
-            d->float_conf.atr_strength_down = 0;
+            conf->atr_strength_down = 0;
         } else {
-            d->float_conf.atr_strength_down = ((float) h2) / 10.0 + 0.5;
+            conf->atr_strength_down = ((float) h2) / 10.0 + 0.5;
         }
 
         split(cfg[6], &h1, &h2);
-        d->float_conf.atr_speed_boost = ((float) (h2 * 5)) / 100;
+        conf->atr_speed_boost = ((float) (h2 * 5)) / 100;
         if (h1 != 0) {
-            d->float_conf.atr_speed_boost *= -1;
+            conf->atr_speed_boost *= -1;
         }
 
         split(cfg[7], &h1, &h2);
-        d->float_conf.atr_angle_limit = h1 + 5;
-        d->float_conf.atr_on_speed = (h2 & 0x3) + 3;
-        d->float_conf.atr_off_speed = (h2 >> 2) + 2;
+        conf->atr_angle_limit = h1 + 5;
+        conf->atr_on_speed = (h2 & 0x3) + 3;
+        conf->atr_off_speed = (h2 >> 2) + 2;
 
         split(cfg[8], &h1, &h2);
-        d->float_conf.atr_response_boost = ((float) h1) / 10 + 1;
-        d->float_conf.atr_transition_boost = ((float) h2) / 5 + 1;
+        conf->atr_response_boost = ((float) h1) / 10 + 1;
+        conf->atr_transition_boost = ((float) h2) / 5 + 1;
 
         split(cfg[9], &h1, &h2);
-        d->float_conf.atr_amps_accel_ratio = h1 + 5;
-        d->float_conf.atr_amps_decel_ratio = h2 + 5;
+        conf->atr_amps_accel_ratio = h1 + 5;
+        conf->atr_amps_decel_ratio = h2 + 5;
 
         split(cfg[10], &h1, &h2);
-        d->float_conf.braketilt_strength = h1;
-        d->float_conf.braketilt_lingering = h2;
+        conf->braketilt_strength = h1;
+        conf->braketilt_lingering = h2;
 
         split(cfg[11], &h1, &h2);
-        d->mc_current_max = h1 * 5 + 55;
-        d->mc_current_min = h2 * 5 + 55;
+        update->current_max = h1 * 5 + 55;
+        update->current_min = h2 * 5 + 55;
         if (h1 == 0) {
-            d->mc_current_max = VESC_IF->get_cfg_float(CFG_PARAM_l_current_max);
+            update->current_max = VESC_IF->get_cfg_float(CFG_PARAM_l_current_max);
         }
         if (h2 == 0) {
-            d->mc_current_min = fabsf(VESC_IF->get_cfg_float(CFG_PARAM_l_current_min));
+            update->current_min = fabsf(VESC_IF->get_cfg_float(CFG_PARAM_l_current_min));
         }
-
-        d->turntilt_step_size = d->float_conf.turntilt_speed / d->float_conf.hertz;
     }
     if (len >= 16) {
         split(cfg[12], &h1, &h2);
         float thup = h1;
         float thdown = h2;
-        d->float_conf.atr_threshold_up = thup / 2;
-        d->float_conf.atr_threshold_down = thdown / 2;
+        conf->atr_threshold_up = thup / 2;
+        conf->atr_threshold_down = thdown / 2;
 
         split(cfg[13], &h1, &h2);
         float ttup = h1;
         float ttdn = h2;
-        d->float_conf.torquetilt_strength = ttup / 10 * 0.3;
-        d->float_conf.torquetilt_strength_regen = ttdn / 10 * 0.3;
+        conf->torquetilt_strength = ttup / 10 * 0.3;
+        conf->torquetilt_strength_regen = ttdn / 10 * 0.3;
 
         split(cfg[14], &h1, &h2);
         float maxangle = h1;
-        d->float_conf.torquetilt_start_current = h2 + 15;
-        d->float_conf.torquetilt_angle_limit = maxangle / 2;
+        conf->torquetilt_start_current = h2 + 15;
+        conf->torquetilt_angle_limit = maxangle / 2;
 
         split(cfg[15], &h1, &h2);
         float onspd = h1;
         float offspd = h2;
-        d->float_conf.torquetilt_on_speed = onspd / 2;
-        d->float_conf.torquetilt_off_speed = offspd + 3;
+        conf->torquetilt_on_speed = onspd / 2;
+        conf->torquetilt_off_speed = offspd + 3;
     }
     if (len >= 17) {
         split(cfg[16], &h1, &h2);
-        d->float_conf.kp_brake = ((float) h1 + 1) / 10;
-        d->float_conf.kp2_brake = ((float) h2) / 10;
+        conf->kp_brake = ((float) h1 + 1) / 10;
+        conf->kp2_brake = ((float) h2) / 10;
         beep_alert(d, 1, 1);
     }
 
-    reconfigure(d);
+    tune_handoff_publish(&d->tune_handoff, TUNE_APPLY_RECONFIGURE);
 }
 
 static void cmd_tune_defaults(data *d) {
-    d->float_conf.kp = CFG_DFLT_KP;
-    d->float_conf.kp2 = CFG_DFLT_KP2;
-    d->float_conf.ki = CFG_DFLT_KI;
-    d->float_conf.mahony_kp = CFG_DFLT_MAHONY_KP;
-    d->float_conf.mahony_kp_roll = CFG_DFLT_MAHONY_KP_ROLL;
-    d->float_conf.mahony_kp_yaw = CFG_DFLT_MAHONY_KP_YAW;
-    d->float_conf.bf_accel_confidence_decay = CFG_DFLT_BF_ACCEL_CONFIDENCE_DECAY;
-    d->float_conf.kp_brake = CFG_DFLT_KP_BRAKE;
-    d->float_conf.kp2_brake = CFG_DFLT_KP2_BRAKE;
-    d->float_conf.ki_limit = CFG_DFLT_KI_LIMIT;
-    d->float_conf.booster_angle = CFG_DFLT_BOOSTER_ANGLE;
-    d->float_conf.booster_ramp = CFG_DFLT_BOOSTER_RAMP;
-    d->float_conf.booster_current = CFG_DFLT_BOOSTER_CURRENT;
-    d->float_conf.brkbooster_angle = CFG_DFLT_BRKBOOSTER_ANGLE;
-    d->float_conf.brkbooster_ramp = CFG_DFLT_BRKBOOSTER_RAMP;
-    d->float_conf.brkbooster_current = CFG_DFLT_BRKBOOSTER_CURRENT;
-    d->float_conf.turntilt_strength = CFG_DFLT_TURNTILT_STRENGTH;
-    d->float_conf.turntilt_angle_limit = CFG_DFLT_TURNTILT_ANGLE_LIMIT;
-    d->float_conf.turntilt_start_angle = CFG_DFLT_TURNTILT_START_ANGLE;
-    d->float_conf.turntilt_start_erpm = CFG_DFLT_TURNTILT_START_ERPM;
-    d->float_conf.turntilt_speed = CFG_DFLT_TURNTILT_SPEED;
-    d->float_conf.turntilt_erpm_boost = CFG_DFLT_TURNTILT_ERPM_BOOST;
-    d->float_conf.turntilt_erpm_boost_end = CFG_DFLT_TURNTILT_ERPM_BOOST_END;
-    d->float_conf.turntilt_yaw_aggregate = CFG_DFLT_TURNTILT_YAW_AGGREGATE;
-    d->float_conf.atr_strength_up = CFG_DFLT_ATR_UPHILL_STRENGTH;
-    d->float_conf.atr_strength_down = CFG_DFLT_ATR_DOWNHILL_STRENGTH;
-    d->float_conf.atr_threshold_up = CFG_DFLT_ATR_THRESHOLD_UP;
-    d->float_conf.atr_threshold_down = CFG_DFLT_ATR_THRESHOLD_DOWN;
-    d->float_conf.atr_speed_boost = CFG_DFLT_ATR_SPEED_BOOST;
-    d->float_conf.atr_angle_limit = CFG_DFLT_ATR_ANGLE_LIMIT;
-    d->float_conf.atr_on_speed = CFG_DFLT_ATR_ON_SPEED;
-    d->float_conf.atr_off_speed = CFG_DFLT_ATR_OFF_SPEED;
-    d->float_conf.atr_response_boost = CFG_DFLT_ATR_RESPONSE_BOOST;
-    d->float_conf.atr_transition_boost = CFG_DFLT_ATR_TRANSITION_BOOST;
-    d->float_conf.atr_filter = CFG_DFLT_ATR_FILTER;
-    d->float_conf.atr_amps_accel_ratio = CFG_DFLT_ATR_AMPS_ACCEL_RATIO;
-    d->float_conf.atr_amps_decel_ratio = CFG_DFLT_ATR_AMPS_DECEL_RATIO;
-    d->float_conf.braketilt_strength = CFG_DFLT_BRAKETILT_STRENGTH;
-    d->float_conf.braketilt_lingering = CFG_DFLT_BRAKETILT_LINGERING;
-
-    d->float_conf.startup_pitch_tolerance = CFG_DFLT_STARTUP_PITCH_TOLERANCE;
-    d->float_conf.startup_roll_tolerance = CFG_DFLT_STARTUP_ROLL_TOLERANCE;
-    d->float_conf.startup_speed = CFG_DFLT_STARTUP_SPEED;
-    d->float_conf.startup_click_current = CFG_DFLT_STARTUP_CLICK_CURRENT;
-    d->float_conf.brake_current = CFG_DFLT_BRAKE_CURRENT;
-    d->float_conf.is_beeper_enabled = CFG_DFLT_IS_BEEPER_ENABLED;
-    d->float_conf.tiltback_constant = CFG_DFLT_TILTBACK_CONSTANT;
-    d->float_conf.tiltback_constant_erpm = CFG_DFLT_TILTBACK_CONSTANT_ERPM;
-    d->float_conf.tiltback_variable = CFG_DFLT_TILTBACK_VARIABLE;
-    d->float_conf.tiltback_variable_max = CFG_DFLT_TILTBACK_VARIABLE_MAX;
-    d->float_conf.noseangling_speed = CFG_DFLT_NOSEANGLING_SPEED;
-    d->float_conf.startup_pushstart_enabled = CFG_DFLT_PUSHSTART_ENABLED;
-    d->float_conf.startup_simplestart_enabled = CFG_DFLT_SIMPLESTART_ENABLED;
-    d->float_conf.startup_dirtylandings_enabled = CFG_DFLT_DIRTYLANDINGS_ENABLED;
-
-    // Update values normally done in configure()
-    d->turntilt_step_size = d->float_conf.turntilt_speed / d->float_conf.hertz;
-
-    d->startup_step_size = d->float_conf.startup_speed / d->float_conf.hertz;
-    d->noseangling_step_size = d->float_conf.noseangling_speed / d->float_conf.hertz;
-    d->startup_pitch_trickmargin = d->float_conf.startup_dirtylandings_enabled ? 10 : 0;
-    d->tiltback_variable = d->float_conf.tiltback_variable / 1000;
-    if (d->tiltback_variable > 0) {
-        d->tiltback_variable_max_erpm =
-            fabsf(d->float_conf.tiltback_variable_max / d->tiltback_variable);
-    } else {
-        d->tiltback_variable_max_erpm = 100000;
-    }
-
-    reconfigure(d);
+    RefloatConfig *conf = &tune_handoff_begin(&d->tune_handoff, &d->float_conf)->config;
+
+    conf->kp = CFG_DFLT_KP;
+    conf->kp2 = CFG_DFLT_KP2;
+    conf->ki = CFG_DFLT_KI;
+    conf->mahony_kp = CFG_DFLT_MAHONY_KP;
+    conf->mahony_kp_roll = CFG_DFLT_MAHONY_KP_ROLL;
+    conf->mahony_kp_yaw = CFG_DFLT_MAHONY_KP_YAW;
+    conf->bf_accel_confidence_decay = CFG_DFLT_BF_ACCEL_CONFIDENCE_DECAY;
+    conf->kp_brake = CFG_DFLT_KP_BRAKE;
+    conf->kp2_brake = CFG_DFLT_KP2_BRAKE;
+    conf->ki_limit = CFG_DFLT_KI_LIMIT;
+    conf->booster_angle = CFG_DFLT_BOOSTER_ANGLE;
+    conf->booster_ramp = CFG_DFLT_BOOSTER_RAMP;
+    conf->booster_current = CFG_DFLT_BOOSTER_CURRENT;
+    conf->brkbooster_angle = CFG_DFLT_BRKBOOSTER_ANGLE;
+    conf->brkbooster_ramp = CFG_DFLT_BRKBOOSTER_RAMP;
+    conf->brkbooster_current = CFG_DFLT_BRKBOOSTER_CURRENT;
+    conf->turntilt_strength = CFG_DFLT_TURNTILT_STRENGTH;
+    conf->turntilt_angle_limit = CFG_DFLT_TURNTILT_ANGLE_LIMIT;
+    conf->turntilt_start_angle = CFG_DFLT_TURNTILT_START_ANGLE;
+    conf->turntilt_start_erpm = CFG_DFLT_TURNTILT_START_ERPM;
+    conf->turntilt_speed = CFG_DFLT_TURNTILT_SPEED;
+    conf->turntilt_erpm_boost = CFG_DFLT_TURNTILT_ERPM_BOOST;
+    conf->turntilt_erpm_boost_end = CFG_DFLT_TURNTILT_ERPM_BOOST_END;
+    conf->turntilt_yaw_aggregate = CFG_DFLT_TURNTILT_YAW_AGGREGATE;
+    conf->atr_strength_up = CFG_DFLT_ATR_UPHILL_STRENGTH;
+    conf->atr_strength_down = CFG_DFLT_ATR_DOWNHILL_STRENGTH;
+    conf->atr_threshold_up = CFG_DFLT_ATR_THRESHOLD_UP;
+    conf->atr_threshold_down = CFG_DFLT_ATR_THRESHOLD_DOWN;
+    conf->atr_speed_boost = CFG_DFLT_ATR_SPEED_BOOST;
+    conf->atr_angle_limit = CFG_DFLT_ATR_ANGLE_LIMIT;
+    conf->atr_on_speed = CFG_DFLT_ATR_ON_SPEED;
+    conf->atr_off_speed = CFG_DFLT_ATR_OFF_SPEED;
+    conf->atr_response_boost = CFG_DFLT_ATR_RESPONSE_BOOST;
+    conf->atr_transition_boost = CFG_DFLT_ATR_TRANSITION_BOOST;
+    conf->atr_filter = CFG_DFLT_ATR_FILTER;
+    conf->atr_amps_accel_ratio = CFG_DFLT_ATR_AMPS_ACCEL_RATIO;
+    conf->atr_amps_decel_ratio = CFG_DFLT_ATR_AMPS_DECEL_RATIO;
+    conf->braketilt_strength = CFG_DFLT_BRAKETILT_STRENGTH;
+    conf->braketilt_lingering = CFG_DFLT_BRAKETILT_LINGERING;
+
+    conf->startup_pitch_tolerance = CFG_DFLT_STARTUP_PITCH_TOLERANCE;
+    conf->startup_roll_tolerance = CFG_DFLT_STARTUP_ROLL_TOLERANCE;
+    conf->startup_speed = CFG_DFLT_STARTUP_SPEED;
+    conf->startup_click_current = CFG_DFLT_STARTUP_CLICK_CURRENT;
+    conf->brake_current = CFG_DFLT_BRAKE_CURRENT;
+    conf->is_beeper_enabled = CFG_DFLT_IS_BEEPER_ENABLED;
+    conf->tiltback_constant = CFG_DFLT_TILTBACK_CONSTANT;
+    conf->tiltback_constant_erpm = CFG_DFLT_TILTBACK_CONSTANT_ERPM;
+    conf->tiltback_variable = CFG_DFLT_TILTBACK_VARIABLE;
+    conf->tiltback_variable_max = CFG_DFLT_TILTBACK_VARIABLE_MAX;
+    conf->noseangling_speed = CFG_DFLT_NOSEANGLING_SPEED;
+    conf->startup_pushstart_enabled = CFG_DFLT_PUSHSTART_ENABLED;
+    conf->startup_simplestart_enabled = CFG_DFLT_SIMPLESTART_ENABLED;
+    conf->startup_dirtylandings_enabled = CFG_DFLT_DIRTYLANDINGS_ENABLED;
+
+    tune_handoff_publish(&d->tune_handoff, TUNE_APPLY_RECONFIGURE);
 }
 
 /**
  * cmd_runtime_tune_tilt: Extract settings from 20byte message but don't write to EEPROM!
  */
 static void cmd_runtime_tune_tilt(data *d, unsigned char *cfg, int len) {
+    RefloatConfig *conf = &tune_handoff_begin(&d->tune_handoff, &d->float_conf)->config;
+
     unsigned int flags = cfg[0];
     bool duty_beep = flags & 0x1;
-    d->float_conf.is_dutybeep_enabled = duty_beep;
+    conf->is_dutybeep_enabled = duty_beep;
     float retspeed = cfg[1];
     if (retspeed > 0) {
-        d->float_conf.tiltback_return_speed = retspeed / 10;
-        d->tiltback_return_step_size = d->float_conf.tiltback_return_speed / d->float_conf.hertz;
+        conf->tiltback_return_speed = retspeed / 10;
     }
-    d->float_conf.tiltback_duty = (float) cfg[2] / 100.0;
-    d->float_conf.tiltback_duty_angle = (float) cfg[3] / 10.0;
-    d->float_conf.tiltback_duty_speed = (float) cfg[4] / 10.0;
+    conf->tiltback_duty = (float) cfg[2] / 100.0;
+    conf->tiltback_duty_angle = (float) cfg[3] / 10.0;
+    conf->tiltback_duty_speed = (float) cfg[4] / 10.0;
 
     if (len >= 6) {
         float surge_duty_start = cfg[5];
         if (surge_duty_start > 0) {
-            d->float_conf.surge_duty_start = surge_duty_start / 100.0;
-            d->float_conf.surge_angle = (float) cfg[6] / 20.0;
-            d->surge_angle = d->float_conf.surge_angle;
-            d->surge_angle2 = d->float_conf.surge_angle * 2;
-            d->surge_angle3 = d->float_conf.surge_angle * 3;
-            d->surge_enable = d->surge_angle > 0;
+            conf->surge_duty_start = surge_duty_start / 100.0;
+            conf->surge_angle = (float) cfg[6] / 20.0;
         }
         beep_alert(d, 1, 1);
     } else {
         beep_alert(d, 3, 0);
     }
+
+    tune_handoff_publish(&d->tune_handoff, TUNE_APPLY_PLAN);
 }
 
 /**
@@ -2111,18 +2722,16 @@ static void cmd_runtime_tune_tilt(data *d, unsigned char *cfg, int len) {
  * EEPROM!
  */
 static void cmd_runtime_tune_other(data *d, unsigned char *cfg, int len) {
+    RefloatConfig *conf = &tune_handoff_begin(&d->tune_handoff, &d->float_conf)->config;
+
     unsigned int flags = cfg[0];
-    d->beeper_enabled = ((flags & 0x2) == 2);
-    d->float_conf.fault_reversestop_enabled = ((flags & 0x4) == 4);
-    d->float_conf.fault_is_dual_switch = ((flags & 0x8) == 8);
-    d->float_conf.fault_darkride_enabled = ((flags & 0x10) == 0x10);
-    bool dirty_landings = ((flags & 0x20) == 0x20);
-    d->float_conf.startup_simplestart_enabled = ((flags & 0x40) == 0x40);
-    d->float_conf.startup_pushstart_enabled = ((flags & 0x80) == 0x80);
-
-    d->float_conf.is_beeper_enabled = d->beeper_enabled;
-    d->startup_pitch_trickmargin = dirty_landings ? 10 : 0;
-    d->float_conf.startup_dirtylandings_enabled = dirty_landings;
+    conf->is_beeper_enabled = ((flags & 0x2) == 2);
+    conf->fault_reversestop_enabled = ((flags & 0x4) == 4);
+    conf->fault_is_dual_switch = ((flags & 0x8) == 8);
+    conf->fault_darkride_enabled = ((flags & 0x10) == 0x10);
+    conf->startup_dirtylandings_enabled = ((flags & 0x20) == 0x20);
+    conf->startup_simplestart_enabled = ((flags & 0x40) == 0x40);
+    conf->startup_pushstart_enabled = ((flags & 0x80) == 0x80);
 
     // startup
     float ctrspeed = cfg[1];
@@ -2131,12 +2740,11 @@ static void cmd_runtime_tune_other(data *d, unsigned char *cfg, int len) {
     float brakecurrent = cfg[4];
     float clickcurrent = cfg[5];
 
-    d->startup_step_size = ctrspeed / d->float_conf.hertz;
-    d->float_conf.startup_speed = ctrspeed;
-    d->float_conf.startup_pitch_tolerance = pitchtolerance / 10;
-    d->float_conf.startup_roll_tolerance = rolltolerance;
-    d->float_conf.brake_current = brakecurrent / 2;
-    d->float_conf.startup_click_current = clickcurrent;
+    conf->startup_speed = ctrspeed;
+    conf->startup_pitch_tolerance = pitchtolerance / 10;
+    conf->startup_roll_tolerance = rolltolerance;
+    conf->brake_current = brakecurrent / 2;
+    conf->startup_click_current = clickcurrent;
 
     // nose angling
     float tiltconst = cfg[6] - 100;
@@ -2146,38 +2754,28 @@ static void cmd_runtime_tune_other(data *d, unsigned char *cfg, int len) {
     float tiltvarmax = cfg[10];
 
     if (fabsf(tiltconst) <= 20) {
-        d->float_conf.tiltback_constant = tiltconst / 2;
-        d->float_conf.tiltback_constant_erpm = tilterpm;
+        conf->tiltback_constant = tiltconst / 2;
+        conf->tiltback_constant_erpm = tilterpm;
         if (tiltspeed > 0) {
-            d->noseangling_step_size = tiltspeed / 10 / d->float_conf.hertz;
-            d->float_conf.noseangling_speed = tiltspeed / 10;
-        }
-        d->float_conf.tiltback_variable = tiltvarrate / 100;
-        d->float_conf.tiltback_variable_max = tiltvarmax / 10;
-
-        d->startup_step_size = d->float_conf.startup_speed / d->float_conf.hertz;
-        d->noseangling_step_size = d->float_conf.noseangling_speed / d->float_conf.hertz;
-        d->tiltback_variable = d->float_conf.tiltback_variable / 1000;
-        if (d->tiltback_variable > 0) {
-            d->tiltback_variable_max_erpm =
-                fabsf(d->float_conf.tiltback_variable_max / d->tiltback_variable);
-        } else {
-            d->tiltback_variable_max_erpm = 100000;
+            conf->noseangling_speed = tiltspeed / 10;
         }
-        d->float_conf.tiltback_variable_erpm = cfg[11] * 100;
+        conf->tiltback_variable = tiltvarrate / 100;
+        conf->tiltback_variable_max = tiltvarmax / 10;
+        conf->tiltback_variable_erpm = cfg[11] * 100;
     }
 
     if (len >= 14) {
         int inputtilt = cfg[12] & 0x3;
         if (inputtilt <= INPUTTILT_PPM) {
-            d->float_conf.inputtilt_remote_type = inputtilt;
+            conf->inputtilt_remote_type = inputtilt;
             if (inputtilt > 0) {
-                d->float_conf.inputtilt_angle_limit = cfg[12] >> 2;
-                d->float_conf.inputtilt_speed = cfg[13];
-                d->inputtilt_step_size = d->float_conf.inputtilt_speed / d->float_conf.hertz;
+                conf->inputtilt_angle_limit = cfg[12] >> 2;
+                conf->inputtilt_speed = cfg[13];
             }
         }
     }
+
+    tune_handoff_publish(&d->tune_handoff, TUNE_APPLY_PLAN);
 }
 
 void cmd_rc_move(data *d, unsigned char *cfg) {
@@ -2251,78 +2849,80 @@ static void cmd_flywheel_toggle(data *d, unsigned char *cfg, int len) {
         }
         d->flywheel_abort = false;
 
+        // The toggle runs in the command handler or, from the konami, in the
+        // loop. Either way the loop adopts the flywheel config as a whole.
+        TuneUpdate *update = tune_handoff_begin(&d->tune_handoff, &d->float_conf);
+        RefloatConfig *conf = &update->config;
+
         // Tighter startup/fault tolerances
         d->startup_pitch_tolerance = 0.2;
-        d->float_conf.startup_pitch_tolerance = 0.2;
-        d->float_conf.startup_roll_tolerance = 25;
-        d->float_conf.fault_pitch = 6;
-        d->float_conf.fault_roll = 35;  // roll can fluctuate significantly in the upright position
+        conf->startup_pitch_tolerance = 0.2;
+        conf->startup_roll_tolerance = 25;
+        conf->fault_pitch = 6;
+        conf->fault_roll = 35;  // roll can fluctuate significantly in the upright position
         if (command & 0x4) {
-            d->float_conf.fault_roll = 90;
+            conf->fault_roll = 90;
         }
-        d->float_conf.fault_delay_pitch = 50;  // 50ms delay should help filter out IMU noise
-        d->float_conf.fault_delay_roll = 50;  // 50ms delay should help filter out IMU noise
-        d->surge_enable = false;
+        conf->fault_delay_pitch = 50;  // 50ms delay should help filter out IMU noise
+        conf->fault_delay_roll = 50;  // 50ms delay should help filter out IMU noise
+        // Disables surge
+        conf->surge_angle = 0;
 
         // Aggressive P with some D (aka Rate-P) for Mahony kp=0.3
-        d->float_conf.kp = 8.0;
-        d->float_conf.kp2 = 0.3;
+        conf->kp = 8.0;
+        conf->kp2 = 0.3;
 
         if (cfg[1] > 0) {
-            d->float_conf.kp = cfg[1];
-            d->float_conf.kp /= 10;
+            conf->kp = cfg[1];
+            conf->kp /= 10;
         }
         if (cfg[2] > 0) {
-            d->float_conf.kp2 = cfg[2];
-            d->float_conf.kp2 /= 100;
+            conf->kp2 = cfg[2];
+            conf->kp2 /= 100;
         }
 
-        d->float_conf.tiltback_duty_angle = 2;
-        d->float_conf.tiltback_duty = 0.1;
-        d->float_conf.tiltback_duty_speed = 5;
-        d->float_conf.tiltback_return_speed = 5;
+        conf->tiltback_duty_angle = 2;
+        conf->tiltback_duty = 0.1;
+        conf->tiltback_duty_speed = 5;
+        conf->tiltback_return_speed = 5;
 
         if (cfg[3] > 0) {
-            d->float_conf.tiltback_duty_angle = cfg[3];
-            d->float_conf.tiltback_duty_angle /= 10;
+            conf->tiltback_duty_angle = cfg[3];
+            conf->tiltback_duty_angle /= 10;
         }
         if (cfg[4] > 0) {
-            d->float_conf.tiltback_duty = cfg[4];
-            d->float_conf.tiltback_duty /= 100;
+            conf->tiltback_duty = cfg[4];
+            conf->tiltback_duty /= 100;
         }
         if ((len > 6) && (cfg[6] > 1) && (cfg[6] < 100)) {
-            d->float_conf.tiltback_duty_speed = cfg[6] / 2;
-            d->float_conf.tiltback_return_speed = cfg[6] / 2;
+            conf->tiltback_duty_speed = cfg[6] / 2;
+            conf->tiltback_return_speed = cfg[6] / 2;
         }
-        d->tiltback_duty_step_size = d->float_conf.tiltback_duty_speed / d->float_conf.hertz;
-        d->tiltback_return_step_size = d->float_conf.tiltback_return_speed / d->float_conf.hertz;
 
         // Limit speed of wheel and limit amps
         VESC_IF->set_cfg_float(CFG_PARAM_l_min_erpm + 100, -6000);
         VESC_IF->set_cfg_float(CFG_PARAM_l_max_erpm + 100, 6000);
-        d->mc_current_max = d->mc_current_min = 40;
+        update->current_max = update->current_min = 40;
 
         // d->flywheel_allow_abort = cfg[5];
 
         // Disable I-term and all tune modifiers and tilts
-        d->float_conf.ki = 0;
-        d->float_conf.kp_brake = 1;
-        d->float_conf.kp2_brake = 1;
-        d->float_conf.brkbooster_angle = 100;
-        d->float_conf.booster_angle = 100;
-        d->float_conf.torquetilt_strength = 0;
-        d->float_conf.torquetilt_strength_regen = 0;
-        d->float_conf.atr_strength_up = 0;
-        d->float_conf.atr_strength_down = 0;
-        d->float_conf.turntilt_strength = 0;
-        d->float_conf.tiltback_constant = 0;
-        d->float_conf.tiltback_variable = 0;
-        d->float_conf.brake_current = 0;
-        d->float_conf.fault_darkride_enabled = false;
-        d->float_conf.fault_reversestop_enabled = false;
-        d->float_conf.tiltback_constant = 0;
-        d->tiltback_variable_max_erpm = 0;
-        d->tiltback_variable = 0;
+        conf->ki = 0;
+        conf->kp_brake = 1;
+        conf->kp2_brake = 1;
+        conf->brkbooster_angle = 100;
+        conf->booster_angle = 100;
+        conf->torquetilt_strength = 0;
+        conf->torquetilt_strength_regen = 0;
+        conf->atr_strength_up = 0;
+        conf->atr_strength_down = 0;
+        conf->turntilt_strength = 0;
+        conf->tiltback_constant = 0;
+        conf->tiltback_variable = 0;
+        conf->brake_current = 0;
+        conf->fault_darkride_enabled = false;
+        conf->fault_reversestop_enabled = false;
+        tune_handoff_publish(&d->tune_handoff, TUNE_APPLY_PLAN);
     } else {
         flywheel_stop(d);
     }
@@ -2331,8 +2931,7 @@ static void cmd_flywheel_toggle(data *d, unsigned char *cfg, int len) {
 void flywheel_stop(data *d) {
     beep_on(d, 1);
     d->state.mode = MODE_NORMAL;
-    read_cfg_from_eeprom(&d->float_conf);
-    configure(d);
+    restore_cfg(d, TUNE_APPLY_CONFIGURE);
 }
 
 static void send_realtime_data2(data *d) {
@@ -2340,64 +2939,319 @@ static void send_realtime_data2(data *d) {
     uint8_t buffer[bufsize];
     int32_t ind = 0;
 
+    Snapshot snapshot;
+    snapshot_read(&d->snapshot, &snapshot);
+    const Snapshot *s = &snapshot;
+
     buffer[ind++] = 101;  // Package ID
     buffer[ind++] = COMMAND_GET_RTDATA_2;
 
     // mask indicates what groups of data are sent, to prevent sending data
     // that are not useful in a given state
     uint8_t mask = 0;
-    if (d->state.state == STATE_RUNNING) {
+    if (s->state.state == STATE_RUNNING) {
         mask |= 0x1;
     }
 
-    if (d->state.charging) {
+    if (s->state.charging) {
         mask |= 0x2;
     }
 
     buffer[ind++] = mask;
 
-    buffer[ind++] = d->state.mode << 4 | d->state.state;
+    buffer[ind++] = s->state.mode << 4 | s->state.state;
 
-    uint8_t flags = d->state.charging << 5 | d->state.darkride << 1 | d->state.wheelslip;
-    buffer[ind++] = d->footpad_sensor.state << 6 | flags;
+    uint8_t flags = s->state.charging << 5 | s->state.darkride << 1 | s->state.wheelslip;
+    buffer[ind++] = s->footpad_state << 6 | flags;
 
-    buffer[ind++] = d->state.sat << 4 | d->state.stop_condition;
+    buffer[ind++] = s->state.sat << 4 | s->state.stop_condition;
 
-    buffer[ind++] = d->beep_reason;
+    buffer[ind++] = s->beep_reason;
 
-    buffer_append_float32_auto(buffer, d->pitch, &ind);
-    buffer_append_float32_auto(buffer, d->balance_pitch, &ind);
-    buffer_append_float32_auto(buffer, d->roll, &ind);
+    buffer_append_float32_auto(buffer, s->pitch, &ind);
+    buffer_append_float32_auto(buffer, s->balance_pitch, &ind);
+    buffer_append_float32_auto(buffer, s->roll, &ind);
 
-    buffer_append_float32_auto(buffer, d->footpad_sensor.adc1, &ind);
-    buffer_append_float32_auto(buffer, d->footpad_sensor.adc2, &ind);
-    buffer_append_float32_auto(buffer, d->throttle_val, &ind);
+    buffer_append_float32_auto(buffer, s->adc1, &ind);
+    buffer_append_float32_auto(buffer, s->adc2, &ind);
+    buffer_append_float32_auto(buffer, s->throttle, &ind);
 
-    if (d->state.state == STATE_RUNNING) {
+    if (s->state.state == STATE_RUNNING) {
         // Setpoints
-        buffer_append_float32_auto(buffer, d->setpoint, &ind);
-        buffer_append_float32_auto(buffer, d->atr.offset, &ind);
-        buffer_append_float32_auto(buffer, d->atr.braketilt_offset, &ind);
-        buffer_append_float32_auto(buffer, d->torque_tilt.offset, &ind);
-        buffer_append_float32_auto(buffer, d->turntilt_interpolated, &ind);
-        buffer_append_float32_auto(buffer, d->inputtilt_interpolated, &ind);
+        buffer_append_float32_auto(buffer, s->setpoint, &ind);
+        buffer_append_float32_auto(buffer, s->atr_offset, &ind);
+        buffer_append_float32_auto(buffer, s->braketilt_offset, &ind);
+        buffer_append_float32_auto(buffer, s->torque_tilt_offset, &ind);
+        buffer_append_float32_auto(buffer, s->turntilt, &ind);
+        buffer_append_float32_auto(buffer, s->inputtilt, &ind);
 
         // DEBUG
-        buffer_append_float32_auto(buffer, d->pid_value, &ind);
-        buffer_append_float32_auto(buffer, d->motor.atr_filtered_current, &ind);
-        buffer_append_float32_auto(buffer, d->atr.accel_diff, &ind);
-        buffer_append_float32_auto(buffer, d->atr.speed_boost, &ind);
-        buffer_append_float32_auto(buffer, d->applied_booster_current, &ind);
+        buffer_append_float32_auto(buffer, s->pid_value, &ind);
+        buffer_append_float32_auto(buffer, s->atr_filtered_current, &ind);
+        buffer_append_float32_auto(buffer, s->atr_accel_diff, &ind);
+        buffer_append_float32_auto(buffer, s->atr_speed_boost, &ind);
+        buffer_append_float32_auto(buffer, s->booster_current, &ind);
     }
 
-    if (d->state.charging) {
-        buffer_append_float32_auto(buffer, d->charging.current, &ind);
-        buffer_append_float32_auto(buffer, d->charging.voltage, &ind);
+    if (s->state.charging) {
+        buffer_append_float32_auto(buffer, s->charging_current, &ind);
+        buffer_append_float32_auto(buffer, s->charging_voltage, &ind);
     }
 
     SEND_APP_DATA(buffer, bufsize, ind);
 }
 
+static void send_telemetry_frame(data *d, uint8_t command, uint64_t mask) {
+    static const int bufsize = 10 + 4 * TELEMETRY_FIELD_COUNT;
+    uint8_t buffer[bufsize];
+    int32_t ind = 0;
+
+    Snapshot snapshot;
+    snapshot_read(&d->snapshot, &snapshot);
+
+    mask &= TELEMETRY_MASK_ALL;
+
+    buffer[ind++] = 101;  // Package ID
+    buffer[ind++] = command;
+    telemetry_append_mask(buffer, mask, &ind);
+    telemetry_pack(&snapshot, mask, buffer, &ind);
+
+    SEND_APP_DATA(buffer, bufsize, ind);
+}
+
+static void send_rt_stream_frame(data *d) {
+    RtStream *stream = &d->rt_stream;
+    if (stream->keyframe_interval == 0) {
+        send_telemetry_frame(d, COMMAND_RTDATA_STREAM, stream->mask);
+        return;
+    }
+
+    static const int bufsize = 11 + 5 * TELEMETRY_FIELD_COUNT;
+    uint8_t buffer[bufsize];
+    int32_t ind = 0;
+
+    Snapshot snapshot;
+    snapshot_read(&d->snapshot, &snapshot);
+
+    buffer[ind++] = 101;  // Package ID
+    buffer[ind++] = COMMAND_RTDATA_STREAM_COMPACT;
+    telemetry_encode(&stream->encoder, &snapshot, stream->mask, buffer, &ind);
+
+    SEND_APP_DATA(buffer, bufsize, ind);
+}
+
+static void cmd_rt_stream(data *d, uint8_t *buffer, size_t len) {
+    // Rate [Hz] (0 unsubscribes), optional watchdog timeout [s], field mask
+    // (all fields by default) and keyframe interval (0, the default, for
+    // plain frames). Resend before the timeout to keep the frames coming.
+    int32_t ind = 0;
+    uint8_t rate = len > 0 ? buffer[ind++] : 0;
+    uint8_t timeout = len > 1 ? buffer[ind++] : 0;
+    uint64_t mask = len >= 10 ? telemetry_get_mask(buffer, &ind) : TELEMETRY_MASK_ALL;
+    uint8_t keyframe_interval = len > 10 ? buffer[ind++] : 0;
+    rt_stream_subscribe(&d->rt_stream, rate, mask, timeout, keyframe_interval);
+}
+
+static void send_capture_batches(data *d) {
+    static const int bufsize = 21 + CAPTURE_BATCH_BYTES;
+    uint8_t buffer[bufsize];
+
+    const CaptureBatch *batch;
+    while ((batch = capture_oldest(&d->capture))) {
+        int32_t ind = 0;
+        buffer[ind++] = 101;  // Package ID
+        buffer[ind++] = COMMAND_CAPTURE;
+        buffer_append_uint16(buffer, batch->sequence, &ind);
+        // The measured loop rate over the batch [Hz], it differs from the
+        // configured one when the loop is synchronized to the IMU
+        float rate = batch->duration > 0 ? batch->samples / batch->duration : 0;
+        buffer_append_float32_auto(buffer, rate, &ind);
+        buffer_append_uint32(buffer, batch->first_iteration, &ind);
+        telemetry_append_mask(buffer, batch->mask, &ind);
+        buffer[ind++] = batch->samples;
+
+        memcpy(&buffer[ind], batch->data, batch->size);
+        ind += batch->size;
+
+        SEND_APP_DATA(buffer, bufsize, ind);
+        capture_release(&d->capture);
+    }
+}
+
+static void cmd_capture(data *d, uint8_t *buffer, size_t len) {
+    // Number of batches (0 stops the capture), optional samples per batch (as
+    // many as fit by default) and field mask (pitch, setpoint, PID value,
+    // rate P, motor current and ERPM by default)
+    int32_t ind = 0;
+    uint16_t batches = len >= 2 ? buffer_get_uint16(buffer, &ind) : 0;
+    uint8_t samples = len >= 3 ? buffer[ind++] : 0;
+    uint64_t mask = len >= 11 ? telemetry_get_mask(buffer, &ind) : CAPTURE_DEFAULT_MASK;
+    capture_request(&d->capture, batches, samples, mask);
+}
+
+static void send_blackbox_status(data *d) {
+    static const int bufsize = 25;
+    uint8_t buffer[bufsize];
+    int32_t ind = 0;
+
+    Blackbox *bb = &d->blackbox;
+    BlackboxState state = blackbox_state(bb);
+    bool frozen = state == BLACKBOX_FROZEN;
+
+    buffer[ind++] = 101;  // Package ID
+    buffer[ind++] = COMMAND_BLACKBOX;
+    buffer[ind++] = BLACKBOX_OP_STATUS;
+    buffer[ind++] = state;
+    // The rest only describes a frozen recording
+    buffer[ind++] = frozen ? bb->event : BLACKBOX_EVENT_NONE;
+    buffer[ind++] = frozen ? bb->stop_condition : 0;
+    buffer_append_uint16(buffer, d->float_conf.hertz, &ind);
+    uint16_t records = frozen ? blackbox_record_count(bb) : 0;
+    buffer_append_uint16(buffer, records, &ind);
+    buffer_append_uint16(buffer, frozen ? blackbox_trigger_index(bb) : 0, &ind);
+    buffer_append_uint32(buffer, frozen ? bb->last_iteration - (records - 1) : 0, &ind);
+    buffer[ind++] = bb->record_size;
+    telemetry_append_mask(buffer, BLACKBOX_MASK, &ind);
+
+    SEND_APP_DATA(buffer, bufsize, ind);
+}
+
+static void cmd_blackbox(data *d, uint8_t *buffer, size_t len) {
+    // Operation: the status, a chunk of records from the u16 index of the
+    // first one (resend from the index following the last record received),
+    // or rearm (no reply, the loop picks it up on its next iteration).
+    // Records are read only while the recording is frozen.
+    int32_t ind = 0;
+    uint8_t op = len > 0 ? buffer[ind++] : BLACKBOX_OP_STATUS;
+
+    switch (op) {
+    case BLACKBOX_OP_STATUS:
+        send_blackbox_status(d);
+        return;
+    case BLACKBOX_OP_READ: {
+        uint16_t first = len >= 3 ? buffer_get_uint16(buffer, &ind) : 0;
+
+        static const int bufsize = 256;
+        uint8_t send_buffer[bufsize];
+        int32_t send_ind = 0;
+        send_buffer[send_ind++] = 101;  // Package ID
+        send_buffer[send_ind++] = COMMAND_BLACKBOX;
+        send_buffer[send_ind++] = BLACKBOX_OP_READ;
+        buffer_append_uint16(send_buffer, first, &send_ind);
+
+        uint8_t record_size = d->blackbox.record_size;
+        uint16_t count = record_size > 0 ? (bufsize - send_ind - 1) / record_size : 0;
+        count = blackbox_read(&d->blackbox, first, &send_buffer[send_ind + 1], count);
+        send_buffer[send_ind++] = count;
+        send_ind += count * record_size;
+
+        SEND_APP_DATA(send_buffer, bufsize, send_ind);
+        return;
+    }
+    case BLACKBOX_OP_REARM:
+        blackbox_rearm(&d->blackbox);
+        return;
+    }
+}
+
+static void cmd_telemetry_describe(uint8_t *buffer, size_t len) {
+    // Optional first field ID, the fields that don't fit are requested with
+    // the ID following the last one received
+    uint8_t first = len > 0 ? buffer[0] : 0;
+
+    static const int bufsize = 256;
+    uint8_t send_buffer[bufsize];
+    int32_t ind = 0;
+
+    send_buffer[ind++] = 101;  // Package ID
+    send_buffer[ind++] = COMMAND_TELEMETRY_DESCRIBE;
+    send_buffer[ind++] = TELEMETRY_FIELD_COUNT;
+    send_buffer[ind++] = first;
+    int32_t count_ind = ind++;
+    send_buffer[count_ind] = telemetry_describe(first, send_buffer, &ind, bufsize);
+
+    SEND_APP_DATA(send_buffer, bufsize, ind);
+}
+
+static void cmd_telemetry_get(data *d, uint8_t *buffer, size_t len) {
+    int32_t ind = 0;
+    uint64_t mask = len >= 8 ? telemetry_get_mask(buffer, &ind) : TELEMETRY_MASK_ALL;
+    send_telemetry_frame(d, COMMAND_TELEMETRY_GET, mask);
+}
+
+static void append_timing(
+    uint8_t *buffer, float min, float mean, float max, float p99, int32_t *ind
+) {
+    // min stays at FLT_MAX until there's a sample
+    buffer_append_float32_auto(buffer, max > 0 ? min : 0, ind);
+    buffer_append_float32_auto(buffer, mean, ind);
+    buffer_append_float32_auto(buffer, max, ind);
+    buffer_append_float32_auto(buffer, p99, ind);
+}
+
+static void cmd_loop_timing(data *d, uint8_t *buffer, size_t len) {
+    // Optional flags: bit 0 resets the statistics after sending them
+    uint8_t flags = len > 0 ? buffer[0] : 0;
+
+    static const int bufsize = 10 + LOOP_TIMING_STATES * 60 + SETPOINT_STAGE_COUNT * 16;
+    uint8_t send_buffer[bufsize];
+    int32_t ind = 0;
+
+    send_buffer[ind++] = 101;  // Package ID
+    send_buffer[ind++] = COMMAND_LOOP_TIMING;
+    buffer_append_uint16(send_buffer, d->float_conf.hertz, &ind);
+    buffer_append_float32_auto(send_buffer, d->loop_timing.bucket_width, &ind);
+    send_buffer[ind++] = LOOP_TIMING_STATES;
+
+    // All times in seconds
+    for (int i = 0; i < LOOP_TIMING_STATES; ++i) {
+        const LoopTimingStats *stats = &d->loop_timing.stats[i];
+        buffer_append_uint32(send_buffer, stats->iterations, &ind);
+        buffer_append_uint32(send_buffer, stats->overruns, &ind);
+        append_timing(
+            send_buffer,
+            stats->compute_min,
+            stats->compute_mean,
+            stats->compute_max,
+            loop_timing_p99(&d->loop_timing, &stats->compute_histogram),
+            &ind
+        );
+        append_timing(
+            send_buffer,
+            stats->period_min,
+            stats->period_mean,
+            stats->period_max,
+            loop_timing_p99(&d->loop_timing, &stats->period_histogram),
+            &ind
+        );
+        buffer_append_uint32(send_buffer, stats->stale, &ind);
+        append_timing(
+            send_buffer,
+            stats->sample_age_min,
+            stats->sample_age_mean,
+            stats->sample_age_max,
+            loop_timing_p99(&d->loop_timing, &stats->sample_age_histogram),
+            &ind
+        );
+    }
+
+    // Setpoint stages by SetpointStageId, compute times in seconds
+    send_buffer[ind++] = SETPOINT_STAGE_COUNT;
+    for (int i = 0; i < SETPOINT_STAGE_COUNT; ++i) {
+        const LoopTimingStage *stage = &d->loop_timing.stages[i];
+        buffer_append_uint32(send_buffer, stage->runs, &ind);
+        buffer_append_uint32(send_buffer, stage->skips, &ind);
+        buffer_append_float32_auto(send_buffer, stage->mean, &ind);
+        buffer_append_float32_auto(send_buffer, stage->max, &ind);
+    }
+
+    SEND_APP_DATA(send_buffer, bufsize, ind);
+
+    if (flags & 0x1) {
+        loop_timing_reset(&d->loop_timing);
+    }
+}
+
 static void lights_control_request(CfgLeds *leds, uint8_t *buffer, size_t len, LcmData *lcm) {
     if (len < 2) {
         return;
@@ -2433,6 +3287,39 @@ static void lights_control_response(const CfgLeds *leds) {
     SEND_APP_DATA(buffer, bufsize, ind);
 }
 
+// Sends the latest spectrum and starts the analysis if it isn't running. The
+// client polls this command, the analysis stops 5 s after the last request
+// unless the automatic gyro notch is on.
+static void cmd_spectrum(data *d) {
+    d->spectrum_request_time = d->current_time;
+
+    static const int bufsize = 24 + SPECTRUM_SIGNALS * SPECTRUM_BINS * 2;
+    uint8_t buffer[bufsize];
+    int32_t ind = 0;
+
+    const Spectrum *s = &d->spectrum;
+    buffer[ind++] = 101;  // Package ID
+    buffer[ind++] = COMMAND_SPECTRUM;
+    buffer_append_float32_auto(buffer, s->sample_rate / SPECTRUM_SAMPLES, &ind);  // bin width
+    buffer[ind++] = SPECTRUM_BINS;
+    buffer[ind++] = SPECTRUM_SIGNALS;
+    buffer_append_float32_auto(buffer, s->peak_frequency, &ind);
+    buffer_append_float32_auto(buffer, s->peak_magnitude, &ind);
+    buffer_append_float32_auto(buffer, s->harmonic, &ind);
+    buffer_append_float32_auto(
+        buffer, spectrum_vibration_frequency(s, d->motor.abs_erpm), &ind
+    );
+
+    // Bin amplitudes, gyro in deg/s and current in A, scaled by 100
+    for (int i = 0; i < SPECTRUM_SIGNALS; ++i) {
+        for (int j = 0; j < SPECTRUM_BINS; ++j) {
+            buffer_append_float16(buffer, fminf(s->magnitudes[i][j], 327.0f), 100, &ind);
+        }
+    }
+
+    SEND_APP_DATA(buffer, bufsize, ind);
+}
+
 // Handler for incoming app commands
 static void on_command_received(unsigned char *buffer, unsigned int len) {
     data *d = (data *) ARG;
@@ -2496,7 +3383,7 @@ static void on_command_received(unsigned char *buffer, unsigned int len) {
         return;
     }
     case COMMAND_CFG_RESTORE: {
-        read_cfg_from_eeprom(&d->float_conf);
+        restore_cfg(d, TUNE_APPLY_RECONFIGURE);
         return;
     }
     case COMMAND_TUNE_DEFAULTS: {
@@ -2504,7 +3391,7 @@ static void on_command_received(unsigned char *buffer, unsigned int len) {
         return;
     }
     case COMMAND_CFG_SAVE: {
-        write_cfg_to_eeprom(d);
+        write_cfg_to_eeprom(d, &d->float_conf);
         return;
     }
     case COMMAND_PRINT_INFO: {
@@ -2549,7 +3436,9 @@ static void on_command_received(unsigned char *buffer, unsigned int len) {
     }
     case COMMAND_LCM_POLL: {
         lcm_poll_request(&d->lcm, &buffer[2], len - 2);
-        lcm_poll_response(&d->lcm, &d->state, d->footpad_sensor.state, &d->motor, d->pitch);
+        Snapshot snapshot;
+        snapshot_read(&d->snapshot, &snapshot);
+        lcm_poll_response(&d->lcm, &snapshot);
         return;
     }
     case COMMAND_LCM_LIGHT_INFO: {
@@ -2581,6 +3470,34 @@ static void on_command_received(unsigned char *buffer, unsigned int len) {
         lights_control_response(&d->float_conf.leds);
         return;
     }
+    case COMMAND_LOOP_TIMING: {
+        cmd_loop_timing(d, &buffer[2], len - 2);
+        return;
+    }
+    case COMMAND_SPECTRUM: {
+        cmd_spectrum(d);
+        return;
+    }
+    case COMMAND_RTDATA_STREAM: {
+        cmd_rt_stream(d, &buffer[2], len - 2);
+        return;
+    }
+    case COMMAND_TELEMETRY_DESCRIBE: {
+        cmd_telemetry_describe(&buffer[2], len - 2);
+        return;
+    }
+    case COMMAND_TELEMETRY_GET: {
+        cmd_telemetry_get(d, &buffer[2], len - 2);
+        return;
+    }
+    case COMMAND_CAPTURE: {
+        cmd_capture(d, &buffer[2], len - 2);
+        return;
+    }
+    case COMMAND_BLACKBOX: {
+        cmd_blackbox(d, &buffer[2], len - 2);
+        return;
+    }
     default: {
         if (!VESC_IF->app_is_output_disabled()) {
             log_error("Unknown command received: %u", command);
@@ -2643,15 +3560,25 @@ static bool set_cfg(uint8_t *buffer) {
         return false;
     }
 
-    bool res = confparser_deserialize_refloatconfig(buffer, &d->float_conf);
+    RefloatConfig *config = VESC_IF->malloc(sizeof(RefloatConfig));
+    if (!config) {
+        log_error("Failed to set config: Out of memory.");
+        return false;
+    }
 
-    // Store to EEPROM
+    bool res = confparser_deserialize_refloatconfig(buffer, config);
     if (res) {
-        write_cfg_to_eeprom(d);
-        configure(d);
-        leds_configure(&d->leds, &d->float_conf.leds);
+        // The loop adopts the config as a whole and configures everything anew
+        TuneUpdate *update = tune_handoff_begin(&d->tune_handoff, &d->float_conf);
+        update->config = *config;
+        tune_handoff_publish(&d->tune_handoff, TUNE_APPLY_CONFIGURE);
+
+        // Store to EEPROM
+        write_cfg_to_eeprom(d, config);
+        leds_configure(&d->leds, &config->leds);
     }
 
+    VESC_IF->free(config);
     return res;
 }
 
@@ -2671,9 +3598,11 @@ static void stop(void *arg) {
     VESC_IF->set_app_data_handler(NULL);
     VESC_IF->conf_custom_clear_configs();
     VESC_IF->request_terminate(d->led_thread);
+    VESC_IF->request_terminate(d->telemetry_thread);
     VESC_IF->request_terminate(d->main_thread);
     log_msg("Terminating.");
     leds_destroy(&d->leds);
+    blackbox_destroy(&d->blackbox);
     VESC_IF->free(d);
 }
 
@@ -2701,7 +3630,9 @@ INIT_FUN(lib_info *info) {
     balance_filter_init(&d->balance_filter);
     VESC_IF->imu_set_read_callback(imu_ref_callback);
 
+    footpad_sensor_configure(&d->footpad_sensor, &d->float_conf);
     footpad_sensor_update(&d->footpad_sensor, &d->float_conf);
+    publish_snapshot(d);
 
     d->main_thread = VESC_IF->spawn(refloat_thd, 1024, "Refloat Main", d);
     if (!d->main_thread) {
@@ -2721,6 +3652,11 @@ INIT_FUN(lib_info *info) {
         }
     }
 
+    d->telemetry_thread = VESC_IF->spawn(telemetry_thd, 2048, "Refloat Telemetry", d);
+    if (!d->telemetry_thread) {
+        log_error("Failed to spawn Refloat Telemetry thread.");
+    }
+
     VESC_IF->set_app_data_handler(on_command_received);
     VESC_IF->lbm_add_extension("ext-dbg", ext_dbg);
     VESC_IF->lbm_add_extension("ext-set-fw-version", ext_set_fw_version);
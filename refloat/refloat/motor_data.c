@@ -27,15 +27,15 @@ void motor_data_reset(MotorData *m) {
     m->duty_smooth = 0;
 
     m->acceleration = 0;
-    m->accel_idx = 0;
-    for (int i = 0; i < 40; i++) {
-        m->accel_history[i] = 0;
-    }
+    accel_estimator_reset(&m->accel_estimator);
 
     biquad_reset(&m->atr_current_biquad);
 }
 
-void motor_data_configure(MotorData *m, float frequency) {
+void motor_data_configure(MotorData *m, const RefloatConfig *config) {
+    accel_estimator_configure(&m->accel_estimator, config->accel_estimator, config->hertz);
+
+    float frequency = config->atr_filter / config->hertz;
     if (frequency > 0) {
         biquad_configure(&m->atr_current_biquad, BQ_LOWPASS, frequency);
         m->atr_filter_enabled = true;
@@ -55,12 +55,7 @@ void motor_data_update(MotorData *m) {
     m->duty_cycle = fabsf(VESC_IF->mc_get_duty_cycle_now());
     m->duty_smooth = m->duty_smooth * 0.9f + m->duty_cycle * 0.1f;
 
-    float current_acceleration = m->erpm - m->last_erpm;
-    m->last_erpm = m->erpm;
-
-    m->acceleration += (current_acceleration - m->accel_history[m->accel_idx]) / ACCEL_ARRAY_SIZE;
-    m->accel_history[m->accel_idx] = current_acceleration;
-    m->accel_idx = (m->accel_idx + 1) % ACCEL_ARRAY_SIZE;
+    m->acceleration = accel_estimator_update(&m->accel_estimator, m->erpm);
 
     if (m->atr_filter_enabled) {
         m->atr_filtered_current = biquad_process(&m->atr_current_biquad, m->current);
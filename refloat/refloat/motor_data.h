@@ -17,17 +17,17 @@
 
 #pragma once
 
+#include "accel_estimator.h"
+#include "conf/datatypes.h"
+
 #include "biquad.h"
 
 #include <stdbool.h>
 #include <stdint.h>
 
-#define ACCEL_ARRAY_SIZE 40
-
 typedef struct {
     float erpm;
     float abs_erpm;
-    float last_erpm;
     int8_t erpm_sign;
 
     float current;
@@ -36,10 +36,9 @@ typedef struct {
     float duty_cycle;
     float duty_smooth;
 
-    // an average calculated over last ACCEL_ARRAY_SIZE values
+    // [ERPM / iteration], see accel_estimator.h
     float acceleration;
-    float accel_history[ACCEL_ARRAY_SIZE];
-    uint8_t accel_idx;
+    AccelEstimator accel_estimator;
 
     bool atr_filter_enabled;
     Biquad atr_current_biquad;
@@ -48,6 +47,6 @@ typedef struct {
 
 void motor_data_reset(MotorData *m);
 
-void motor_data_configure(MotorData *m, float frequency);
+void motor_data_configure(MotorData *m, const RefloatConfig *config);
 
 void motor_data_update(MotorData *m);
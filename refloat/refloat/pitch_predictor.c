@@ -0,0 +1,47 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "pitch_predictor.h"
+
+#include "utils.h"
+
+#include <math.h>
+
+// Limit of the pitch rate change used for the second-order term [deg/s^2]
+#define MAX_RATE_CHANGE 2000.0f
+
+void pitch_predictor_reset(PitchPredictor *p) {
+    p->last_rate = 0.0f;
+    p->latency = 0.0f;
+    p->offset = 0.0f;
+}
+
+void pitch_predictor_configure(PitchPredictor *p, const RefloatConfig *config) {
+    p->strength = config->latency_compensation;
+}
+
+float pitch_predictor_update(PitchPredictor *p, float pitch, float rate, float latency, float dt) {
+    float rate_change = 0.0f;
+    if (dt > 0.0f) {
+        rate_change = clampf((rate - p->last_rate) / dt, -MAX_RATE_CHANGE, MAX_RATE_CHANGE);
+    }
+    p->last_rate = rate;
+
+    p->latency = latency * p->strength;
+    p->offset = (rate + 0.5f * rate_change * p->latency) * p->latency;
+    return pitch + p->offset;
+}
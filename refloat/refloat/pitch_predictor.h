@@ -0,0 +1,57 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "conf/datatypes.h"
+
+/**
+ * Extrapolates the balance pitch forward over the latency between the IMU
+ * sample and the motor acting on the resulting current command, so the PID
+ * reacts to where the board will be rather than to where it was:
+ *
+ * pitch + rate * latency + 0.5 * rate_change * latency^2
+ *
+ * The pitch rate comes from the gyro, its change is the difference of two
+ * consecutive gyro readings, clamped (it is noisy and the second-order term
+ * only matters for long latencies).
+ *
+ * The latency is measured every iteration: the age of the IMU sample at the
+ * start of the iteration, plus the compute time of the last iteration (the
+ * current is set at its end), plus half a loop period for the current being
+ * held until the next iteration. The compensation is scaled by the
+ * latency_compensation setting, 0 disables it.
+ */
+typedef struct {
+    float strength;
+
+    float last_rate;  // [deg/s]
+    float latency;  // [s]
+    float offset;  // [deg], the last extrapolation
+} PitchPredictor;
+
+void pitch_predictor_reset(PitchPredictor *p);
+
+void pitch_predictor_configure(PitchPredictor *p, const RefloatConfig *config);
+
+/**
+ * @param rate Pitch rate in the sign convention of @p pitch [deg/s].
+ * @param latency Measured latency [s].
+ * @param dt Time since the last call [s].
+ * @return The extrapolated pitch [deg].
+ */
+float pitch_predictor_update(PitchPredictor *p, float pitch, float rate, float latency, float dt);
@@ -0,0 +1,112 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "rt_stream.h"
+
+#include "vesc_c_if.h"
+
+#include <math.h>
+
+void rt_stream_init(RtStream *s) {
+    s->request_seq = 0;
+    s->request_rate = 0;
+    s->request_timeout = 0;
+    s->request_keyframe_interval = 0;
+    s->request_mask = 0;
+    s->last_seq = 0;
+    s->rate = 0;
+    s->mask = 0;
+    s->keyframe_interval = 0;
+    telemetry_encoder_reset(&s->encoder, 1);
+    s->period = 0;
+    s->frame_timer = 0;
+    s->watchdog = 0;
+    s->last_update = VESC_IF->timer_time_now();
+}
+
+void rt_stream_subscribe(
+    RtStream *s, uint8_t rate, uint64_t mask, uint8_t timeout, uint8_t keyframe_interval
+) {
+    // Every post changes the sequence number, so a renewal with the same
+    // parameters is a new request too
+    __atomic_store_n(&s->request_seq, s->request_seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    s->request_rate = rate;
+    s->request_timeout = timeout;
+    s->request_keyframe_interval = keyframe_interval;
+    s->request_mask = mask;
+    __atomic_store_n(&s->request_seq, s->request_seq + 1, __ATOMIC_RELEASE);
+}
+
+static bool adopt_request(RtStream *s) {
+    uint32_t seq = __atomic_load_n(&s->request_seq, __ATOMIC_ACQUIRE);
+    if (seq == s->last_seq || (seq & 1)) {
+        return false;
+    }
+
+    uint8_t rate = s->request_rate;
+    uint8_t timeout = s->request_timeout;
+    uint8_t keyframe_interval = s->request_keyframe_interval;
+    uint64_t mask = s->request_mask;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (seq != __atomic_load_n(&s->request_seq, __ATOMIC_RELAXED)) {
+        return false;
+    }
+
+    s->last_seq = seq;
+    // A renewal carries on with the deltas, a new subscription starts with a keyframe
+    if (s->rate == 0 || keyframe_interval != s->keyframe_interval) {
+        telemetry_encoder_reset(&s->encoder, keyframe_interval);
+    }
+    s->keyframe_interval = keyframe_interval;
+    s->rate = rate;
+    s->mask = mask;
+    s->period = rate > 0 ? 1.0f / rate : 0;
+    s->watchdog = timeout > 0 ? timeout : RT_STREAM_DEFAULT_TIMEOUT;
+    return true;
+}
+
+bool rt_stream_update(RtStream *s) {
+    float dt = VESC_IF->timer_seconds_elapsed_since(s->last_update);
+    s->last_update = VESC_IF->timer_time_now();
+
+    if (adopt_request(s)) {
+        // A renewal keeps the frame spacing, a new subscription starts right away
+        if (s->frame_timer > s->period) {
+            s->frame_timer = 0;
+        }
+    }
+
+    if (s->rate == 0) {
+        return false;
+    }
+
+    s->watchdog -= dt;
+    if (s->watchdog <= 0) {
+        s->rate = 0;
+        return false;
+    }
+
+    s->frame_timer -= dt;
+    if (s->frame_timer > 0) {
+        return false;
+    }
+
+    // Missed frames are dropped rather than sent in a burst
+    s->frame_timer = fmaxf(s->frame_timer + s->period, 0);
+    return true;
+}
@@ -0,0 +1,80 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "telemetry_codec.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Watchdog timeout when the subscription doesn't specify one [s]
+#define RT_STREAM_DEFAULT_TIMEOUT 3
+
+/**
+ * Pushed realtime data subscription: the client sets a rate and a mask of
+ * telemetry fields, the telemetry thread sends frames at that rate until the
+ * client unsubscribes or stops renewing the subscription before the watchdog
+ * expires. The frames are plain (telemetry_pack()) or compact
+ * (telemetry_encode()) if the client sets a keyframe interval.
+ *
+ * The command handler posts the subscription under a sequence number, the
+ * telemetry thread picks it up on its next update. It never waits, if it
+ * catches the handler in the middle of a post it tries again on the next
+ * update.
+ */
+typedef struct {
+    // Posted by the command handler, the sequence number is odd while writing
+    uint32_t request_seq;
+    uint8_t request_rate;
+    uint8_t request_timeout;
+    uint8_t request_keyframe_interval;
+    uint64_t request_mask;
+    uint32_t last_seq;
+
+    uint8_t rate;  // [Hz], 0 when not subscribed
+    uint64_t mask;
+    uint8_t keyframe_interval;  // 0 for plain frames
+    TelemetryEncoder encoder;
+    float period;  // [s]
+    float frame_timer;  // time until the next frame [s]
+    float watchdog;  // time until the subscription expires [s]
+    uint32_t last_update;  // timer ticks
+} RtStream;
+
+void rt_stream_init(RtStream *s);
+
+/**
+ * Subscribes (or renews the subscription) with @p rate frames per second of
+ * the telemetry fields in @p mask. A @p rate of 0 unsubscribes. The subscription
+ * expires after @p timeout seconds without a renewal, 0 selects the default.
+ * A non-zero @p keyframe_interval selects compact frames with a keyframe
+ * every that many frames.
+ *
+ * Call from the command handler.
+ */
+void rt_stream_subscribe(
+    RtStream *s, uint8_t rate, uint64_t mask, uint8_t timeout, uint8_t keyframe_interval
+);
+
+/**
+ * Adopts a new subscription and advances the timers, returns true when a
+ * frame should be sent. Rates above the update rate are limited to it.
+ *
+ * Call from the telemetry thread, at a steady rate.
+ */
+bool rt_stream_update(RtStream *s);
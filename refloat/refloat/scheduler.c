@@ -0,0 +1,179 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "scheduler.h"
+
+#include "utils.h"
+
+#include "vesc_c_if.h"
+
+#include <math.h>
+
+// Polling interval while waiting for an IMU sample, the actual sleep is
+// rounded up to the RTOS tick
+#define SAMPLE_POLL_US 20
+// Shortest sleep at the end of an iteration, even an overrun one yields to the
+// lower priority threads (LEDs, telemetry) so they can't be starved
+#define MIN_SLEEP_US 20
+// Smoothing of the IMU sample period per new sample, the callback's dt jitters
+// with the firmware's IMU thread
+#define IMU_PERIOD_ALPHA 0.01f
+
+void scheduler_reset(Scheduler *s) {
+    s->iteration_start = VESC_IF->timer_time_now();
+    s->lateness = 0;
+    s->dt = s->period;
+    s->dt_scale = 1;
+    s->last_period = s->period;
+    s->compute_time = 0;
+    s->overrun = false;
+    s->tier_counter = 0;
+    s->mid_tier = false;
+    s->slow_tier = false;
+    s->last_sample_count = s->sample_count;
+    s->sample_age = 0;
+    s->stale = false;
+}
+
+void scheduler_configure(Scheduler *s, float frequency, bool imu_sync) {
+    s->period = 1.0f / frequency;
+    s->imu_sync = imu_sync;
+    s->mid_tier_divider = fmaxf(roundf(frequency / SCHEDULER_MID_TIER_HZ), 1);
+    s->tier_counter = 0;
+}
+
+void scheduler_imu_sample(Scheduler *s, float dt) {
+    s->sample_time = VESC_IF->timer_time_now();
+    s->sample_period = dt;
+    ++s->sample_count;
+}
+
+// Whole number of IMU samples per loop iteration when synchronized
+static uint32_t samples_per_iteration(float period, float imu_period) {
+    if (imu_period <= 0) {
+        return 1;
+    }
+
+    uint32_t samples = roundf(period / imu_period);
+    return samples > 1 ? samples : 1;
+}
+
+float scheduler_imu_frequency(const Scheduler *s, float frequency) {
+    if (s->imu_period <= 0) {
+        return frequency;
+    }
+
+    return 1.0f / (samples_per_iteration(1.0f / frequency, s->imu_period) * s->imu_period);
+}
+
+// Reads the newest sample's count and timestamp consistently (the IMU
+// callback may preempt the read), returns the time since the sample [s].
+static float newest_sample(const Scheduler *s, uint32_t *count) {
+    uint32_t sample_time;
+    do {
+        *count = s->sample_count;
+        sample_time = s->sample_time;
+    } while (*count != s->sample_count);
+
+    return VESC_IF->timer_seconds_elapsed_since(sample_time);
+}
+
+// Returns whether the sample was already late.
+static bool sleep_until_sample(Scheduler *s) {
+    float sample_period = s->sample_period;
+    uint32_t count;
+    float since_sample = newest_sample(s, &count);
+
+    // The sample one loop period after the one processed in this iteration
+    uint32_t target_count =
+        s->last_sample_count + samples_per_iteration(s->period, s->imu_period);
+    int32_t remaining = target_count - count;
+    if (remaining <= 0) {
+        VESC_IF->sleep_us(MIN_SLEEP_US);
+        return true;
+    }
+
+    float wait = remaining * sample_period - since_sample;
+    if (wait > 0) {
+        VESC_IF->sleep_us(wait * 1e6f);
+    }
+
+    // The prediction drifts with the IMU clock, poll for the actual sample,
+    // but don't wait more than one extra sample period if it doesn't come
+    uint32_t poll_start = VESC_IF->timer_time_now();
+    while ((int32_t) (s->sample_count - target_count) < 0 &&
+           VESC_IF->timer_seconds_elapsed_since(poll_start) < sample_period) {
+        VESC_IF->sleep_us(SAMPLE_POLL_US);
+    }
+
+    return false;
+}
+
+void scheduler_update(Scheduler *s) {
+    uint32_t now = VESC_IF->timer_time_now();
+    // Measured a few ticks after `now`, but the error doesn't accumulate, as
+    // the next measurement starts from `now` again
+    float elapsed = VESC_IF->timer_seconds_elapsed_since(s->iteration_start);
+    s->iteration_start = now;
+    s->last_period = elapsed;
+
+    uint32_t sample_count;
+    s->sample_age = newest_sample(s, &sample_count);
+    s->stale = sample_count == s->last_sample_count;
+    s->last_sample_count = sample_count;
+
+    if (!s->stale) {
+        if (s->imu_period > 0) {
+            s->imu_period += (s->sample_period - s->imu_period) * IMU_PERIOD_ALPHA;
+        } else {
+            s->imu_period = s->sample_period;
+        }
+    }
+
+    s->lateness += elapsed - s->period;
+    if (s->imu_sync) {
+        // The schedule is given by the IMU samples
+        s->lateness = 0;
+    } else if (s->lateness > s->period || s->lateness < -s->period) {
+        // A whole period was missed (or the period changed), don't try to
+        // catch up with a burst of iterations, start a new schedule instead
+        s->lateness = 0;
+    }
+
+    ++s->tier_counter;
+    if (s->tier_counter >= s->mid_tier_divider * SCHEDULER_SLOW_TIER_DIVIDER) {
+        s->tier_counter = 0;
+    }
+    s->mid_tier = s->tier_counter % s->mid_tier_divider == 0;
+    s->slow_tier = s->tier_counter == s->mid_tier_divider / 2;
+
+    // Limit the effect of long stalls (e.g. EEPROM writes) on the step sizes
+    s->dt = clampf(elapsed, s->period * 0.25f, s->period * 4.0f);
+    s->dt_scale = s->dt / s->period;
+}
+
+void scheduler_sleep(Scheduler *s) {
+    s->compute_time = VESC_IF->timer_seconds_elapsed_since(s->iteration_start);
+    if (s->imu_sync && s->sample_period > 0) {
+        s->overrun = sleep_until_sample(s);
+        return;
+    }
+
+    float sleep = s->period - s->compute_time - s->lateness;
+    s->overrun = sleep <= 0;
+    VESC_IF->sleep_us(fmaxf(sleep * 1e6f, MIN_SLEEP_US));
+}
@@ -0,0 +1,107 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Housekeeping that doesn't need to run at the full loop rate is split into
+// a mid tier of about 100 Hz and a slow tier of a tenth of that
+#define SCHEDULER_MID_TIER_HZ 100
+#define SCHEDULER_SLOW_TIER_DIVIDER 10
+
+/**
+ * Runs the main loop on an absolute schedule: the sleep at the end of each
+ * iteration is shortened by the time spent computing and by how late the
+ * iteration started, so the average loop frequency is exact regardless of
+ * the compute time and of the wake-up jitter of the RTOS.
+ *
+ * Alternatively, the loop can be synchronized to the IMU: each iteration then
+ * starts right after a fresh IMU sample arrives. The firmware has no way for
+ * the IMU callback to wake the thread directly, so the scheduler predicts the
+ * arrival of the next sample from the timestamps recorded in the callback,
+ * sleeps until then and polls for the sample in short sleeps. The loop then
+ * runs at a whole divisor of the IMU rate, which can differ from the
+ * configured frequency (see scheduler_imu_frequency()).
+ *
+ * Each iteration is also assigned to the task tiers which should run in it.
+ * The slow tier runs half a mid tier period off the mid tier, so that the two
+ * never share an iteration (unless the loop runs at the mid tier rate).
+ */
+typedef struct {
+    float period;  // nominal loop period [s]
+    uint32_t iteration_start;  // timer ticks
+    float lateness;  // how late the current iteration started vs. the schedule [s]
+
+    // Measured duration of the last iteration and its ratio to the nominal
+    // period, for scaling per-iteration step sizes
+    float dt;
+    float dt_scale;
+
+    // Unfiltered measurements of the last iteration, for instrumentation
+    float last_period;  // [s]
+    float compute_time;  // [s]
+    bool overrun;  // the compute time didn't fit before the deadline
+
+    uint16_t mid_tier_divider;
+    uint16_t tier_counter;  // wraps at the slow tier divider
+    bool mid_tier;  // the mid tier tasks should run in this iteration
+    bool slow_tier;  // the slow tier tasks should run in this iteration
+
+    bool imu_sync;
+
+    // Written from the IMU callback, sample_count last
+    volatile uint32_t sample_time;  // timer ticks
+    volatile float sample_period;  // [s]
+    volatile uint32_t sample_count;
+
+    float imu_period;  // filtered IMU sample period, 0 until the first sample [s]
+    uint32_t last_sample_count;
+    float sample_age;  // age of the newest IMU sample at the start of the iteration [s]
+    bool stale;  // no new IMU sample arrived since the last iteration
+} Scheduler;
+
+void scheduler_reset(Scheduler *s);
+
+void scheduler_configure(Scheduler *s, float frequency, bool imu_sync);
+
+/**
+ * Call from the IMU callback, records the arrival of a new sample.
+ */
+void scheduler_imu_sample(Scheduler *s, float dt);
+
+/**
+ * Returns the loop frequency closest to `frequency` at which the loop can run
+ * when synchronized to the IMU, that is the IMU rate divided by a whole number
+ * of samples per iteration. Returns `frequency` as is until the IMU rate is
+ * known.
+ */
+float scheduler_imu_frequency(const Scheduler *s, float frequency);
+
+/**
+ * Call at the start of each loop iteration, measures the last iteration and
+ * the age of the newest IMU sample and decides which task tiers should run.
+ */
+void scheduler_update(Scheduler *s);
+
+/**
+ * Call at the end of each loop iteration, sleeps until the next deadline (or
+ * until the next IMU sample after it, when synchronized to the IMU). An
+ * iteration that overran still sleeps briefly, to let other threads run.
+ */
+void scheduler_sleep(Scheduler *s);
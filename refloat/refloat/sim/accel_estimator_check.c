@@ -0,0 +1,146 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "accel_estimator_check.h"
+#include "noise.h"
+
+#include "accel_estimator.h"
+#include "conf/confparser.h"
+
+#include <math.h>
+#include <stdint.h>
+
+#define STEP_ACCEL 2000.0f  // [ERPM/s]
+#define RAMP_JERK 4000.0f  // [ERPM/s^2]
+#define NOISE_AMPLITUDE 30.0f  // [ERPM], uniform
+#define BASE_ERPM 3000.0f
+#define DURATION 2.0f  // [s], of each input
+#define MAX_STEADY_ERROR 0.01f  // relative, at the end of the step input
+
+typedef struct {
+    float delay;  // [ms] to half of an acceleration step
+    float settle;  // [ms] to within 10 % of an acceleration step
+    float steady_error;  // relative, at the end of the step
+    float ramp_lag;  // [ms] behind an acceleration ramp
+    float noise;  // [ERPM/s] RMS on a noisy constant ERPM
+} Result;
+
+static const char *names[] = {
+    [ACCEL_ESTIMATOR_MOVING_AVERAGE] = "moving_average",
+    [ACCEL_ESTIMATOR_ALPHA_BETA] = "alpha_beta",
+    [ACCEL_ESTIMATOR_SAVITZKY_GOLAY] = "savitzky_golay",
+    [ACCEL_ESTIMATOR_KALMAN] = "kalman",
+};
+
+// Starts every input from a settled estimator at BASE_ERPM
+static void start(AccelEstimator *e, AccelEstimatorType type, float hz) {
+    *e = (AccelEstimator) {0};
+    accel_estimator_configure(e, type, hz);
+    for (int i = 0; i < hz; ++i) {
+        accel_estimator_update(e, BASE_ERPM);
+    }
+}
+
+static Result check(AccelEstimatorType type, float hz) {
+    Result r = {0};
+    AccelEstimator e;
+    int n = DURATION * hz;
+
+    // Acceleration step: ERPM starts ramping at i = 0
+    start(&e, type, hz);
+    float target = STEP_ACCEL / hz;
+    int half = -1;
+    int settled = 0;
+    float estimate = 0.0f;
+    for (int i = 0; i < n; ++i) {
+        estimate = accel_estimator_update(&e, BASE_ERPM + STEP_ACCEL * (i + 1) / hz);
+        if (half < 0 && estimate >= 0.5f * target) {
+            half = i;
+        }
+        if (fabsf(estimate - target) > 0.1f * target) {
+            settled = i + 1;
+        }
+    }
+    r.delay = half < 0 ? INFINITY : half * 1000.0f / hz;
+    r.settle = settled * 1000.0f / hz;
+    r.steady_error = fabsf(estimate - target) / target;
+
+    // Acceleration ramp: the lag is the age of the acceleration estimated at the end
+    start(&e, type, hz);
+    for (int i = 0; i < n; ++i) {
+        float t = (i + 1) / hz;
+        estimate = accel_estimator_update(&e, BASE_ERPM + 0.5f * RAMP_JERK * t * t);
+    }
+    r.ramp_lag = (RAMP_JERK * DURATION - estimate * hz) / RAMP_JERK * 1000.0f;
+
+    // Noise on a constant ERPM, after a second to fill the windows
+    start(&e, type, hz);
+    uint32_t rng = 1;
+    double sum_sq = 0.0;
+    for (int i = 0; i < n; ++i) {
+        estimate = accel_estimator_update(&e, BASE_ERPM + NOISE_AMPLITUDE * noise(&rng));
+        if (i >= hz) {
+            sum_sq += estimate * estimate;
+        }
+    }
+    r.noise = sqrt(sum_sq / (n - hz)) * hz;
+
+    return r;
+}
+
+bool accel_estimator_check(FILE *f) {
+    RefloatConfig config;
+    confparser_set_defaults_refloatconfig(&config);
+    float hz = config.hertz;
+
+    fprintf(
+        f,
+        "%.0f Hz loop, step %.0f ERPM/s, ramp %.0f ERPM/s^2, noise +-%.0f ERPM\n",
+        hz,
+        STEP_ACCEL,
+        RAMP_JERK,
+        NOISE_AMPLITUDE
+    );
+    fprintf(f, "estimator,delay_ms,settle_ms,steady_error,ramp_lag_ms,noise_erpm_s,result\n");
+
+    bool ok = true;
+    float reference_delay = INFINITY;
+    for (unsigned int i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        Result r = check(i, hz);
+        if (i == ACCEL_ESTIMATOR_MOVING_AVERAGE) {
+            reference_delay = r.delay;
+        }
+
+        bool pass = r.steady_error < MAX_STEADY_ERROR &&
+            (i == ACCEL_ESTIMATOR_MOVING_AVERAGE || r.delay < reference_delay);
+        ok = ok && pass;
+
+        fprintf(
+            f,
+            "%s,%.1f,%.1f,%.4f,%.1f,%.1f,%s\n",
+            names[i],
+            r.delay,
+            r.settle,
+            r.steady_error,
+            r.ramp_lag,
+            r.noise,
+            pass ? "ok" : "FAIL"
+        );
+    }
+
+    return ok;
+}
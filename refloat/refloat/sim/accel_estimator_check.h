@@ -0,0 +1,31 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * Feeds synthetic ERPM to every acceleration estimator at the default loop
+ * frequency and prints the delay after an acceleration step, the lag behind
+ * an acceleration ramp and the estimate noise on a noisy constant ERPM.
+ *
+ * @return true if every estimator converges to a steady acceleration and the
+ * alternatives to the moving average respond to a step sooner than it does.
+ */
+bool accel_estimator_check(FILE *f);
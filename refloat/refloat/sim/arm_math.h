@@ -0,0 +1,43 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+// Host build shim for CMSIS arm_math.h. The real header pulls in the
+// Cortex-M core headers, this provides the subset the package uses with the
+// same behavior.
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+typedef float float32_t;
+
+typedef enum {
+    ARM_MATH_SUCCESS = 0,
+    ARM_MATH_ARGUMENT_ERROR = -1,
+} arm_status;
+
+static inline arm_status arm_sqrt_f32(float32_t in, float32_t *pOut) {
+    if (in > 0) {
+        *pOut = sqrtf(in);
+        return ARM_MATH_SUCCESS;
+    } else {
+        *pOut = 0.0f;
+        return ARM_MATH_ARGUMENT_ERROR;
+    }
+}
@@ -0,0 +1,117 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "balance_filter_check.h"
+#include "noise.h"
+
+#include "balance_filter.h"
+#include "conf/confparser.h"
+
+#include <math.h>
+#include <stdint.h>
+
+#define IMU_HZ 1000
+
+// The accelerometer feedback pulls both variants to the same gravity vector,
+// so the rounding differences don't accumulate in pitch and roll. Yaw is only
+// integrated and its difference random walks, it is reported but not bounded
+// (Refloat uses yaw only for its rate).
+#define MAX_PITCH_ROLL_DIVERGENCE 5e-3  // [deg]
+
+static void init(BalanceFilterData *bf, const RefloatConfig *config) {
+    *bf = (BalanceFilterData) {.q0 = 1.0f, .acc_mag = 1.0f};
+    balance_filter_configure(bf, config);
+}
+
+bool balance_filter_check(FILE *f, float duration) {
+    RefloatConfig config;
+    confparser_set_defaults_refloatconfig(&config);
+
+    BalanceFilterData scalar;
+    BalanceFilterData cmsis;
+    init(&scalar, &config);
+    init(&cmsis, &config);
+
+    uint32_t rng = 1;
+    double max_q_divergence = 0.0;
+    double max_pitch_divergence = 0.0;
+    double max_roll_divergence = 0.0;
+
+    const float dt = 1.0f / IMU_HZ;
+    const uint64_t steps = (uint64_t) (duration * IMU_HZ);
+    for (uint64_t i = 0; i < steps; ++i) {
+        double t = (double) i / IMU_HZ;
+
+        // Body orientation the accelerometer sees: slow carving and pumping
+        float pitch = 0.15f * sin(0.7 * t) + 0.05f * sin(5.3 * t);
+        float roll = 0.3f * sin(0.23 * t) + 0.1f * sin(2.9 * t);
+
+        float gyro[3] = {
+            0.3f * 0.23f * cos(0.23 * t) + 0.1f * 2.9f * cos(2.9 * t) + 0.02f * noise(&rng),
+            0.15f * 0.7f * cos(0.7 * t) + 0.05f * 5.3f * cos(5.3 * t) + 0.02f * noise(&rng),
+            0.5f * sin(0.11 * t) + 0.02f * noise(&rng),
+        };
+
+        float accel[3] = {
+            -sinf(pitch) + 0.05f * noise(&rng),
+            sinf(roll) * cosf(pitch) + 0.05f * noise(&rng),
+            cosf(roll) * cosf(pitch) + 0.05f * noise(&rng),
+        };
+
+        // An impact every 7 s, a 100 ms free fall every 23 s
+        double impact = fmod(t, 7.0);
+        if (impact < 0.02) {
+            accel[2] += 3.0f + noise(&rng);
+            accel[0] += noise(&rng);
+        }
+        if (fmod(t, 23.0) < 0.1) {
+            accel[0] = accel[1] = accel[2] = 0.0f;
+        }
+
+        balance_filter_update_scalar(&scalar, gyro, accel, dt);
+        balance_filter_update_cmsis(&cmsis, gyro, accel, dt);
+
+        double dq = sqrt(
+            pow(scalar.q0 - cmsis.q0, 2) + pow(scalar.q1 - cmsis.q1, 2) +
+            pow(scalar.q2 - cmsis.q2, 2) + pow(scalar.q3 - cmsis.q3, 2)
+        );
+        double dp =
+            fabs(balance_filter_get_pitch(&scalar) - balance_filter_get_pitch(&cmsis)) * 180 / M_PI;
+        double dr =
+            fabs(balance_filter_get_roll(&scalar) - balance_filter_get_roll(&cmsis)) * 180 / M_PI;
+
+        max_q_divergence = fmax(max_q_divergence, dq);
+        max_pitch_divergence = fmax(max_pitch_divergence, dp);
+        max_roll_divergence = fmax(max_roll_divergence, dr);
+    }
+
+    bool ok = max_pitch_divergence <= MAX_PITCH_ROLL_DIVERGENCE &&
+        max_roll_divergence <= MAX_PITCH_ROLL_DIVERGENCE;
+
+    fprintf(f, "duration,max_quaternion_divergence,max_pitch_divergence,max_roll_divergence\n");
+    fprintf(
+        f,
+        "%.0f,%.3g,%.3g,%.3g%s\n",
+        duration,
+        max_q_divergence,
+        max_pitch_divergence,
+        max_roll_divergence,
+        ok ? "" : ",FAIL"
+    );
+    return ok;
+}
@@ -0,0 +1,32 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * Runs balance_filter_update_scalar and balance_filter_update_cmsis side by
+ * side over a synthetic 1 kHz IMU trace of @p duration seconds (riding
+ * motion, sensor noise, impacts and short free falls) and prints the maximum
+ * divergence of their quaternions and pitch.
+ *
+ * @return true if the pitch and roll divergence stays within the bounds.
+ */
+bool balance_filter_check(FILE *f, float duration);
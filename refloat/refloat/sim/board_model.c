@@ -0,0 +1,318 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "board_model.h"
+
+#include "vesc_if_stub.h"
+
+#include <math.h>
+
+#define G 9.81f
+#define AIR_DENSITY 1.2f
+#define FOOTPAD_PRESSED_V 3.0f
+// Angle at which the nose or tail hits the ground
+#define GROUND_CONTACT_ANGLE (25.0f * M_PI / 180.0f)
+#define LANDING_IMPACT_TIME 0.05f
+#define LANDING_IMPACT_G 2.0f
+
+static float signf(float x) {
+    return x < 0 ? -1.0f : 1.0f;
+}
+
+static float lowpass_factor(float dt, float tau) {
+    return tau > dt ? dt / tau : 1.0f;
+}
+
+void board_model_params_default(BoardModelParams *p) {
+    p->mass = 90.0f;
+    p->com_height = 0.9f;
+    p->inertia = p->mass * p->com_height * p->com_height + 5.0f;
+    p->wheel_radius = 0.14f;
+    p->wheel_inertia = 0.1f;
+    p->rolling_resistance = 0.015f;
+    p->drag_area = 0.5f;
+
+    p->pole_pairs = 15;
+    p->kt = 0.8f;
+    p->resistance = 0.08f;
+    p->current_tau = 0.001f;
+    p->current_filter_tau = 0.003f;
+    p->battery_voltage = 60.0f;
+    p->battery_resistance = 0.1f;
+    p->max_duty = 0.95f;
+
+    p->rider_kp = 0.04f;
+    p->rider_ki = 0.02f;
+    p->rider_max_lean = 0.25f;
+    p->rider_tau = 0.3f;
+    p->rider_pitch_compensation = 0.8f;
+
+    p->vibration_frequency = 0.0f;
+    p->vibration_harmonic = 0.0f;
+    p->vibration_amplitude = 0.0f;
+}
+
+void board_model_init(BoardModel *m, const BoardModelParams *p) {
+    m->p = *p;
+
+    m->position = 0;
+    m->speed = 0;
+    m->wheel_speed = 0;
+    m->pitch = 0;
+    m->pitch_rate = 0;
+    m->yaw = 0;
+    m->lean = 0;
+    m->lean_integral = 0;
+    m->acceleration = 0;
+
+    m->motor_current = 0;
+    m->motor_current_filtered = 0;
+    m->duty = 0;
+    m->input_voltage = p->battery_voltage;
+
+    m->slipping = false;
+    m->grounded = true;
+    m->crashed = false;
+    m->landing_timer = 0;
+    m->was_airborne = false;
+    m->vibration_phase = 0;
+}
+
+float board_model_erpm(const BoardModel *m) {
+    return m->wheel_speed * (60.0f / (2.0f * M_PI)) * m->p.pole_pairs;
+}
+
+static void motor_update(BoardModel *m, float dt) {
+    const BoardModelParams *p = &m->p;
+
+    float target = 0;
+    switch (sim_hw.motor_mode) {
+    case SIM_MOTOR_CURRENT:
+        target = sim_hw.current_cmd;
+        break;
+    case SIM_MOTOR_BRAKE:
+        if (fabsf(m->wheel_speed) > 0.5f) {
+            target = -signf(m->wheel_speed) * sim_hw.brake_current_cmd;
+        }
+        break;
+    case SIM_MOTOR_OFF:
+        break;
+    }
+
+    float current_max = VESC_IF->get_cfg_float(CFG_PARAM_l_current_max);
+    float current_min = VESC_IF->get_cfg_float(CFG_PARAM_l_current_min);
+    target = fminf(fmaxf(target, current_min), current_max);
+
+    // The current controller can only push as much current as the voltage
+    // headroom above the back-EMF allows
+    float bemf = p->kt * m->wheel_speed;
+    float v_max = p->max_duty * m->input_voltage;
+    target = fminf(target, (v_max - bemf) / p->resistance);
+    target = fmaxf(target, (-v_max - bemf) / p->resistance);
+
+    m->motor_current += (target - m->motor_current) * lowpass_factor(dt, p->current_tau);
+    m->motor_current_filtered += (m->motor_current - m->motor_current_filtered) *
+        lowpass_factor(dt, p->current_filter_tau);
+
+    m->duty = (bemf + m->motor_current * p->resistance) / m->input_voltage;
+    m->duty = fminf(fmaxf(m->duty, -1.0f), 1.0f);
+
+    float current_in = m->duty * m->motor_current;
+    m->input_voltage = p->battery_voltage - current_in * p->battery_resistance;
+}
+
+static void rider_update(BoardModel *m, const BoardModelInput *in, float dt) {
+    const BoardModelParams *p = &m->p;
+
+    if (m->grounded || !in->rider_on) {
+        m->lean = 0;
+        m->lean_integral = 0;
+        return;
+    }
+
+    float error = in->target_speed - m->speed;
+    m->lean_integral += error * dt;
+    // anti-windup: the integral alone can't exceed the maximum lean
+    float integral_limit = p->rider_max_lean / p->rider_ki;
+    m->lean_integral = fminf(fmaxf(m->lean_integral, -integral_limit), integral_limit);
+
+    float lean_target = p->rider_kp * error + p->rider_ki * m->lean_integral +
+        p->rider_pitch_compensation * m->pitch;
+    lean_target = fminf(fmaxf(lean_target, -p->rider_max_lean), p->rider_max_lean);
+    m->lean += (lean_target - m->lean) * lowpass_factor(dt, p->rider_tau);
+}
+
+static void dynamics_update(BoardModel *m, const BoardModelInput *in, float dt) {
+    const BoardModelParams *p = &m->p;
+    const float r = p->wheel_radius;
+    const float torque = p->kt * m->motor_current;
+
+    if (m->grounded) {
+        // Resting on the ground, the rider keeps it level until engaged
+        m->speed *= 1.0f - lowpass_factor(dt, 0.5f);
+        m->wheel_speed = m->speed / r;
+        m->pitch_rate = 0;
+        m->acceleration = 0;
+        if (!m->crashed && in->rider_on && sim_hw.motor_mode == SIM_MOTOR_CURRENT) {
+            m->grounded = false;
+        }
+        return;
+    }
+
+    if (in->airborne) {
+        // Ballistic: no gravity torque in the falling frame, only the motor
+        // torque reaction between the wheel and the body
+        m->acceleration = 0;
+        m->pitch_rate += torque / p->inertia * dt;
+        m->wheel_speed += torque / p->wheel_inertia * dt;
+        m->slipping = true;
+    } else {
+        const float M = p->mass;
+        const float l = p->com_height;
+        const float normal = M * G * cosf(in->slope);
+
+        // Center of mass angle from vertical, positive forward
+        const float phi = m->lean - m->pitch;
+        const float phi_rate = -m->pitch_rate;
+
+        const float resistance = p->rolling_resistance * normal * signf(m->speed) *
+                fminf(fabsf(m->speed) / 0.1f, 1.0f) +
+            0.5f * AIR_DENSITY * p->drag_area * m->speed * fabsf(m->speed);
+        const float external = -resistance - M * G * sinf(in->slope) +
+            M * l * phi_rate * phi_rate * sinf(phi);
+
+        const float a12 = M * l * cosf(phi);
+        const float a22 = p->inertia;
+        const float b2 = M * G * l * sinf(phi) - torque;
+
+        float accel, phi_accel;
+        if (!m->slipping) {
+            const float a11 = M + p->wheel_inertia / (r * r);
+            const float b1 = torque / r + external;
+            const float det = a11 * a22 - a12 * a12;
+            accel = (b1 * a22 - a12 * b2) / det;
+            phi_accel = (a11 * b2 - a12 * b1) / det;
+
+            float traction_force = (torque - p->wheel_inertia * accel / r) / r;
+            if (fabsf(traction_force) > in->traction * normal) {
+                m->slipping = true;
+            }
+        }
+
+        if (m->slipping) {
+            float slip = m->wheel_speed * r - m->speed;
+            float traction_force = 0.8f * in->traction * normal * signf(slip);
+            if (fabsf(slip) < 0.01f) {
+                traction_force = 0;
+            }
+
+            const float b1 = traction_force + external;
+            const float det = M * a22 - a12 * a12;
+            accel = (b1 * a22 - a12 * b2) / det;
+            phi_accel = (M * b2 - a12 * b1) / det;
+
+            m->wheel_speed += (torque - traction_force * r) / p->wheel_inertia * dt;
+        }
+
+        m->acceleration = accel;
+        m->speed += accel * dt;
+        m->pitch_rate -= phi_accel * dt;
+
+        if (m->slipping) {
+            float slip = m->wheel_speed * r - m->speed;
+            // re-grip when the wheel catches up with the ground
+            if (fabsf(slip) < 0.05f && fabsf(torque / r) < in->traction * normal) {
+                m->slipping = false;
+            }
+        }
+        if (!m->slipping) {
+            m->wheel_speed = m->speed / r;
+        }
+    }
+
+    m->pitch += m->pitch_rate * dt;
+    m->position += m->speed * dt;
+
+    if (fabsf(m->pitch) > GROUND_CONTACT_ANGLE) {
+        m->pitch = signf(m->pitch) * GROUND_CONTACT_ANGLE;
+        m->pitch_rate = 0;
+        m->crashed = true;
+        m->grounded = true;
+        m->slipping = false;
+    }
+}
+
+static void publish(BoardModel *m, const BoardModelInput *in, float dt) {
+    sim_hw.pitch = m->pitch;
+    sim_hw.roll = 0;
+    sim_hw.yaw = remainderf(m->yaw, 2.0f * M_PI);
+
+    float vibration_frequency = m->p.vibration_frequency;
+    if (m->p.vibration_harmonic > 0) {
+        float electrical_frequency = fabsf(m->wheel_speed) / (2.0f * M_PI) * m->p.pole_pairs;
+        vibration_frequency = m->p.vibration_harmonic * electrical_frequency;
+    }
+    m->vibration_phase =
+        remainderf(m->vibration_phase + 2.0f * M_PI * vibration_frequency * dt, 2.0f * M_PI);
+
+    sim_hw.gyro[0] = 0;
+    sim_hw.gyro[1] = m->pitch_rate + m->p.vibration_amplitude * sinf(m->vibration_phase);
+    // The firmware yaw getter negates the angle, so the yaw grows with -Z
+    sim_hw.gyro[2] = -in->yaw_rate;
+
+    // Specific force in the world frame (forward, up), the acceleration is
+    // along the slope
+    float fx = 0, fz = 0;
+    if (!in->airborne) {
+        fx = m->acceleration * cosf(in->slope);
+        fz = m->acceleration * sinf(in->slope) + G;
+    }
+    if (m->landing_timer > 0) {
+        fz += LANDING_IMPACT_G * G;
+        m->landing_timer -= dt;
+    }
+
+    // IMU frame: x points backwards, z up, pitch positive nose-up
+    float sp = sinf(m->pitch), cp = cosf(m->pitch);
+    sim_hw.accel[0] = -(fx * cp + fz * sp) / G;
+    sim_hw.accel[1] = 0;
+    sim_hw.accel[2] = (-fx * sp + fz * cp) / G;
+
+    sim_hw.erpm = board_model_erpm(m);
+    sim_hw.duty = m->duty;
+    sim_hw.current = m->motor_current_filtered;
+    sim_hw.current_in = m->duty * m->motor_current;
+    sim_hw.input_voltage = m->input_voltage;
+
+    float footpad = in->rider_on ? FOOTPAD_PRESSED_V : 0.0f;
+    sim_hw.adc1 = footpad;
+    sim_hw.adc2 = footpad;
+}
+
+void board_model_step(BoardModel *m, const BoardModelInput *in, float dt) {
+    if (m->was_airborne && !in->airborne) {
+        m->landing_timer = LANDING_IMPACT_TIME;
+    }
+    m->was_airborne = in->airborne;
+
+    motor_update(m, dt);
+    rider_update(m, in, dt);
+    dynamics_update(m, in, dt);
+    m->yaw += in->yaw_rate * dt;
+
+    publish(m, in, dt);
+}
@@ -0,0 +1,113 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stdbool.h>
+
+/**
+ * One-wheel board and rider physics, as a cart with an inverted pendulum
+ * (rider + board) on top, driven by a hub motor with a current controller.
+ *
+ * Sign conventions: speed is positive forward, pitch is positive nose-up and
+ * relative to gravity, rider lean is positive forward, slope is positive
+ * uphill.
+ */
+typedef struct {
+    // Mechanics
+    float mass;  // rider + board [kg]
+    float com_height;  // center of mass above the axle [m]
+    float inertia;  // body inertia about the axle [kg m^2]
+    float wheel_radius;  // [m]
+    float wheel_inertia;  // [kg m^2]
+    float rolling_resistance;  // coefficient
+    float drag_area;  // Cd * A [m^2]
+
+    // Motor and battery
+    int pole_pairs;
+    float kt;  // torque constant, also the back-EMF constant [Nm/A]
+    float resistance;  // winding resistance [ohm]
+    float current_tau;  // current controller time constant [s]
+    float current_filter_tau;  // filtered current readout time constant [s]
+    float battery_voltage;  // open-circuit [V]
+    float battery_resistance;  // [ohm]
+    float max_duty;
+
+    // Rider
+    float rider_kp;  // lean per speed error [rad / (m/s)]
+    float rider_ki;
+    float rider_max_lean;  // [rad]
+    float rider_tau;  // reaction time constant [s]
+    // How much the rider straightens up when the board pitches, 1 keeps the
+    // center of mass angle independent of the board pitch
+    float rider_pitch_compensation;
+
+    // Sensor
+    // Sinusoidal vibration added to the pitch gyro rate (e.g. from the motor or
+    // the tire), doesn't move the board. Either at a fixed frequency, or at a
+    // multiple of the motor electrical frequency if vibration_harmonic > 0.
+    float vibration_frequency;  // [Hz]
+    float vibration_harmonic;
+    float vibration_amplitude;  // [rad/s]
+} BoardModelParams;
+
+typedef struct {
+    // Scenario inputs
+    float target_speed;  // what the rider wants to ride at [m/s]
+    float slope;  // [rad]
+    float traction;  // friction coefficient
+    float yaw_rate;  // [rad/s]
+    bool airborne;
+    bool rider_on;
+} BoardModelInput;
+
+typedef struct {
+    BoardModelParams p;
+
+    float position;
+    float speed;  // over ground [m/s]
+    float wheel_speed;  // wheel angular speed [rad/s]
+    float pitch, pitch_rate;
+    float yaw;
+    float lean;
+    float lean_integral;
+    float acceleration;
+
+    float motor_current;
+    float motor_current_filtered;
+    float duty;
+    float input_voltage;
+
+    bool slipping;
+    bool grounded;  // resting on the ground before engaging / after a crash
+    bool crashed;  // nose or tail hit the ground while riding
+    float landing_timer;
+    bool was_airborne;
+    float vibration_phase;  // [rad]
+} BoardModel;
+
+void board_model_params_default(BoardModelParams *p);
+
+void board_model_init(BoardModel *m, const BoardModelParams *p);
+
+/**
+ * Advances the model by @p dt using the motor command from the stub VESC_IF
+ * and publishes the resulting IMU, motor and footpad values to it.
+ */
+void board_model_step(BoardModel *m, const BoardModelInput *in, float dt);
+
+float board_model_erpm(const BoardModel *m);
@@ -0,0 +1,169 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "fast_math_check.h"
+
+#include "fast_math.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    const char *name;
+    double bound;  // The bound documented in fast_math.h
+    double max_error;
+    float worst;
+    double ns_per_call;
+} CheckResult;
+
+static float float_from_bits(uint32_t i) {
+    float f;
+    memcpy(&f, &i, sizeof(f));
+    return f;
+}
+
+static uint32_t float_bits(float f) {
+    uint32_t i;
+    memcpy(&i, &f, sizeof(i));
+    return i;
+}
+
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void update(CheckResult *r, double error, float x) {
+    if (error > r->max_error) {
+        r->max_error = error;
+        r->worst = x;
+    }
+}
+
+static double asin_error(float x) {
+    return fabs(fast_asinf(x) - asin(x));
+}
+
+static double acos_error(float x) {
+    return fabs(fast_acosf(x) - acos(x));
+}
+
+// Covers every ratio of y / x in all four quadrants
+static double atan2_error(float t) {
+    return fmax(
+        fabs(fast_atan2f(t, 1.0f) - atan2(t, 1.0)), fabs(fast_atan2f(1.0f, t) - atan2(1.0, t))
+    );
+}
+
+static double sin_error(float x) {
+    float s, c;
+    fast_sincosf(x, &s, &c);
+    return fabs(s - sin(x));
+}
+
+static double cos_error(float x) {
+    return fabs(fast_cosf(x) - cos(x));
+}
+
+// Relative error over the positive normal floats
+static double inv_sqrt_error(float x) {
+    if (!(x >= FLT_MIN && x < INFINITY)) {
+        return 0.0;
+    }
+    return fabs(fast_inv_sqrtf(x) * sqrt(x) - 1.0);
+}
+
+// Walks every stride-th float in [-max, max]
+static void sweep(CheckResult *r, double (*error)(float), float max, uint32_t stride) {
+    for (uint32_t i = 0, end = float_bits(max); i <= end; i += stride) {
+        float x = float_from_bits(i);
+        update(r, error(x), x);
+        update(r, error(-x), -x);
+    }
+}
+
+// Host time per call over a fixed set of inputs, the sum keeps the calls alive
+static double time_per_call(float (*fn)(float), float min, float max) {
+    const int n = 1000000;
+    volatile float sink = 0.0f;
+    float sum = 0.0f;
+    double start = now_ns();
+    for (int i = 0; i < n; ++i) {
+        sum += fn(min + (max - min) * i / n);
+    }
+    sink = sum;
+    (void) sink;
+    return (now_ns() - start) / n;
+}
+
+static float atan2_ratio(float t) {
+    return fast_atan2f(t, 1.0f);
+}
+
+static float sin_of(float x) {
+    float s, c;
+    fast_sincosf(x, &s, &c);
+    return s;
+}
+
+bool fast_math_check(FILE *f, uint32_t stride) {
+    CheckResult results[] = {
+        {.name = "asin", .bound = 1.7e-7},
+        {.name = "acos", .bound = 3.1e-7},
+        {.name = "atan2", .bound = 3.0e-7},
+        {.name = "sin", .bound = 7.8e-8},
+        {.name = "cos", .bound = 7.8e-8},
+        {.name = "inv_sqrt", .bound = 4.8e-6},
+    };
+
+    sweep(&results[0], asin_error, 1.0f, stride);
+    sweep(&results[1], acos_error, 1.0f, stride);
+    sweep(&results[2], atan2_error, INFINITY, stride);
+    sweep(&results[3], sin_error, 2.0f * M_PI, stride);
+    sweep(&results[4], cos_error, 2.0f * M_PI, stride);
+    sweep(&results[5], inv_sqrt_error, INFINITY, stride);
+
+    results[0].ns_per_call = time_per_call(fast_asinf, -1.0f, 1.0f);
+    results[1].ns_per_call = time_per_call(fast_acosf, -1.0f, 1.0f);
+    results[2].ns_per_call = time_per_call(atan2_ratio, -10.0f, 10.0f);
+    results[3].ns_per_call = time_per_call(sin_of, -M_PI, M_PI);
+    results[4].ns_per_call = time_per_call(fast_cosf, -M_PI, M_PI);
+    results[5].ns_per_call = time_per_call(fast_inv_sqrtf, 0.01f, 100.0f);
+
+    bool ok = true;
+    fprintf(f, "function,max_error,worst_input,bound,ns_per_call\n");
+    for (unsigned int i = 0; i < sizeof(results) / sizeof(results[0]); ++i) {
+        const CheckResult *r = &results[i];
+        bool pass = r->max_error <= r->bound;
+        ok = ok && pass;
+        fprintf(
+            f,
+            "%s,%.3g,%.9g,%.3g,%.2f%s\n",
+            r->name,
+            r->max_error,
+            r->worst,
+            r->bound,
+            r->ns_per_call,
+            pass ? "" : ",FAIL"
+        );
+    }
+    return ok;
+}
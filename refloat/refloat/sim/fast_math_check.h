@@ -0,0 +1,33 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Compares the functions in c_libs/utils/fast_math.h against double precision
+ * libm over every stride-th float of their domain and prints the maximum
+ * error and the host time per call of each. With stride 1 the check is
+ * exhaustive and takes around twenty minutes.
+ *
+ * @return true if all functions are within their documented error bounds.
+ */
+bool fast_math_check(FILE *f, uint32_t stride);
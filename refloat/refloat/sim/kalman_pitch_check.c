@@ -0,0 +1,137 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "kalman_pitch_check.h"
+#include "noise.h"
+
+#include "kalman_pitch.h"
+
+#include <math.h>
+#include <stdint.h>
+
+#define IMU_HZ 1000
+#define SLOW_UPDATE_DIVIDER 4
+
+// The TKJ defaults, in degrees
+#define Q_ANGLE 0.001f
+#define Q_BIAS 0.003f
+#define R_MEASURE 0.03f
+
+#define GYRO_BIAS 0.8f  // [deg/s]
+#define GYRO_NOISE 0.5f  // [deg/s], uniform amplitude
+#define ANGLE_NOISE 2.0f  // [deg], uniform amplitude
+
+#define MAX_BIAS_ERROR 0.1f  // [deg/s]
+#define MAX_REFERENCE_DIFFERENCE 1e-3  // [deg]
+
+// The filter as it was in tnt.c, with all four covariance terms
+typedef struct {
+    float angle, bias;
+    float p00, p01, p10, p11;
+} Reference;
+
+static void reference_step(Reference *r, float rate, float angle, float dt) {
+    r->angle += dt * (rate - r->bias);
+    r->p00 += dt * (dt * r->p11 - r->p01 - r->p10 + Q_ANGLE);
+    r->p01 -= dt * r->p11;
+    r->p10 -= dt * r->p11;
+    r->p11 += Q_BIAS * dt;
+
+    float s = r->p00 + R_MEASURE;
+    float k0 = r->p00 / s;
+    float k1 = r->p10 / s;
+    float y = angle - r->angle;
+    r->angle += k0 * y;
+    r->bias += k1 * y;
+
+    float p00 = r->p00;
+    float p01 = r->p01;
+    r->p00 -= k0 * p00;
+    r->p01 -= k0 * p01;
+    r->p10 -= k1 * p00;
+    r->p11 -= k1 * p01;
+}
+
+bool kalman_pitch_check(FILE *f, float duration) {
+    KalmanPitch every;
+    KalmanPitch slow;
+    kalman_pitch_configure(&every, Q_ANGLE, Q_BIAS, R_MEASURE);
+    kalman_pitch_reset(&every, 0.0f);
+    slow = every;
+    Reference reference = {0};
+
+    uint32_t rng = 1;
+    double sq_measurement = 0.0;
+    double sq_every = 0.0;
+    double sq_slow = 0.0;
+    double max_reference = 0.0;
+
+    const float dt = 1.0f / IMU_HZ;
+    const uint64_t steps = (uint64_t) (duration * IMU_HZ);
+    for (uint64_t i = 0; i < steps; ++i) {
+        double t = (double) (i + 1) / IMU_HZ;
+
+        float pitch = 8.0f * sin(0.7 * t) + 3.0f * sin(5.3 * t);
+        float rate = 8.0f * 0.7f * cos(0.7 * t) + 3.0f * 5.3f * cos(5.3 * t) + GYRO_BIAS +
+            GYRO_NOISE * noise(&rng);
+        float measured = pitch + ANGLE_NOISE * noise(&rng);
+
+        kalman_pitch_predict(&every, rate, dt);
+        kalman_pitch_update(&every, measured);
+
+        kalman_pitch_predict(&slow, rate, dt);
+        if (i % SLOW_UPDATE_DIVIDER == 0) {
+            kalman_pitch_update(&slow, measured);
+        }
+
+        reference_step(&reference, rate, measured, dt);
+
+        sq_measurement += (measured - pitch) * (measured - pitch);
+        sq_every += (every.angle - pitch) * (every.angle - pitch);
+        sq_slow += (slow.angle - pitch) * (slow.angle - pitch);
+        max_reference = fmax(max_reference, fabs(every.angle - reference.angle));
+    }
+
+    double rms_measurement = sqrt(sq_measurement / steps);
+    double rms_every = sqrt(sq_every / steps);
+    double rms_slow = sqrt(sq_slow / steps);
+
+    bool ok = rms_every < rms_measurement && rms_slow < rms_measurement &&
+        fabsf(every.bias - GYRO_BIAS) < MAX_BIAS_ERROR &&
+        fabsf(slow.bias - GYRO_BIAS) < MAX_BIAS_ERROR && max_reference < MAX_REFERENCE_DIFFERENCE;
+
+    fprintf(
+        f,
+        "duration,measurement_rms,rms,rms_update_every_%d,bias,bias_update_every_%d,"
+        "max_reference_difference\n",
+        SLOW_UPDATE_DIVIDER,
+        SLOW_UPDATE_DIVIDER
+    );
+    fprintf(
+        f,
+        "%.0f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3g%s\n",
+        duration,
+        rms_measurement,
+        rms_every,
+        rms_slow,
+        every.bias,
+        slow.bias,
+        max_reference,
+        ok ? "" : ",FAIL"
+    );
+    return ok;
+}
@@ -0,0 +1,34 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * Runs c_libs/utils/kalman_pitch over a synthetic 1 kHz trace of @p duration
+ * seconds (a pitch oscillation seen by a biased, noisy gyro and a noisy
+ * absolute angle) and prints the pitch error and the final bias estimate,
+ * with the correction every sample and every fourth sample. It also runs the
+ * original four-term covariance filter from TNT side by side and prints the
+ * maximum difference.
+ *
+ * @return true if the filter follows the pitch better than the measurement,
+ * finds the gyro bias and matches the original filter.
+ */
+bool kalman_pitch_check(FILE *f, float duration);
@@ -0,0 +1,41 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+// Host replacement for led_driver.c, which drives the LED strip through the
+// STM32 timer and DMA peripherals. The strip data are accepted and dropped.
+
+#include "led_driver.h"
+
+bool led_driver_init(
+    LedDriver *driver, LedPin pin, [[maybe_unused]] LedType type, [[maybe_unused]] uint8_t led_nr
+) {
+    driver->bit_nr = 0;
+    driver->bitbuffer = 0;
+    driver->bitbuffer_length = 0;
+    driver->pin = pin;
+    return true;
+}
+
+void led_driver_paint(
+    [[maybe_unused]] LedDriver *driver,
+    [[maybe_unused]] uint32_t *data,
+    [[maybe_unused]] uint32_t length
+) {
+}
+
+void led_driver_destroy([[maybe_unused]] LedDriver *driver) {
+}
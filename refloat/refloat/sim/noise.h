@@ -1,4 +1,3 @@
-// Copyright 2022 Benjamin Vedder <benjamin@vedder.se>
 // Copyright 2024 Lukas Hrazky
 //
 // This file is part of the Refloat VESC package.
@@ -18,18 +17,13 @@
 
 #pragma once
 
-typedef struct {
-    float a0, a1, a2, b1, b2;
-    float z1, z2;
-} Biquad;
+#include <stdint.h>
 
-typedef enum {
-    BQ_LOWPASS,
-    BQ_HIGHPASS
-} BiquadType;
-
-float biquad_process(Biquad *biquad, float in);
-
-void biquad_configure(Biquad *biquad, BiquadType type, float frequency);
-
-void biquad_reset(Biquad *biquad);
+/**
+ * Deterministic uniform noise in [-1, 1] for the synthetic traces of the
+ * checks, the same @p state seed gives the same sequence on every host.
+ */
+static inline float noise(uint32_t *state) {
+    *state = *state * 1664525u + 1013904223u;
+    return (float) (*state >> 8) / (1 << 23) - 1.0f;
+}
@@ -0,0 +1,110 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "scenarios.h"
+
+#include <math.h>
+#include <string.h>
+
+#define STEP_ON_TIME 1.0f
+
+static float ramp(float t, float start, float end, float from, float to) {
+    if (t <= start) {
+        return from;
+    } else if (t >= end) {
+        return to;
+    }
+    return from + (to - from) * (t - start) / (end - start);
+}
+
+static void defaults(float t, BoardModelInput *in) {
+    in->target_speed = 0;
+    in->slope = 0;
+    in->traction = 1.0f;
+    in->yaw_rate = 0;
+    in->airborne = false;
+    in->rider_on = t >= STEP_ON_TIME;
+}
+
+static void flat_ride(float t, [[maybe_unused]] const BoardModel *m, BoardModelInput *in) {
+    defaults(t, in);
+    in->target_speed = ramp(t, 3, 6, 0, 5) - ramp(t, 20, 24, 0, 5);
+    if (t > 10 && t < 16) {
+        // carving
+        in->yaw_rate = 0.6f * sinf((t - 10) * M_PI);
+    }
+}
+
+static void hill_climb(float t, [[maybe_unused]] const BoardModel *m, BoardModelInput *in) {
+    defaults(t, in);
+    in->target_speed = ramp(t, 3, 6, 0, 4) - ramp(t, 38, 42, 0, 4);
+    // 15% up, level, 15% down
+    in->slope = ramp(t, 8, 10, 0, atanf(0.15f)) - ramp(t, 20, 22, 0, atanf(0.15f)) -
+        ramp(t, 26, 28, 0, atanf(0.15f)) + ramp(t, 34, 36, 0, atanf(0.15f));
+}
+
+static void hard_brake(float t, [[maybe_unused]] const BoardModel *m, BoardModelInput *in) {
+    defaults(t, in);
+    in->target_speed = ramp(t, 3, 8, 0, 6) - ramp(t, 14, 15.5f, 0, 6);
+}
+
+static void wheelslip(float t, [[maybe_unused]] const BoardModel *m, BoardModelInput *in) {
+    defaults(t, in);
+    in->target_speed = ramp(t, 3, 6, 0, 4) + ramp(t, 10, 11, 0, 3) - ramp(t, 16, 19, 0, 7);
+    // wet patch while accelerating
+    if (t > 10.5f && t < 10.8f) {
+        in->traction = 0.06f;
+    }
+}
+
+static void pushback(float t, const BoardModel *m, BoardModelInput *in) {
+    defaults(t, in);
+    // asks for more than the motor can do, until the duty beep and the
+    // pushback make the rider back off
+    in->target_speed = ramp(t, 3, 15, 0, 13) - ramp(t, 24, 28, 0, 13);
+    in->slope = ramp(t, 16, 18, 0, atanf(0.05f));
+    if (m->duty > 0.82f) {
+        in->target_speed = fminf(in->target_speed, m->speed - 1.0f);
+    }
+}
+
+static void drop_landing(float t, [[maybe_unused]] const BoardModel *m, BoardModelInput *in) {
+    defaults(t, in);
+    in->target_speed = ramp(t, 3, 5, 0, 3) - ramp(t, 20, 22, 0, 3);
+    // off a curb and off a higher ledge
+    in->airborne = (t > 8 && t < 8.3f) || (t > 14 && t < 14.55f);
+}
+
+const Scenario scenarios[] = {
+    {"flat_ride", "accelerate to 5 m/s, carve, stop", 26, flat_ride},
+    {"hill_climb", "15% climb and descent at 4 m/s", 44, hill_climb},
+    {"hard_brake", "accelerate to 6 m/s and stop in 1.5 s", 20, hard_brake},
+    {"wheelslip", "accelerate over a wet patch", 21, wheelslip},
+    {"pushback", "ride into duty cycle pushback, back off on the duty beep", 30, pushback},
+    {"drop_landing", "two drops at 3 m/s, 0.3 s and 0.55 s of air", 24, drop_landing},
+};
+
+const unsigned int scenario_count = sizeof(scenarios) / sizeof(scenarios[0]);
+
+const Scenario *scenario_find(const char *name) {
+    for (unsigned int i = 0; i < scenario_count; ++i) {
+        if (strcmp(scenarios[i].name, name) == 0) {
+            return &scenarios[i];
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,37 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "board_model.h"
+
+/**
+ * A scripted ride: the rider steps on the board, then the scenario drives the
+ * rider's target speed and the terrain over time. The board model state is
+ * available for riders reacting to the board.
+ */
+typedef struct {
+    const char *name;
+    const char *description;
+    float duration;  // [s]
+    void (*input)(float t, const BoardModel *m, BoardModelInput *in);
+} Scenario;
+
+extern const Scenario scenarios[];
+extern const unsigned int scenario_count;
+
+const Scenario *scenario_find(const char *name);
@@ -0,0 +1,610 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "accel_estimator_check.h"
+#include "balance_filter_check.h"
+#include "board_model.h"
+#include "fast_math_check.h"
+#include "kalman_pitch_check.h"
+#include "telemetry_codec_check.h"
+#include "scenarios.h"
+#include "tune.h"
+#include "vesc_if_stub.h"
+
+#include "conf/buffer.h"
+#include "conf/confparser.h"
+#include "state.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_OVERRIDES 32
+#define MAX_SWEEPS 4
+#define TELEMETRY_PERIOD_US 10000
+#define RAD_TO_DEG(x) ((x) * 180.0f / M_PI)
+
+typedef struct {
+    char name[48];
+    float value;
+} Override;
+
+typedef struct {
+    char name[48];
+    float start, stop, step;
+    float value;
+} Sweep;
+
+typedef struct {
+    bool engaged;
+    float engage_time;
+    unsigned int disengagements;  // while the rider was still on
+    StopCondition last_stop;
+    bool crashed;
+
+    unsigned int samples;
+    float pitch_error_sq, pitch_error_max;  // setpoint - balance_pitch
+    float speed_error_sq;
+    float current_max, duty_max;
+    float atr_max, torque_tilt_max, setpoint_max;
+    float slip_time;
+    float speed_max;
+
+    // Loop timing while running, from COMMAND_LOOP_TIMING
+    float loop_hz;
+    float period_p99;
+    float compute_p99;
+    float sample_age_p99;
+    uint32_t overruns;
+    uint32_t stale;
+} Metrics;
+
+// Last parsed COMMAND_GET_RTDATA_2 response
+typedef struct {
+    bool valid;
+    RunState state;
+    StopCondition stop_condition;
+    float pitch, balance_pitch;
+    float setpoint, atr, braketilt, torque_tilt, turntilt;
+    float pid_value;
+} Telemetry;
+
+typedef struct {
+    const Scenario *scenario;
+    BoardModel model;
+    BoardModelInput input;
+    Telemetry telemetry;
+    Metrics metrics;
+    uint64_t next_telemetry_us;
+    FILE *trace;
+} World;
+
+static void telemetry_parse(World *w, unsigned char *data) {
+    Telemetry *t = &w->telemetry;
+
+    int32_t ind = 2;
+    uint8_t mask = data[ind++];
+    t->state = data[ind++] & 0xF;
+    ind++;
+    t->stop_condition = data[ind++] & 0xF;
+    ind++;
+    t->pitch = buffer_get_float32_auto(data, &ind);
+    t->balance_pitch = buffer_get_float32_auto(data, &ind);
+    ind += 4 * 4;  // roll, adc1, adc2, throttle
+
+    if (mask & 0x1) {
+        t->setpoint = buffer_get_float32_auto(data, &ind);
+        t->atr = buffer_get_float32_auto(data, &ind);
+        t->braketilt = buffer_get_float32_auto(data, &ind);
+        t->torque_tilt = buffer_get_float32_auto(data, &ind);
+        t->turntilt = buffer_get_float32_auto(data, &ind);
+        ind += 4;  // inputtilt
+        t->pid_value = buffer_get_float32_auto(data, &ind);
+    }
+    t->valid = true;
+}
+
+static void loop_timing_parse(World *w, unsigned char *data) {
+    Metrics *m = &w->metrics;
+
+    int32_t ind = 2;
+    ind += 2;  // hertz
+    buffer_get_float32_auto(data, &ind);  // bucket width
+    uint8_t states = data[ind++];
+    for (int i = 0; i < states; ++i) {
+        uint32_t iterations = buffer_get_uint32(data, &ind);
+        uint32_t overruns = buffer_get_uint32(data, &ind);
+        float compute[4], period[4], sample_age[4];  // min, mean, max, p99
+        for (int j = 0; j < 4; ++j) {
+            compute[j] = buffer_get_float32_auto(data, &ind);
+        }
+        for (int j = 0; j < 4; ++j) {
+            period[j] = buffer_get_float32_auto(data, &ind);
+        }
+        uint32_t stale = buffer_get_uint32(data, &ind);
+        for (int j = 0; j < 4; ++j) {
+            sample_age[j] = buffer_get_float32_auto(data, &ind);
+        }
+
+        if (i == STATE_RUNNING && iterations > 0) {
+            m->loop_hz = 1.0f / period[1];
+            m->period_p99 = period[3];
+            m->compute_p99 = compute[3];
+            m->overruns = overruns;
+            m->sample_age_p99 = sample_age[3];
+            m->stale = stale;
+        }
+    }
+}
+
+static void app_data_received(unsigned char *data, unsigned int len, void *arg) {
+    World *w = arg;
+
+    if (len < 2 || data[0] != 101) {
+        return;
+    }
+
+    switch (data[1]) {
+    case 201:
+        telemetry_parse(w, data);
+        break;
+    case 203:
+        loop_timing_parse(w, data);
+        break;
+    }
+}
+
+static void request_telemetry() {
+    unsigned char rt_data[] = {101, 201};
+    sim_send_command(rt_data, sizeof(rt_data));
+    unsigned char loop_timing[] = {101, 203};
+    sim_send_command(loop_timing, sizeof(loop_timing));
+}
+
+static void metrics_update(World *w, float t) {
+    Metrics *m = &w->metrics;
+    const Telemetry *tm = &w->telemetry;
+    const BoardModel *b = &w->model;
+
+    if (tm->state == STATE_RUNNING) {
+        if (!m->engaged) {
+            m->engaged = true;
+            m->engage_time = t;
+        }
+
+        float pitch_error = tm->setpoint - tm->balance_pitch;
+        float speed_error = w->input.target_speed - b->speed;
+        m->pitch_error_sq += pitch_error * pitch_error;
+        m->pitch_error_max = fmaxf(m->pitch_error_max, fabsf(pitch_error));
+        m->speed_error_sq += speed_error * speed_error;
+        m->atr_max = fmaxf(m->atr_max, fabsf(tm->atr));
+        m->torque_tilt_max = fmaxf(m->torque_tilt_max, fabsf(tm->torque_tilt));
+        m->setpoint_max = fmaxf(m->setpoint_max, fabsf(tm->setpoint));
+        ++m->samples;
+    } else if (m->engaged && tm->stop_condition != m->last_stop && w->input.rider_on) {
+        ++m->disengagements;
+    }
+    m->last_stop = tm->stop_condition;
+
+    m->crashed |= b->crashed;
+    m->current_max = fmaxf(m->current_max, fabsf(b->motor_current));
+    m->duty_max = fmaxf(m->duty_max, fabsf(b->duty));
+    m->speed_max = fmaxf(m->speed_max, fabsf(b->speed));
+}
+
+static void trace_write(World *w, float t) {
+    const Telemetry *tm = &w->telemetry;
+    const BoardModel *b = &w->model;
+
+    fprintf(
+        w->trace,
+        "%s,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.2f,%.3f,%d,%d,%d\n",
+        w->scenario->name,
+        t,
+        w->input.target_speed,
+        b->speed,
+        RAD_TO_DEG(b->pitch),
+        RAD_TO_DEG(b->lean),
+        tm->balance_pitch,
+        tm->setpoint,
+        tm->atr,
+        tm->torque_tilt,
+        b->motor_current,
+        b->duty,
+        tm->state,
+        b->slipping,
+        b->crashed
+    );
+}
+
+static void world_tick(float dt, void *arg) {
+    World *w = arg;
+    float t = sim_time_us() / 1e6f;
+
+    w->scenario->input(t, &w->model, &w->input);
+    board_model_step(&w->model, &w->input, dt);
+
+    if (w->model.slipping && !w->input.airborne) {
+        w->metrics.slip_time += dt;
+    }
+
+    if (sim_time_us() >= w->next_telemetry_us) {
+        w->next_telemetry_us += TELEMETRY_PERIOD_US;
+        request_telemetry();
+        metrics_update(w, t);
+        if (w->trace) {
+            trace_write(w, t);
+        }
+    }
+}
+
+static bool run_scenario(
+    const Scenario *scenario,
+    const RefloatConfig *config,
+    const BoardModelParams *params,
+    unsigned int imu_hz,
+    uint32_t jitter_us,
+    FILE *trace,
+    Metrics *metrics
+) {
+    World w = {0};
+    w.scenario = scenario;
+    w.trace = trace;
+    board_model_init(&w.model, params);
+    scenario->input(0, &w.model, &w.input);
+
+    sim_init(imu_hz, scenario->duration);
+    sim_set_wakeup_jitter(jitter_us);
+    sim_eeprom_store_config(config, sizeof(RefloatConfig), REFLOATCONFIG_SIGNATURE);
+    sim_set_tick_callback(world_tick, &w);
+    sim_set_app_data_callback(app_data_received, &w);
+
+    if (!sim_run()) {
+        return false;
+    }
+
+    *metrics = w.metrics;
+    return true;
+}
+
+static void print_header(const Sweep *sweeps, int sweep_count) {
+    for (int i = 0; i < sweep_count; ++i) {
+        printf("%s,", sweeps[i].name);
+    }
+    printf(
+        "scenario,engaged,engage_time,disengagements,last_stop,crashed,pitch_err_rms,"
+        "pitch_err_max,speed_err_rms,current_max,duty_max,speed_max,setpoint_max,atr_max,"
+        "torque_tilt_max,slip_time,loop_hz,period_p99_us,compute_p99_us,overruns,"
+        "sample_age_p99_us,stale\n"
+    );
+}
+
+static void print_metrics(
+    const Sweep *sweeps, int sweep_count, const Scenario *scenario, const Metrics *m
+) {
+    for (int i = 0; i < sweep_count; ++i) {
+        printf("%g,", sweeps[i].value);
+    }
+
+    float n = m->samples > 0 ? m->samples : 1;
+    printf(
+        "%s,%d,%.2f,%u,%d,%d,%.3f,%.3f,%.3f,%.1f,%.3f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.0f,%.0f,%u,%.0f,%u\n",
+        scenario->name,
+        m->engaged,
+        m->engage_time,
+        m->disengagements,
+        m->last_stop,
+        m->crashed,
+        sqrtf(m->pitch_error_sq / n),
+        m->pitch_error_max,
+        sqrtf(m->speed_error_sq / n),
+        m->current_max,
+        m->duty_max,
+        m->speed_max,
+        m->setpoint_max,
+        m->atr_max,
+        m->torque_tilt_max,
+        m->slip_time,
+        m->loop_hz,
+        m->period_p99 * 1e6f,
+        m->compute_p99 * 1e6f,
+        m->overruns,
+        m->sample_age_p99 * 1e6f,
+        m->stale
+    );
+}
+
+// Advances the sweep values like an odometer, returns false after the last combination.
+static bool sweep_next(Sweep *sweeps, int sweep_count) {
+    for (int i = sweep_count - 1; i >= 0; --i) {
+        sweeps[i].value += sweeps[i].step;
+        if (sweeps[i].value <= sweeps[i].stop + sweeps[i].step * 1e-3f) {
+            return true;
+        }
+        sweeps[i].value = sweeps[i].start;
+    }
+    return false;
+}
+
+static bool parse_override(const char *arg, Override *o) {
+    const char *eq = strchr(arg, '=');
+    if (!eq || eq - arg >= (int) sizeof(o->name)) {
+        return false;
+    }
+
+    snprintf(o->name, sizeof(o->name), "%.*s", (int) (eq - arg), arg);
+    o->value = atof(eq + 1);
+    return true;
+}
+
+static bool parse_sweep(const char *arg, Sweep *s) {
+    const char *eq = strchr(arg, '=');
+    if (!eq || eq - arg >= (int) sizeof(s->name)) {
+        return false;
+    }
+
+    snprintf(s->name, sizeof(s->name), "%.*s", (int) (eq - arg), arg);
+    if (sscanf(eq + 1, "%f:%f:%f", &s->start, &s->stop, &s->step) != 3 || s->step <= 0 ||
+        s->stop < s->start) {
+        return false;
+    }
+    s->value = s->start;
+    return true;
+}
+
+static void usage(const char *name) {
+    fprintf(
+        stderr,
+        "Usage: %s [-s scenario|all] [-p name=value]... [-w name=start:stop:step]...\n"
+        "          [-i imu_hz] [-j jitter_us] [-c trace.csv] [-b] [-l] [-m stride]\n"
+        "          [-f seconds] [-k seconds] [-a] [-t] [-v hz:amplitude]\n"
+        "\n"
+        "  -s  scenario to run (default all)\n"
+        "  -p  override a config value\n"
+        "  -w  sweep a config value, multiple sweeps run all combinations\n"
+        "  -i  IMU sample rate in Hz (default 1000)\n"
+        "  -j  wake up the package thread late by up to this many microseconds\n"
+        "  -v  add a vibration to the pitch gyro rate, amplitude in deg/s, the frequency\n"
+        "      is in Hz or a multiple of the motor electrical frequency with an 'x' suffix\n"
+        "  -c  write a 100 Hz trace of every run to a CSV file\n"
+        "  -b  benchmark: print the wall time of each run to stderr\n"
+        "  -l  list scenarios and config values\n"
+        "  -m  check the fast math functions against libm over every stride-th float,\n"
+        "      1 is exhaustive (minutes), exits non-zero if an error bound is exceeded\n"
+        "  -f  compare the scalar and CMSIS balance filter updates over a synthetic IMU\n"
+        "      trace this long, exits non-zero if they diverge\n"
+        "  -k  run the Kalman pitch filter over a synthetic trace this long, exits\n"
+        "      non-zero if it doesn't beat the measurement or find the gyro bias\n"
+        "  -a  compare the acceleration estimators on synthetic ERPM steps, ramps and\n"
+        "      noise, exits non-zero if one doesn't converge or lags the moving average\n"
+        "  -t  round-trip a synthetic ride through the compact telemetry codec, exits\n"
+        "      non-zero if a value doesn't decode or the frames aren't smaller than plain\n"
+        "\n"
+        "Prints a CSV line of metrics for each run. Angles are in degrees.\n",
+        name
+    );
+}
+
+static void list(FILE *f) {
+    fprintf(f, "Scenarios:\n");
+    for (unsigned int i = 0; i < scenario_count; ++i) {
+        fprintf(
+            f,
+            "  %-14s %4.0f s  %s\n",
+            scenarios[i].name,
+            scenarios[i].duration,
+            scenarios[i].description
+        );
+    }
+    fprintf(f, "Config values:");
+    tune_print_names(f);
+}
+
+int main(int argc, char **argv) {
+    const char *scenario_name = "all";
+    const char *trace_path = NULL;
+    unsigned int imu_hz = 1000;
+    uint32_t jitter_us = 0;
+    bool benchmark = false;
+    float vibration_hz = 0;
+    float vibration_harmonic = 0;
+    float vibration_amplitude = 0;
+
+    Override overrides[MAX_OVERRIDES];
+    int override_count = 0;
+    Sweep sweeps[MAX_SWEEPS];
+    int sweep_count = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:p:w:i:j:c:v:blm:f:k:ath")) != -1) {
+        switch (opt) {
+        case 's':
+            scenario_name = optarg;
+            break;
+        case 'p':
+            if (override_count == MAX_OVERRIDES ||
+                !parse_override(optarg, &overrides[override_count++])) {
+                fprintf(stderr, "Invalid override: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'w':
+            if (sweep_count == MAX_SWEEPS || !parse_sweep(optarg, &sweeps[sweep_count++])) {
+                fprintf(stderr, "Invalid sweep: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'i':
+            imu_hz = atoi(optarg);
+            break;
+        case 'j':
+            jitter_us = atoi(optarg);
+            break;
+        case 'c':
+            trace_path = optarg;
+            break;
+        case 'v': {
+            char unit = 0;
+            if (sscanf(optarg, "%f%c:%f", &vibration_hz, &unit, &vibration_amplitude) == 3 &&
+                unit == 'x') {
+                vibration_harmonic = vibration_hz;
+                vibration_hz = 0;
+            } else if (sscanf(optarg, "%f:%f", &vibration_hz, &vibration_amplitude) != 2) {
+                fprintf(stderr, "Invalid vibration: %s\n", optarg);
+                return 1;
+            }
+            break;
+        }
+        case 'b':
+            benchmark = true;
+            break;
+        case 'l':
+            list(stdout);
+            return 0;
+        case 'm':
+            if (atoi(optarg) < 1) {
+                usage(argv[0]);
+                return 1;
+            }
+            return fast_math_check(stdout, atoi(optarg)) ? 0 : 1;
+        case 'f':
+            if (atof(optarg) <= 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            return balance_filter_check(stdout, atof(optarg)) ? 0 : 1;
+        case 'k':
+            if (atof(optarg) <= 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            return kalman_pitch_check(stdout, atof(optarg)) ? 0 : 1;
+        case 'a':
+            return accel_estimator_check(stdout) ? 0 : 1;
+        case 't':
+            return telemetry_codec_check(stdout) ? 0 : 1;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (imu_hz == 0 || imu_hz > 1000000) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const Scenario *selected = NULL;
+    if (strcmp(scenario_name, "all") != 0) {
+        selected = scenario_find(scenario_name);
+        if (!selected) {
+            fprintf(stderr, "Unknown scenario: %s\n", scenario_name);
+            return 1;
+        }
+    }
+
+    RefloatConfig base_config;
+    confparser_set_defaults_refloatconfig(&base_config);
+    for (int i = 0; i < override_count; ++i) {
+        if (!tune_set(&base_config, overrides[i].name, overrides[i].value)) {
+            fprintf(stderr, "Unknown config value: %s\n", overrides[i].name);
+            return 1;
+        }
+    }
+
+    float dummy;
+    for (int i = 0; i < sweep_count; ++i) {
+        if (!tune_get(&base_config, sweeps[i].name, &dummy)) {
+            fprintf(stderr, "Unknown config value: %s\n", sweeps[i].name);
+            return 1;
+        }
+    }
+
+    FILE *trace = NULL;
+    if (trace_path) {
+        trace = fopen(trace_path, "w");
+        if (!trace) {
+            perror(trace_path);
+            return 1;
+        }
+        fprintf(
+            trace,
+            "scenario,time,target_speed,speed,pitch,lean,balance_pitch,setpoint,atr,"
+            "torque_tilt,current,duty,state,slipping,crashed\n"
+        );
+    }
+
+    BoardModelParams params;
+    board_model_params_default(&params);
+    params.vibration_frequency = vibration_hz;
+    params.vibration_harmonic = vibration_harmonic;
+    params.vibration_amplitude = vibration_amplitude * M_PI / 180.0f;
+
+    print_header(sweeps, sweep_count);
+
+    int result = 0;
+    do {
+        RefloatConfig config = base_config;
+        for (int i = 0; i < sweep_count; ++i) {
+            tune_set(&config, sweeps[i].name, sweeps[i].value);
+        }
+
+        for (unsigned int i = 0; i < scenario_count; ++i) {
+            if (selected && selected != &scenarios[i]) {
+                continue;
+            }
+
+            struct timespec start, end;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+
+            Metrics metrics;
+            if (!run_scenario(
+                    &scenarios[i], &config, &params, imu_hz, jitter_us, trace, &metrics
+                )) {
+                fprintf(stderr, "Package init failed.\n");
+                result = 1;
+                goto out;
+            }
+            print_metrics(sweeps, sweep_count, &scenarios[i], &metrics);
+
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            if (benchmark) {
+                double wall = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+                fprintf(
+                    stderr,
+                    "%s: %llu loop iterations (%.2f Hz) in %.3f s, %.0f iterations/s, "
+                    "%.0fx real time\n",
+                    scenarios[i].name,
+                    (unsigned long long) sim_stats.loop_iterations,
+                    sim_stats.loop_iterations / scenarios[i].duration,
+                    wall,
+                    sim_stats.loop_iterations / wall,
+                    scenarios[i].duration / wall
+                );
+            }
+        }
+    } while (sweep_next(sweeps, sweep_count));
+
+out:
+    if (trace) {
+        fclose(trace);
+    }
+    return result;
+}
@@ -0,0 +1,168 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "telemetry_codec_check.h"
+#include "noise.h"
+
+#include "telemetry.h"
+#include "telemetry_codec.h"
+
+#include <math.h>
+#include <stdint.h>
+
+#define FRAME_HZ 50.0f
+#define FRAMES 3000
+#define LOST_FRAME 1234
+#define MASK_CHANGE_FRAME 2000
+
+typedef struct {
+    uint8_t keyframe_interval;
+    float compact_size;  // average [bytes]
+    float max_error;  // in quantization steps
+    int dropped;  // frames the decoder refused after the lost one
+    int expected_dropped;
+    bool mismatch;  // a frame decoded to the wrong fields or failed to decode
+} Result;
+
+// A ride: accelerate, cruise with some carving, brake, with sensor noise
+static void ride(Snapshot *s, int i, uint32_t *rng) {
+    float t = i / FRAME_HZ;
+    float speed = t < 20 ? t * 500 : t < 45 ? 10000 : fmaxf(10000 - (t - 45) * 800, 0);
+
+    *s = (Snapshot) {0};
+    s->state.state = STATE_RUNNING;
+    s->footpad_state = FS_BOTH;
+    s->beep_reason = 0;
+
+    s->erpm = speed + 20 * noise(rng);
+    s->duty_cycle = speed / 20000 + 0.005f * noise(rng);
+    s->setpoint = 0.5f * sinf(0.3f * t);
+    s->pitch = s->setpoint + 0.3f * noise(rng);
+    s->balance_pitch = s->pitch + 0.05f * noise(rng);
+    s->imu_pitch = s->pitch;
+    s->roll = 8.0f * sinf(0.5f * t) + 0.2f * noise(rng);
+    s->adc1 = 2.9f + 0.01f * noise(rng);
+    s->adc2 = 3.0f + 0.01f * noise(rng);
+    s->atr_offset = 0.2f * sinf(0.3f * t);
+    s->torque_tilt_offset = 0.1f * sinf(0.2f * t);
+    s->turntilt = 0.5f * fmaxf(sinf(0.5f * t), 0);
+    s->pid_value = 20 * sinf(0.3f * t) + 3 * noise(rng);
+    s->atr_filtered_current = 20 * sinf(0.3f * t);
+    s->atr_accel_diff = 0.5f * noise(rng);
+    s->atr_speed_boost = fminf(fmaxf((speed - 3000) / 6000, 0), 1) * 0.3f;
+}
+
+static Result check(uint8_t keyframe_interval) {
+    Result r = {.keyframe_interval = keyframe_interval};
+
+    TelemetryEncoder e;
+    TelemetryDecoder dec;
+    telemetry_encoder_reset(&e, keyframe_interval);
+    telemetry_decoder_reset(&dec);
+
+    uint32_t rng = 1;
+    int32_t total = 0;
+    bool lost = false;
+    for (int i = 0; i < FRAMES; ++i) {
+        Snapshot s;
+        ride(&s, i, &rng);
+
+        uint64_t mask = TELEMETRY_MASK_ALL;
+        if (i >= MASK_CHANGE_FRAME) {
+            mask &= ~((1ULL << TF_CHARGING_CURRENT) | (1ULL << TF_CHARGING_VOLTAGE));
+        }
+
+        bool keyframe = e.until_keyframe == 0 || mask != e.mask;
+        uint8_t buffer[16 + 5 * TELEMETRY_FIELD_COUNT];
+        int32_t len = 0;
+        telemetry_encode(&e, &s, mask, buffer, &len);
+        total += len;
+
+        if (i == LOST_FRAME) {
+            lost = true;
+            continue;
+        }
+        if (lost) {
+            if (keyframe) {
+                lost = false;
+            } else {
+                ++r.expected_dropped;
+            }
+        }
+
+        uint64_t decoded_mask = 0;
+        float values[TELEMETRY_FIELD_COUNT];
+        if (!telemetry_decode(&dec, buffer, len, &decoded_mask, values)) {
+            ++r.dropped;
+            r.mismatch |= !lost;
+            continue;
+        }
+        r.mismatch |= lost || decoded_mask != mask;
+
+        for (int j = 0; j < TELEMETRY_FIELD_COUNT; ++j) {
+            if (!(mask & (1ULL << j))) {
+                continue;
+            }
+            float scale = telemetry_field(j)->scale;
+            float error = fabsf(values[j] - telemetry_value(&s, j)) * scale;
+            r.max_error = fmaxf(r.max_error, error);
+        }
+    }
+
+    r.compact_size = (float) total / FRAMES;
+    return r;
+}
+
+bool telemetry_codec_check(FILE *f) {
+    int32_t plain_size = 8 + telemetry_packed_size(TELEMETRY_MASK_ALL);
+    int32_t float_size = 4 * TELEMETRY_FIELD_COUNT;
+
+    fprintf(
+        f,
+        "%d fields, %d frames at %.0f Hz, frame %d lost, mask changes at frame %d\n",
+        TELEMETRY_FIELD_COUNT,
+        FRAMES,
+        FRAME_HZ,
+        LOST_FRAME,
+        MASK_CHANGE_FRAME
+    );
+    fprintf(f, "float32 frame %d bytes, plain frame %d bytes\n", float_size, plain_size);
+    fprintf(f, "keyframe_interval,compact_bytes,vs_plain,max_error_steps,dropped,result\n");
+
+    bool ok = true;
+    static const uint8_t intervals[] = {1, 10, 50, 250};
+    for (unsigned int i = 0; i < sizeof(intervals) / sizeof(intervals[0]); ++i) {
+        Result r = check(intervals[i]);
+        // Half a step, plus the float rounding of the decoded values
+        bool pass = !r.mismatch && r.max_error <= 0.501f && r.dropped == r.expected_dropped &&
+            r.compact_size < plain_size;
+        ok = ok && pass;
+
+        fprintf(
+            f,
+            "%u,%.1f,%.2f,%.3f,%d,%s\n",
+            r.keyframe_interval,
+            r.compact_size,
+            r.compact_size / plain_size,
+            r.max_error,
+            r.dropped,
+            pass ? "ok" : "FAIL"
+        );
+    }
+
+    return ok;
+}
@@ -0,0 +1,33 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * Encodes a synthetic ride as compact telemetry frames at several keyframe
+ * intervals, decodes them with the reference decoder and prints the average
+ * frame size next to the plain and the float32 frames. Also drops a frame
+ * and changes the field mask mid-stream.
+ *
+ * @return true if every decoded value is within half a quantization step of
+ * the encoded one, the decoder drops exactly the delta frames after the lost
+ * one and the compact frames are smaller than the plain ones.
+ */
+bool telemetry_codec_check(FILE *f);
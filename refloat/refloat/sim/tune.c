@@ -0,0 +1,220 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "tune.h"
+
+#include <stddef.h>
+#include <string.h>
+
+typedef enum {
+    TUNE_FLOAT,
+    TUNE_U16,
+    TUNE_INT,
+    TUNE_BOOL,
+} TuneType;
+
+typedef struct {
+    const char *name;
+    size_t offset;
+    TuneType type;
+} TuneParam;
+
+#define PARAM(field, type) {#field, offsetof(RefloatConfig, field), type}
+
+static const TuneParam params[] = {
+    PARAM(kp, TUNE_FLOAT),
+    PARAM(ki, TUNE_FLOAT),
+    PARAM(kp2, TUNE_FLOAT),
+    PARAM(mahony_kp, TUNE_FLOAT),
+    PARAM(mahony_kp_roll, TUNE_FLOAT),
+    PARAM(mahony_kp_yaw, TUNE_FLOAT),
+    PARAM(bf_accel_confidence_decay, TUNE_FLOAT),
+    PARAM(bf_pitch_estimator, TUNE_INT),
+    PARAM(bf_kalman_q_angle, TUNE_FLOAT),
+    PARAM(bf_kalman_q_bias, TUNE_FLOAT),
+    PARAM(bf_kalman_r_measure, TUNE_FLOAT),
+    PARAM(gyro_notch_frequency, TUNE_FLOAT),
+    PARAM(gyro_notch2_frequency, TUNE_FLOAT),
+    PARAM(gyro_notch_q, TUNE_FLOAT),
+    PARAM(gyro_notch_auto, TUNE_BOOL),
+    PARAM(kp_brake, TUNE_FLOAT),
+    PARAM(kp2_brake, TUNE_FLOAT),
+    PARAM(kp_brake_erpm, TUNE_U16),
+    PARAM(hertz, TUNE_U16),
+    PARAM(hertz_imu_sync, TUNE_BOOL),
+    PARAM(latency_compensation, TUNE_FLOAT),
+    PARAM(blackbox_pre_ms, TUNE_U16),
+    PARAM(blackbox_post_ms, TUNE_U16),
+    PARAM(blackbox_on_wheelslip, TUNE_BOOL),
+    PARAM(blackbox_on_current_limit, TUNE_BOOL),
+    PARAM(fault_pitch, TUNE_FLOAT),
+    PARAM(fault_roll, TUNE_FLOAT),
+    PARAM(fault_adc1, TUNE_FLOAT),
+    PARAM(fault_adc2, TUNE_FLOAT),
+    PARAM(fault_adc_samples, TUNE_U16),
+    PARAM(fault_adc_median, TUNE_BOOL),
+    PARAM(fault_adc_release, TUNE_FLOAT),
+    PARAM(fault_adc_lift_rate, TUNE_FLOAT),
+    PARAM(fault_delay_pitch, TUNE_U16),
+    PARAM(fault_delay_roll, TUNE_U16),
+    PARAM(fault_delay_switch_half, TUNE_U16),
+    PARAM(fault_delay_switch_full, TUNE_U16),
+    PARAM(fault_adc_half_erpm, TUNE_U16),
+    PARAM(fault_is_dual_switch, TUNE_BOOL),
+    PARAM(fault_moving_fault_disabled, TUNE_BOOL),
+    PARAM(fault_darkride_enabled, TUNE_BOOL),
+    PARAM(fault_reversestop_enabled, TUNE_BOOL),
+    PARAM(tiltback_duty_angle, TUNE_FLOAT),
+    PARAM(tiltback_duty_speed, TUNE_FLOAT),
+    PARAM(tiltback_duty, TUNE_FLOAT),
+    PARAM(tiltback_hv_angle, TUNE_FLOAT),
+    PARAM(tiltback_hv_speed, TUNE_FLOAT),
+    PARAM(tiltback_hv, TUNE_FLOAT),
+    PARAM(tiltback_lv_angle, TUNE_FLOAT),
+    PARAM(tiltback_lv_speed, TUNE_FLOAT),
+    PARAM(tiltback_lv, TUNE_FLOAT),
+    PARAM(tiltback_return_speed, TUNE_FLOAT),
+    PARAM(tiltback_constant, TUNE_FLOAT),
+    PARAM(tiltback_constant_erpm, TUNE_U16),
+    PARAM(tiltback_variable, TUNE_FLOAT),
+    PARAM(tiltback_variable_max, TUNE_FLOAT),
+    PARAM(tiltback_variable_erpm, TUNE_U16),
+    PARAM(inputtilt_speed, TUNE_FLOAT),
+    PARAM(inputtilt_angle_limit, TUNE_FLOAT),
+    PARAM(inputtilt_smoothing_factor, TUNE_U16),
+    PARAM(inputtilt_invert_throttle, TUNE_BOOL),
+    PARAM(inputtilt_deadband, TUNE_FLOAT),
+    PARAM(remote_throttle_current_max, TUNE_FLOAT),
+    PARAM(remote_throttle_grace_period, TUNE_FLOAT),
+    PARAM(noseangling_speed, TUNE_FLOAT),
+    PARAM(startup_pitch_tolerance, TUNE_FLOAT),
+    PARAM(startup_roll_tolerance, TUNE_FLOAT),
+    PARAM(startup_speed, TUNE_FLOAT),
+    PARAM(startup_click_current, TUNE_FLOAT),
+    PARAM(startup_simplestart_enabled, TUNE_BOOL),
+    PARAM(startup_pushstart_enabled, TUNE_BOOL),
+    PARAM(startup_dirtylandings_enabled, TUNE_BOOL),
+    PARAM(brake_current, TUNE_FLOAT),
+    PARAM(ki_limit, TUNE_FLOAT),
+    PARAM(booster_angle, TUNE_FLOAT),
+    PARAM(booster_ramp, TUNE_FLOAT),
+    PARAM(booster_current, TUNE_FLOAT),
+    PARAM(brkbooster_angle, TUNE_FLOAT),
+    PARAM(brkbooster_ramp, TUNE_FLOAT),
+    PARAM(brkbooster_current, TUNE_FLOAT),
+    PARAM(torquetilt_start_current, TUNE_FLOAT),
+    PARAM(torquetilt_angle_limit, TUNE_FLOAT),
+    PARAM(torquetilt_on_speed, TUNE_FLOAT),
+    PARAM(torquetilt_off_speed, TUNE_FLOAT),
+    PARAM(torquetilt_strength, TUNE_FLOAT),
+    PARAM(torquetilt_strength_regen, TUNE_FLOAT),
+    PARAM(atr_strength_up, TUNE_FLOAT),
+    PARAM(atr_strength_down, TUNE_FLOAT),
+    PARAM(atr_threshold_up, TUNE_FLOAT),
+    PARAM(atr_threshold_down, TUNE_FLOAT),
+    PARAM(atr_speed_boost, TUNE_FLOAT),
+    PARAM(atr_angle_limit, TUNE_FLOAT),
+    PARAM(atr_on_speed, TUNE_FLOAT),
+    PARAM(atr_off_speed, TUNE_FLOAT),
+    PARAM(atr_response_boost, TUNE_FLOAT),
+    PARAM(atr_transition_boost, TUNE_FLOAT),
+    PARAM(atr_filter, TUNE_FLOAT),
+    PARAM(atr_amps_accel_ratio, TUNE_FLOAT),
+    PARAM(atr_amps_decel_ratio, TUNE_FLOAT),
+    PARAM(accel_estimator, TUNE_INT),
+    PARAM(braketilt_strength, TUNE_FLOAT),
+    PARAM(braketilt_lingering, TUNE_FLOAT),
+    PARAM(turntilt_strength, TUNE_FLOAT),
+    PARAM(turntilt_angle_limit, TUNE_FLOAT),
+    PARAM(turntilt_start_angle, TUNE_FLOAT),
+    PARAM(turntilt_start_erpm, TUNE_U16),
+    PARAM(turntilt_speed, TUNE_FLOAT),
+    PARAM(turntilt_erpm_boost, TUNE_U16),
+    PARAM(turntilt_erpm_boost_end, TUNE_U16),
+    PARAM(turntilt_yaw_aggregate, TUNE_INT),
+    PARAM(dark_pitch_offset, TUNE_FLOAT),
+    PARAM(is_beeper_enabled, TUNE_BOOL),
+    PARAM(is_dutybeep_enabled, TUNE_BOOL),
+    PARAM(is_footbeep_enabled, TUNE_BOOL),
+    PARAM(is_surgebeep_enabled, TUNE_BOOL),
+    PARAM(surge_duty_start, TUNE_FLOAT),
+    PARAM(surge_angle, TUNE_FLOAT),
+};
+
+static const TuneParam *find(const char *name) {
+    for (size_t i = 0; i < sizeof(params) / sizeof(params[0]); ++i) {
+        if (strcmp(params[i].name, name) == 0) {
+            return &params[i];
+        }
+    }
+    return NULL;
+}
+
+bool tune_set(RefloatConfig *config, const char *name, float value) {
+    const TuneParam *p = find(name);
+    if (!p) {
+        return false;
+    }
+
+    void *field = (char *) config + p->offset;
+    switch (p->type) {
+    case TUNE_FLOAT:
+        *(float *) field = value;
+        break;
+    case TUNE_U16:
+        *(uint16_t *) field = value;
+        break;
+    case TUNE_INT:
+        *(int *) field = value;
+        break;
+    case TUNE_BOOL:
+        *(bool *) field = value != 0;
+        break;
+    }
+    return true;
+}
+
+bool tune_get(const RefloatConfig *config, const char *name, float *value) {
+    const TuneParam *p = find(name);
+    if (!p) {
+        return false;
+    }
+
+    const void *field = (const char *) config + p->offset;
+    switch (p->type) {
+    case TUNE_FLOAT:
+        *value = *(const float *) field;
+        break;
+    case TUNE_U16:
+        *value = *(const uint16_t *) field;
+        break;
+    case TUNE_INT:
+        *value = *(const int *) field;
+        break;
+    case TUNE_BOOL:
+        *value = *(const bool *) field;
+        break;
+    }
+    return true;
+}
+
+void tune_print_names(FILE *f) {
+    for (size_t i = 0; i < sizeof(params) / sizeof(params[0]); ++i) {
+        fprintf(f, "%s%s", i % 4 == 0 ? "\n  " : " ", params[i].name);
+    }
+    fprintf(f, "\n");
+}
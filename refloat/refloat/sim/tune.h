@@ -0,0 +1,36 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "conf/datatypes.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * Sets a RefloatConfig field by its settings name, e.g. "kp" or
+ * "atr_strength_up". Returns false if the name is not known.
+ */
+bool tune_set(RefloatConfig *config, const char *name, float value);
+
+/**
+ * Reads a RefloatConfig field by its name into @p value.
+ */
+bool tune_get(const RefloatConfig *config, const char *name, float *value);
+
+void tune_print_names(FILE *f);
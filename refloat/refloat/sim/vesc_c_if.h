@@ -0,0 +1,34 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+// Host build shim for vesc_c_if.h. It is found before the real header on the
+// include path and redirects VESC_IF from the fixed firmware address to the
+// stub function table in vesc_if_stub.c.
+
+#pragma once
+
+#include "../../../c_libs/vesc_c_if.h"
+
+#include <stdint.h>
+
+#undef VESC_IF
+#undef PROG_ADDR
+
+extern vesc_c_if sim_vesc_if;
+
+#define VESC_IF (&sim_vesc_if)
+#define PROG_ADDR ((uint32_t) (uintptr_t) &prog_ptr)
@@ -0,0 +1,728 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "vesc_if_stub.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+
+#define MAX_THREADS 4
+// The firmware stack sizes are too small for the host C library
+#define THREAD_STACK_SIZE (256 * 1024)
+#define MAX_EXTENSIONS 8
+
+// Defined by INIT_FUN in main.c
+bool init(lib_info *info);
+
+// The package threads run as coroutines on the simulated clock: a thread runs
+// until it sleeps, then the thread with the earliest wake-up time continues
+// (the lowest index on a tie, so the main thread goes first). The first
+// thread runs on the host stack.
+typedef struct {
+    void (*fun)(void *arg);
+    void *arg;
+    bool terminate;
+
+    ucontext_t context;
+    void *stack;
+    uint64_t wake_us;
+    bool finished;
+} SimThread;
+
+typedef struct {
+    uint64_t time_us;
+    uint64_t end_us;
+    uint32_t imu_period_us;
+    uint64_t next_imu_us;
+
+    uint32_t wakeup_jitter_us;
+    uint32_t rand_state;
+
+    sim_tick_cb tick_cb;
+    void *tick_arg;
+
+    void (*imu_cb)(float *acc, float *gyro, float *mag, float dt);
+    void (*app_data_handler)(unsigned char *data, unsigned int len);
+    sim_app_data_cb app_data_cb;
+    void *app_data_arg;
+
+    SimThread threads[MAX_THREADS];
+    int thread_count;
+    SimThread *current_thread;
+    int advance_depth;  // sim_advance() calls in progress
+
+    eeprom_var eeprom[SIM_EEPROM_SIZE];
+    bool eeprom_valid[SIM_EEPROM_SIZE];
+
+    float cfg_float[CFG_PARAM_IMU_rot_yaw + 1];
+
+    lib_info info;
+} Sim;
+
+static Sim sim;
+
+SimHardware sim_hw;
+SimStats sim_stats;
+
+static void hw_defaults(SimHardware *hw) {
+    memset(hw, 0, sizeof(SimHardware));
+    hw->accel[2] = 1.0f;
+    hw->imu_startup_done = true;
+    hw->input_voltage = 60.0f;
+    hw->temp_fet = 30.0f;
+    hw->temp_motor = 30.0f;
+    hw->fault = FAULT_CODE_NONE;
+    hw->ppm_age = 100.0f;
+    hw->remote.age_s = 100.0f;
+}
+
+void sim_init(unsigned int imu_hz, float duration) {
+    memset(&sim, 0, sizeof(sim));
+    memset(&sim_stats, 0, sizeof(sim_stats));
+    hw_defaults(&sim_hw);
+
+    sim.imu_period_us = 1000000 / imu_hz;
+    sim.next_imu_us = sim.imu_period_us;
+    sim.end_us = (uint64_t) (duration * 1e6);
+
+    sim.cfg_float[CFG_PARAM_l_current_max] = 60.0f;
+    sim.cfg_float[CFG_PARAM_l_current_min] = -60.0f;
+    sim.cfg_float[CFG_PARAM_l_max_duty] = 0.95f;
+    sim.cfg_float[CFG_PARAM_l_min_erpm] = -100000.0f;
+    sim.cfg_float[CFG_PARAM_l_max_erpm] = 100000.0f;
+    sim.cfg_float[CFG_PARAM_l_temp_fet_start] = 85.0f;
+    sim.cfg_float[CFG_PARAM_l_temp_motor_start] = 100.0f;
+    sim.cfg_float[CFG_PARAM_IMU_mahony_kp] = 0.4f;
+    sim.cfg_float[CFG_PARAM_IMU_accel_confidence_decay] = 0.1f;
+}
+
+void sim_set_wakeup_jitter(uint32_t max_us) {
+    sim.wakeup_jitter_us = max_us;
+    sim.rand_state = 1;
+}
+
+void sim_set_tick_callback(sim_tick_cb cb, void *arg) {
+    sim.tick_cb = cb;
+    sim.tick_arg = arg;
+}
+
+void sim_set_app_data_callback(sim_app_data_cb cb, void *arg) {
+    sim.app_data_cb = cb;
+    sim.app_data_arg = arg;
+}
+
+uint64_t sim_time_us() {
+    return sim.time_us;
+}
+
+void sim_advance(uint32_t us) {
+    uint64_t target = sim.time_us + us;
+    ++sim.advance_depth;
+
+    while (sim.next_imu_us <= target) {
+        sim.time_us = sim.next_imu_us;
+        sim.next_imu_us += sim.imu_period_us;
+
+        float dt = sim.imu_period_us / 1e6f;
+        if (sim.tick_cb) {
+            sim.tick_cb(dt, sim.tick_arg);
+        }
+
+        if (sim.imu_cb) {
+            float acc[3] = {sim_hw.accel[0], sim_hw.accel[1], sim_hw.accel[2]};
+            float gyro[3] = {sim_hw.gyro[0], sim_hw.gyro[1], sim_hw.gyro[2]};
+            float mag[3] = {0};
+            sim.imu_cb(acc, gyro, mag, dt);
+        }
+        ++sim_stats.imu_samples;
+    }
+
+    sim.time_us = target;
+    --sim.advance_depth;
+}
+
+static SimThread *next_thread() {
+    SimThread *next = NULL;
+    for (int i = 0; i < sim.thread_count; ++i) {
+        SimThread *t = &sim.threads[i];
+        if (!t->finished && (!next || t->wake_us < next->wake_us)) {
+            next = t;
+        }
+    }
+    return next;
+}
+
+// Advances the clock to the next thread to wake up and switches to it, the
+// calling thread resumes from here when its turn comes.
+static void switch_thread(SimThread *self) {
+    SimThread *next = next_thread();
+    if (next->wake_us > sim.time_us) {
+        sim_advance(next->wake_us - sim.time_us);
+    }
+    if (next == self) {
+        return;
+    }
+
+    sim.current_thread = next;
+    if (self) {
+        swapcontext(&self->context, &next->context);
+    } else {
+        setcontext(&next->context);
+    }
+}
+
+static void thread_entry(int index) {
+    SimThread *self = &sim.threads[index];
+    self->fun(self->arg);
+    self->finished = true;
+    switch_thread(NULL);
+}
+
+static bool thread_context_init(int index) {
+    void *stack = malloc(THREAD_STACK_SIZE);
+    if (!stack) {
+        return false;
+    }
+
+    ucontext_t *context = &sim.threads[index].context;
+    getcontext(context);
+    sim.threads[index].stack = stack;
+    context->uc_stack.ss_sp = stack;
+    context->uc_stack.ss_size = THREAD_STACK_SIZE;
+    context->uc_link = NULL;
+    makecontext(context, (void (*)()) thread_entry, 1, index);
+    return true;
+}
+
+static void thread_sleep(uint32_t us) {
+    SimThread *self = sim.current_thread;
+    if (!self || sim.advance_depth > 0) {
+        // Outside of the package threads (e.g. in a command handler called
+        // from the tick callback) the clock just moves on
+        sim_advance(us);
+        return;
+    }
+
+    self->wake_us = sim.time_us + us;
+    switch_thread(self);
+}
+
+void sim_eeprom_store_config(const void *cfg, uint32_t size, uint32_t signature) {
+    uint32_t ints = size / 4 + 1;
+    memset(sim.eeprom, 0, sizeof(sim.eeprom));
+    memcpy(&sim.eeprom[1], cfg, size);
+    for (uint32_t i = 0; i <= ints; i++) {
+        sim.eeprom_valid[i] = true;
+    }
+    sim.eeprom[0].as_u32 = signature;
+}
+
+void sim_send_command(unsigned char *buffer, unsigned int len) {
+    if (sim.app_data_handler) {
+        sim.app_data_handler(buffer, len);
+    }
+}
+
+bool sim_run() {
+    sim.info.arg = NULL;
+    if (!init(&sim.info)) {
+        return false;
+    }
+
+    // The first spawned thread is the main control loop, the run ends when it
+    // returns once should_terminate() turns true. The other threads are left
+    // where they last slept.
+    if (sim.thread_count > 0) {
+        SimThread *main_thread = &sim.threads[0];
+        sim.current_thread = main_thread;
+        main_thread->fun(main_thread->arg);
+        main_thread->finished = true;
+        sim.current_thread = NULL;
+    }
+
+    if (sim.info.stop_fun) {
+        sim.info.stop_fun(sim.info.arg);
+    }
+
+    for (int i = 0; i < sim.thread_count; ++i) {
+        free(sim.threads[i].stack);
+        sim.threads[i].stack = NULL;
+    }
+    return true;
+}
+
+// Os
+
+static void stub_sleep_us(uint32_t us) {
+    if (sim.current_thread == &sim.threads[0]) {
+        ++sim_stats.loop_iterations;
+        if (sim.wakeup_jitter_us > 0) {
+            // deterministic LCG, so that runs are reproducible
+            sim.rand_state = sim.rand_state * 1103515245 + 12345;
+            us += (sim.rand_state >> 8) % (sim.wakeup_jitter_us + 1);
+        }
+    }
+    thread_sleep(us);
+}
+
+static void stub_sleep_ms(uint32_t ms) {
+    thread_sleep(ms * 1000);
+}
+
+static float stub_system_time() {
+    return sim.time_us / 1e6;
+}
+
+static int stub_printf(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int res = vprintf(fmt, args);
+    va_end(args);
+    printf("\n");
+    return res;
+}
+
+static lib_thread stub_spawn(
+    void (*fun)(void *arg), [[maybe_unused]] size_t stack_size, [[maybe_unused]] char *name, void *arg
+) {
+    if (sim.thread_count == MAX_THREADS) {
+        return NULL;
+    }
+
+    int index = sim.thread_count;
+    SimThread *thread = &sim.threads[index];
+    thread->fun = fun;
+    thread->arg = arg;
+    thread->terminate = false;
+    thread->wake_us = sim.time_us;
+    thread->finished = false;
+    thread->stack = NULL;
+
+    if (index > 0 && !thread_context_init(index)) {
+        return NULL;
+    }
+
+    ++sim.thread_count;
+    return thread;
+}
+
+static void stub_request_terminate(lib_thread thd) {
+    ((SimThread *) thd)->terminate = true;
+}
+
+static bool stub_should_terminate() {
+    if (sim.time_us >= sim.end_us) {
+        return true;
+    }
+    return sim.current_thread && sim.current_thread->terminate;
+}
+
+static void **stub_get_arg([[maybe_unused]] uint32_t prog_addr) {
+    return &sim.info.arg;
+}
+
+static void stub_set_pad_mode(
+    [[maybe_unused]] void *gpio, [[maybe_unused]] uint32_t pin, [[maybe_unused]] uint32_t mode
+) {
+}
+
+// Abstract IO
+
+static bool stub_io_set_mode([[maybe_unused]] VESC_PIN pin, [[maybe_unused]] VESC_PIN_MODE mode) {
+    return true;
+}
+
+static bool stub_io_write([[maybe_unused]] VESC_PIN pin, [[maybe_unused]] int state) {
+    return true;
+}
+
+static float stub_io_read_analog(VESC_PIN pin) {
+    switch (pin) {
+    case VESC_PIN_ADC1:
+        return sim_hw.adc1;
+    case VESC_PIN_ADC2:
+        return sim_hw.adc2;
+    default:
+        return -1.0f;
+    }
+}
+
+// Motor Control
+
+static mc_fault_code stub_mc_get_fault() {
+    return sim_hw.fault;
+}
+
+static void stub_mc_set_current(float current) {
+    sim_hw.motor_mode = SIM_MOTOR_CURRENT;
+    sim_hw.current_cmd = current;
+}
+
+static void stub_mc_set_brake_current(float current) {
+    sim_hw.motor_mode = SIM_MOTOR_BRAKE;
+    sim_hw.brake_current_cmd = current;
+}
+
+static void stub_mc_set_current_off_delay(float delay_sec) {
+    sim_hw.current_off_delay = delay_sec;
+}
+
+static float stub_mc_get_duty_cycle_now() {
+    return sim_hw.duty;
+}
+
+static float stub_mc_get_rpm() {
+    return sim_hw.erpm;
+}
+
+static float stub_mc_get_current() {
+    return sim_hw.current;
+}
+
+static float stub_mc_get_current_in() {
+    return sim_hw.current_in;
+}
+
+static float stub_mc_get_input_voltage_filtered() {
+    return sim_hw.input_voltage;
+}
+
+static float stub_mc_temp_fet_filtered() {
+    return sim_hw.temp_fet;
+}
+
+static float stub_mc_temp_motor_filtered() {
+    return sim_hw.temp_motor;
+}
+
+static float stub_mc_zero_reset([[maybe_unused]] bool reset) {
+    return 0.0f;
+}
+
+static float stub_mc_zero() {
+    return 0.0f;
+}
+
+static float stub_mc_get_battery_level(float *wh_left) {
+    if (wh_left) {
+        *wh_left = 0.0f;
+    }
+    return 0.5f;
+}
+
+static uint64_t stub_mc_get_odometer() {
+    return 0;
+}
+
+static void stub_timeout_reset() {
+}
+
+// Comm
+
+static void stub_send_app_data(unsigned char *data, unsigned int len) {
+    ++sim_stats.app_data_packets;
+    if (sim.app_data_cb) {
+        sim.app_data_cb(data, len, sim.app_data_arg);
+    }
+}
+
+static bool stub_set_app_data_handler(void (*func)(unsigned char *data, unsigned int len)) {
+    sim.app_data_handler = func;
+    return true;
+}
+
+// IMU
+
+static bool stub_imu_startup_done() {
+    return sim_hw.imu_startup_done;
+}
+
+static float stub_imu_get_roll() {
+    return sim_hw.roll;
+}
+
+static float stub_imu_get_pitch() {
+    return sim_hw.pitch;
+}
+
+static float stub_imu_get_yaw() {
+    return sim_hw.yaw;
+}
+
+static void stub_imu_get_rpy(float *rpy) {
+    rpy[0] = sim_hw.roll;
+    rpy[1] = sim_hw.pitch;
+    rpy[2] = sim_hw.yaw;
+}
+
+static void stub_imu_get_accel(float *accel) {
+    memcpy(accel, sim_hw.accel, sizeof(sim_hw.accel));
+}
+
+static void stub_imu_get_gyro(float *gyro) {
+    // the firmware getter returns deg/s
+    for (int i = 0; i < 3; i++) {
+        gyro[i] = sim_hw.gyro[i] * (180.0f / M_PI);
+    }
+}
+
+static void stub_imu_get_quaternions(float *q) {
+    // Inverse of the balance filter getters, which negate roll and yaw
+    float cr = cosf(-sim_hw.roll / 2), sr = sinf(-sim_hw.roll / 2);
+    float cp = cosf(sim_hw.pitch / 2), sp = sinf(sim_hw.pitch / 2);
+    float cy = cosf(-sim_hw.yaw / 2), sy = sinf(-sim_hw.yaw / 2);
+
+    q[0] = cr * cp * cy + sr * sp * sy;
+    q[1] = sr * cp * cy - cr * sp * sy;
+    q[2] = cr * sp * cy + sr * cp * sy;
+    q[3] = cr * cp * sy - sr * sp * cy;
+}
+
+static void stub_imu_set_read_callback(void (*func)(float *acc, float *gyro, float *mag, float dt)) {
+    sim.imu_cb = func;
+}
+
+// EEPROM
+
+static bool stub_read_eeprom_var(eeprom_var *v, int address) {
+    if (address < 0 || address >= SIM_EEPROM_SIZE || !sim.eeprom_valid[address]) {
+        return false;
+    }
+    *v = sim.eeprom[address];
+    return true;
+}
+
+static bool stub_store_eeprom_var(eeprom_var *v, int address) {
+    if (address < 0 || address >= SIM_EEPROM_SIZE) {
+        return false;
+    }
+    sim.eeprom[address] = *v;
+    sim.eeprom_valid[address] = true;
+    return true;
+}
+
+static bool stub_store_backup_data() {
+    return true;
+}
+
+// Custom config
+
+static void stub_conf_custom_add_config(
+    [[maybe_unused]] int (*get_cfg)(uint8_t *data, bool is_default),
+    [[maybe_unused]] bool (*set_cfg)(uint8_t *data),
+    [[maybe_unused]] int (*get_cfg_xml)(uint8_t **data)
+) {
+}
+
+static void stub_conf_custom_clear_configs() {
+}
+
+static float stub_get_cfg_float(CFG_PARAM p) {
+    if (p < 0 || p > CFG_PARAM_IMU_rot_yaw) {
+        return 0.0f;
+    }
+    return sim.cfg_float[p];
+}
+
+static bool stub_set_cfg_float(CFG_PARAM p, float value) {
+    // Refloat uses an offset of +100 to set the values without storing them
+    if (p >= 100) {
+        p -= 100;
+    }
+    if (p < 0 || p > CFG_PARAM_IMU_rot_yaw) {
+        return false;
+    }
+    sim.cfg_float[p] = value;
+    return true;
+}
+
+// High resolution timer
+
+static uint32_t stub_timer_time_now() {
+    return (uint32_t) (sim.time_us * (SIM_TIMER_HZ / 1000000));
+}
+
+static float stub_timer_seconds_elapsed_since(uint32_t time) {
+    return (uint32_t) (stub_timer_time_now() - time) / (float) SIM_TIMER_HZ;
+}
+
+static void stub_timer_sleep(float seconds) {
+    sim_advance(seconds * 1e6f);
+}
+
+static void stub_sys_lock() {
+}
+
+static void stub_sys_unlock() {
+}
+
+// The package threads take turns on the simulated clock, a mutex is never contended.
+// rb.c frees the mutex with VESC_IF->free.
+static lib_mutex stub_mutex_create() {
+    return malloc(1);
+}
+
+static void stub_mutex_lock([[maybe_unused]] lib_mutex m) {
+}
+
+static void stub_mutex_unlock([[maybe_unused]] lib_mutex m) {
+}
+
+// Input devices
+
+static remote_state stub_get_remote_state() {
+    return sim_hw.remote;
+}
+
+static float stub_get_ppm() {
+    return sim_hw.ppm;
+}
+
+static float stub_get_ppm_age() {
+    return sim_hw.ppm_age;
+}
+
+static bool stub_app_is_output_disabled() {
+    return false;
+}
+
+static float stub_foc_get_id() {
+    return 0.0f;
+}
+
+// LBM, only what's needed to register extensions
+
+static bool stub_lbm_add_extension([[maybe_unused]] char *name, [[maybe_unused]] extension_fptr fun) {
+    return true;
+}
+
+static lbm_value stub_lbm_enc_float(float f) {
+    lbm_value v;
+    memcpy(&v, &f, sizeof(v));
+    return v;
+}
+
+static int32_t stub_lbm_dec_as_i32(lbm_value val) {
+    return (int32_t) val;
+}
+
+static bool stub_lbm_is_number([[maybe_unused]] lbm_value x) {
+    return true;
+}
+
+vesc_c_if sim_vesc_if = {
+    .lbm_add_extension = stub_lbm_add_extension,
+    .lbm_enc_float = stub_lbm_enc_float,
+    .lbm_dec_as_i32 = stub_lbm_dec_as_i32,
+    .lbm_is_number = stub_lbm_is_number,
+    .lbm_enc_sym_nil = 0,
+    .lbm_enc_sym_true = 1,
+    .lbm_enc_sym_eerror = 2,
+
+    .sleep_ms = stub_sleep_ms,
+    .sleep_us = stub_sleep_us,
+    .system_time = stub_system_time,
+    .printf = stub_printf,
+    .malloc = malloc,
+    .free = free,
+    .spawn = stub_spawn,
+    .request_terminate = stub_request_terminate,
+    .should_terminate = stub_should_terminate,
+    .get_arg = stub_get_arg,
+
+    .set_pad_mode = stub_set_pad_mode,
+
+    .io_set_mode = stub_io_set_mode,
+    .io_write = stub_io_write,
+    .io_read_analog = stub_io_read_analog,
+
+    .mc_get_fault = stub_mc_get_fault,
+    .mc_set_current = stub_mc_set_current,
+    .mc_set_brake_current = stub_mc_set_brake_current,
+    .mc_get_duty_cycle_now = stub_mc_get_duty_cycle_now,
+    .mc_get_rpm = stub_mc_get_rpm,
+    .mc_get_amp_hours = stub_mc_zero_reset,
+    .mc_get_amp_hours_charged = stub_mc_zero_reset,
+    .mc_get_watt_hours = stub_mc_zero_reset,
+    .mc_get_watt_hours_charged = stub_mc_zero_reset,
+    .mc_get_tot_current = stub_mc_get_current,
+    .mc_get_tot_current_filtered = stub_mc_get_current,
+    .mc_get_tot_current_directional = stub_mc_get_current,
+    .mc_get_tot_current_directional_filtered = stub_mc_get_current,
+    .mc_get_tot_current_in = stub_mc_get_current_in,
+    .mc_get_tot_current_in_filtered = stub_mc_get_current_in,
+    .mc_get_input_voltage_filtered = stub_mc_get_input_voltage_filtered,
+    .mc_temp_fet_filtered = stub_mc_temp_fet_filtered,
+    .mc_temp_motor_filtered = stub_mc_temp_motor_filtered,
+    .mc_get_battery_level = stub_mc_get_battery_level,
+    .mc_get_speed = stub_mc_zero,
+    .mc_get_distance = stub_mc_zero,
+    .mc_get_distance_abs = stub_mc_zero,
+    .mc_get_odometer = stub_mc_get_odometer,
+    .mc_set_current_off_delay = stub_mc_set_current_off_delay,
+
+    .send_app_data = stub_send_app_data,
+    .set_app_data_handler = stub_set_app_data_handler,
+
+    .imu_startup_done = stub_imu_startup_done,
+    .imu_get_roll = stub_imu_get_roll,
+    .imu_get_pitch = stub_imu_get_pitch,
+    .imu_get_yaw = stub_imu_get_yaw,
+    .imu_get_rpy = stub_imu_get_rpy,
+    .imu_get_accel = stub_imu_get_accel,
+    .imu_get_gyro = stub_imu_get_gyro,
+    .imu_get_accel_derotated = stub_imu_get_accel,
+    .imu_get_gyro_derotated = stub_imu_get_gyro,
+    .imu_get_quaternions = stub_imu_get_quaternions,
+
+    .read_eeprom_var = stub_read_eeprom_var,
+    .store_eeprom_var = stub_store_eeprom_var,
+
+    .timeout_reset = stub_timeout_reset,
+
+    .conf_custom_add_config = stub_conf_custom_add_config,
+    .conf_custom_clear_configs = stub_conf_custom_clear_configs,
+
+    .get_cfg_float = stub_get_cfg_float,
+    .set_cfg_float = stub_set_cfg_float,
+
+    .timer_time_now = stub_timer_time_now,
+    .timer_seconds_elapsed_since = stub_timer_seconds_elapsed_since,
+    .timer_sleep = stub_timer_sleep,
+
+    .sys_lock = stub_sys_lock,
+    .sys_unlock = stub_sys_unlock,
+
+    .mutex_create = stub_mutex_create,
+    .mutex_lock = stub_mutex_lock,
+    .mutex_unlock = stub_mutex_unlock,
+
+    .imu_set_read_callback = stub_imu_set_read_callback,
+
+    .store_backup_data = stub_store_backup_data,
+
+    .get_remote_state = stub_get_remote_state,
+    .get_ppm = stub_get_ppm,
+    .get_ppm_age = stub_get_ppm_age,
+    .app_is_output_disabled = stub_app_is_output_disabled,
+
+    .foc_get_id = stub_foc_get_id,
+};
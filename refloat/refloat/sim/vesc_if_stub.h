@@ -0,0 +1,123 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "vesc_c_if.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SIM_TIMER_HZ 10000000
+#define SIM_EEPROM_SIZE 512
+
+typedef enum {
+    SIM_MOTOR_OFF = 0,
+    SIM_MOTOR_CURRENT,
+    SIM_MOTOR_BRAKE
+} SimMotorMode;
+
+/**
+ * Simulated hardware as seen through the stub VESC_IF. The inputs are set by
+ * the simulation driver (directly or from the tick callback), the outputs are
+ * written by the package through the motor control calls.
+ */
+typedef struct {
+    // Firmware AHRS angles in radians, pitch is positive nose-up
+    float roll, pitch, yaw;
+    // IMU body frame: gyro in rad/s, accel in g
+    float gyro[3];
+    float accel[3];
+    bool imu_startup_done;
+
+    float erpm;
+    float duty;  // signed
+    float current;  // directional filtered motor current
+    float current_in;
+    float input_voltage;
+    float temp_fet, temp_motor;
+    mc_fault_code fault;
+
+    float adc1, adc2;
+    float ppm, ppm_age;
+    remote_state remote;
+
+    // Outputs
+    SimMotorMode motor_mode;
+    float current_cmd;
+    float brake_current_cmd;
+    float current_off_delay;
+} SimHardware;
+
+extern SimHardware sim_hw;
+
+/**
+ * Called on each simulated IMU sample, before the sample is delivered to the
+ * package IMU read callback. Used to advance the simulated world by @p dt.
+ */
+typedef void (*sim_tick_cb)(float dt, void *arg);
+
+void sim_init(unsigned int imu_hz, float duration);
+
+void sim_set_tick_callback(sim_tick_cb cb, void *arg);
+
+/**
+ * Makes every sleep_us() wake up late by a random 0 to @p max_us, like when
+ * higher priority threads run at the time the package thread should wake up.
+ */
+void sim_set_wakeup_jitter(uint32_t max_us);
+
+/**
+ * Called with every app data packet the package sends to the client.
+ */
+typedef void (*sim_app_data_cb)(unsigned char *data, unsigned int len, void *arg);
+
+void sim_set_app_data_callback(sim_app_data_cb cb, void *arg);
+
+uint64_t sim_time_us();
+
+/**
+ * Advances the simulated time by @p us microseconds, running the tick
+ * callback and the IMU read callback at the IMU rate on the way.
+ */
+void sim_advance(uint32_t us);
+
+/**
+ * Runs the package: calls init(), runs the main thread until the configured
+ * duration elapses and calls the stop function. The other spawned threads
+ * (e.g. LEDs) run alongside, each thread runs until it sleeps.
+ */
+bool sim_run();
+
+/**
+ * Pre-fills the simulated EEPROM with @p size bytes of @p cfg and the
+ * signature, the same way write_cfg_to_eeprom() lays it out.
+ */
+void sim_eeprom_store_config(const void *cfg, uint32_t size, uint32_t signature);
+
+/**
+ * Passes an app data command to the handler registered by the package.
+ */
+void sim_send_command(unsigned char *buffer, unsigned int len);
+
+typedef struct {
+    uint64_t loop_iterations;
+    uint64_t imu_samples;
+    uint64_t app_data_packets;
+} SimStats;
+
+extern SimStats sim_stats;
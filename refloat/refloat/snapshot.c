@@ -0,0 +1,46 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "snapshot.h"
+
+#include "vesc_c_if.h"
+
+#include <stdbool.h>
+
+Snapshot *snapshot_write_begin(SnapshotLock *lock) {
+    __atomic_store_n(&lock->seq, lock->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return &lock->snapshot;
+}
+
+void snapshot_write_end(SnapshotLock *lock) {
+    __atomic_store_n(&lock->seq, lock->seq + 1, __ATOMIC_RELEASE);
+}
+
+void snapshot_read(const SnapshotLock *lock, Snapshot *out) {
+    while (true) {
+        uint32_t seq = __atomic_load_n(&lock->seq, __ATOMIC_ACQUIRE);
+        *out = lock->snapshot;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (!(seq & 1) && seq == __atomic_load_n(&lock->seq, __ATOMIC_RELAXED)) {
+            return;
+        }
+
+        // The writer may be preempted mid-write by this (reading) thread, let it finish
+        VESC_IF->sleep_us(10);
+    }
+}
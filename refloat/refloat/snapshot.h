@@ -0,0 +1,82 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "footpad_sensor.h"
+#include "state.h"
+
+#include <stdint.h>
+
+/**
+ * The balance loop state read outside the loop (LEDs, telemetry, LCM),
+ * published once per loop iteration.
+ */
+typedef struct {
+    // Loop iteration the snapshot was taken in, wraps around
+    uint32_t iteration;
+
+    State state;
+    FootpadSensorState footpad_state;
+    uint8_t beep_reason;
+
+    float pitch, balance_pitch, roll;
+    // Pitch from the IMU orientation, without the balance loop offsets
+    float imu_pitch;
+    float adc1, adc2;
+    float throttle;
+
+    float erpm;
+    float duty_cycle;
+
+    float setpoint;
+    float atr_offset, braketilt_offset;
+    float torque_tilt_offset;
+    float turntilt, inputtilt;
+
+    float pid_value;
+    float rate_p;
+    float current;
+    float atr_filtered_current;
+    float atr_accel_diff;
+    float atr_speed_boost;
+    float booster_current;
+
+    float charging_current, charging_voltage;
+} Snapshot;
+
+/**
+ * Seqlock around a Snapshot: a single writer (the balance loop) never waits,
+ * readers copy the snapshot and retry if a write overlapped the copy.
+ */
+typedef struct {
+    Snapshot snapshot;
+    uint32_t seq;  // odd while a write is in progress
+} SnapshotLock;
+
+/**
+ * Starts a write and returns the snapshot to fill in, finish the write
+ * with snapshot_write_end().
+ */
+Snapshot *snapshot_write_begin(SnapshotLock *lock);
+
+void snapshot_write_end(SnapshotLock *lock);
+
+/**
+ * Copies a consistent snapshot into @p out.
+ */
+void snapshot_read(const SnapshotLock *lock, Snapshot *out);
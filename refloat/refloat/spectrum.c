@@ -0,0 +1,181 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "spectrum.h"
+
+#include "fast_math.h"
+
+#include <math.h>
+
+// Peaks below this are rider and board motion, not vibration
+#define PEAK_MIN_FREQUENCY 20.0f  // [Hz]
+#define PEAK_MIN_MAGNITUDE 1.0f  // [deg/s]
+// A peak has to stand out this much over the mean of the searched bins
+#define PEAK_MIN_PROMINENCE 4.0f
+// A notch this low would add phase lag in the balancing bandwidth
+#define NOTCH_MIN_FREQUENCY 40.0f  // [Hz]
+// Below this the motor electrical frequency is too low to relate peaks to it
+#define MIN_ELECTRICAL_FREQUENCY 10.0f  // [Hz]
+#define HARMONIC_SMOOTHING 0.3f
+// Stop tracking after this many blocks without a peak (~2 s at 832 Hz)
+#define MAX_BLOCKS_WITHOUT_PEAK 8
+
+void spectrum_configure(Spectrum *s, float sample_rate) {
+    s->sample_rate = sample_rate;
+    s->sample_count = 0;
+    s->next_bin = 0;
+    s->abs_erpm_sum = 0.0f;
+    s->peak_frequency = 0.0f;
+    s->peak_magnitude = 0.0f;
+    s->harmonic = 0.0f;
+    s->blocks_without_peak = 0;
+    for (int i = 0; i < SPECTRUM_SIGNALS; ++i) {
+        for (int j = 0; j < SPECTRUM_BINS; ++j) {
+            s->magnitudes[i][j] = 0.0f;
+        }
+    }
+}
+
+void spectrum_sample(Spectrum *s, float gyro, float current, float abs_erpm) {
+    if (s->sample_count == SPECTRUM_SAMPLES) {
+        return;
+    }
+
+    s->samples[SPECTRUM_GYRO][s->sample_count] = gyro;
+    s->samples[SPECTRUM_CURRENT][s->sample_count] = current;
+    s->abs_erpm_sum += abs_erpm;
+    __atomic_store_n(&s->sample_count, s->sample_count + 1, __ATOMIC_RELEASE);
+}
+
+static void apply_window(Spectrum *s) {
+    // Hann window, the cosine is rotated by a recurrence instead of evaluated
+    // for each sample
+    float step_sin, step_cos;
+    fast_sincosf(2.0f * M_PI / SPECTRUM_SAMPLES, &step_sin, &step_cos);
+    float c = 1.0f;
+    float si = 0.0f;
+
+    for (int i = 0; i < SPECTRUM_SAMPLES; ++i) {
+        float w = 0.5f - 0.5f * c;
+        for (int j = 0; j < SPECTRUM_SIGNALS; ++j) {
+            s->samples[j][i] *= w;
+        }
+
+        float next_c = c * step_cos - si * step_sin;
+        si = si * step_cos + c * step_sin;
+        c = next_c;
+    }
+}
+
+static void find_peak(Spectrum *s) {
+    const float *m = s->magnitudes[SPECTRUM_GYRO];
+    const float bin_width = s->sample_rate / SPECTRUM_SAMPLES;
+
+    int first = (int) ceilf(PEAK_MIN_FREQUENCY / bin_width);
+    if (first < 1) {
+        first = 1;
+    }
+
+    int peak = first;
+    float sum = 0.0f;
+    for (int i = first; i < SPECTRUM_BINS; ++i) {
+        sum += m[i];
+        if (m[i] > m[peak]) {
+            peak = i;
+        }
+    }
+    float mean = sum / (SPECTRUM_BINS - first);
+
+    s->peak_frequency = 0.0f;
+    s->peak_magnitude = m[peak];
+    if (m[peak] < PEAK_MIN_MAGNITUDE || m[peak] < PEAK_MIN_PROMINENCE * mean) {
+        return;
+    }
+
+    // Parabolic interpolation between the neighbouring bins
+    float offset = 0.0f;
+    if (peak > 1 && peak < SPECTRUM_BINS - 1) {
+        float denominator = m[peak - 1] - 2.0f * m[peak] + m[peak + 1];
+        if (denominator < 0.0f) {
+            offset = 0.5f * (m[peak - 1] - m[peak + 1]) / denominator;
+        }
+    }
+    s->peak_frequency = (peak + offset) * bin_width;
+}
+
+static void track_harmonic(Spectrum *s) {
+    s->block_electrical_frequency = s->abs_erpm_sum / SPECTRUM_SAMPLES / 60.0f;
+
+    if (s->peak_frequency > 0.0f && s->block_electrical_frequency > MIN_ELECTRICAL_FREQUENCY) {
+        float harmonic = s->peak_frequency / s->block_electrical_frequency;
+        if (s->harmonic > 0.0f) {
+            s->harmonic += HARMONIC_SMOOTHING * (harmonic - s->harmonic);
+        } else {
+            s->harmonic = harmonic;
+        }
+        s->blocks_without_peak = 0;
+    } else if (s->blocks_without_peak < MAX_BLOCKS_WITHOUT_PEAK) {
+        ++s->blocks_without_peak;
+    } else {
+        s->harmonic = 0.0f;
+    }
+}
+
+void spectrum_update(Spectrum *s) {
+    if (__atomic_load_n(&s->sample_count, __ATOMIC_ACQUIRE) < SPECTRUM_SAMPLES) {
+        return;
+    }
+
+    if (s->next_bin == 0) {
+        apply_window(s);
+    }
+
+    // The window halves the amplitude of a sinusoid, hence 4 / N instead of 2 / N
+    const float scale = 4.0f / SPECTRUM_SAMPLES;
+    int end = s->next_bin + SPECTRUM_BINS_PER_STEP;
+    for (int k = s->next_bin; k < end && k < SPECTRUM_BINS; ++k) {
+        float coeff = 2.0f * fast_cosf(2.0f * M_PI * k / SPECTRUM_SAMPLES);
+        for (int j = 0; j < SPECTRUM_SIGNALS; ++j) {
+            const float *x = s->samples[j];
+            float s1 = 0.0f;
+            float s2 = 0.0f;
+            for (int i = 0; i < SPECTRUM_SAMPLES; ++i) {
+                float s0 = x[i] + coeff * s1 - s2;
+                s2 = s1;
+                s1 = s0;
+            }
+            float power = s1 * s1 + s2 * s2 - coeff * s1 * s2;
+            s->magnitudes[j][k] = sqrtf(fmaxf(power, 0.0f)) * scale;
+        }
+    }
+    s->next_bin = end;
+
+    if (s->next_bin >= SPECTRUM_BINS) {
+        find_peak(s);
+        track_harmonic(s);
+
+        s->next_bin = 0;
+        s->abs_erpm_sum = 0.0f;
+        // Hands the block back to the sampling
+        __atomic_store_n(&s->sample_count, 0, __ATOMIC_RELEASE);
+    }
+}
+
+float spectrum_vibration_frequency(const Spectrum *s, float abs_erpm) {
+    float frequency = s->harmonic * abs_erpm / 60.0f;
+    return frequency >= NOTCH_MIN_FREQUENCY ? frequency : 0.0f;
+}
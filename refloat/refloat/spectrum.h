@@ -0,0 +1,81 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SPECTRUM_SAMPLES 128
+#define SPECTRUM_BINS (SPECTRUM_SAMPLES / 2)
+// Goertzel bins computed per spectrum_update() call
+#define SPECTRUM_BINS_PER_STEP 8
+
+typedef enum {
+    SPECTRUM_GYRO = 0,  // pitch rate before the notch filters [deg/s]
+    SPECTRUM_CURRENT,  // motor current [A]
+    SPECTRUM_SIGNALS,
+} SpectrumSignal;
+
+/**
+ * Block-wise spectrum of the pitch gyro rate and the motor current, used to
+ * find the dominant vibration and place a notch on it.
+ *
+ * spectrum_sample() only stores the samples (called every loop iteration),
+ * once a block is full spectrum_update() windows it and runs a Goertzel
+ * filter for every bin, SPECTRUM_BINS_PER_STEP bins per call, in a lower
+ * priority thread. Sampling pauses until the block is processed, the sample
+ * count hands the block over between the two threads.
+ *
+ * The gyro peak is expressed as a multiple (harmonic) of the motor electrical
+ * frequency, so that the notch can follow the ERPM between the blocks.
+ */
+typedef struct {
+    float samples[SPECTRUM_SIGNALS][SPECTRUM_SAMPLES];
+    uint16_t sample_count;  // the block is the processing thread's once full
+    uint8_t next_bin;
+    float abs_erpm_sum;
+
+    float sample_rate;  // [Hz]
+
+    // Amplitude of a sinusoid at each bin frequency, updated bin by bin
+    float magnitudes[SPECTRUM_SIGNALS][SPECTRUM_BINS];
+
+    float peak_frequency;  // [Hz], 0 if there's no peak
+    float peak_magnitude;  // [deg/s]
+    float block_electrical_frequency;  // [Hz]
+    // Peak frequency / motor electrical frequency, 0 if not tracking, read by
+    // the loop
+    float harmonic;
+    uint8_t blocks_without_peak;
+} Spectrum;
+
+void spectrum_configure(Spectrum *s, float sample_rate);
+
+void spectrum_sample(Spectrum *s, float gyro, float current, float abs_erpm);
+
+/**
+ * Processes a part of a full block, call from a lower priority thread than
+ * spectrum_sample().
+ */
+void spectrum_update(Spectrum *s);
+
+/**
+ * Frequency of the tracked vibration at the current ERPM [Hz], 0 if no
+ * vibration is tracked or it is too low to be notched out.
+ */
+float spectrum_vibration_frequency(const Spectrum *s, float abs_erpm);
@@ -0,0 +1,219 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "telemetry.h"
+
+#include "conf/buffer.h"
+
+#include <math.h>
+#include <string.h>
+
+#define FIELD(name, unit, type, scale) {name, unit, TELEMETRY_##type, scale}
+
+static const TelemetryField fields[TELEMETRY_FIELD_COUNT] = {
+    [TF_STATE] = FIELD("state", "", UINT8, 1),
+    [TF_MODE] = FIELD("mode", "", UINT8, 1),
+    [TF_SAT] = FIELD("setpoint_adjustment", "", UINT8, 1),
+    [TF_STOP_CONDITION] = FIELD("stop_condition", "", UINT8, 1),
+    [TF_FOOTPAD_STATE] = FIELD("footpad_state", "", UINT8, 1),
+    [TF_CHARGING] = FIELD("charging", "", UINT8, 1),
+    [TF_DARKRIDE] = FIELD("darkride", "", UINT8, 1),
+    [TF_WHEELSLIP] = FIELD("wheelslip", "", UINT8, 1),
+    [TF_BEEP_REASON] = FIELD("beep_reason", "", UINT8, 1),
+    [TF_PITCH] = FIELD("pitch", "deg", FLOAT16, 100),
+    [TF_BALANCE_PITCH] = FIELD("balance_pitch", "deg", FLOAT16, 100),
+    [TF_ROLL] = FIELD("roll", "deg", FLOAT16, 100),
+    [TF_IMU_PITCH] = FIELD("imu_pitch", "deg", FLOAT16, 100),
+    [TF_ADC1] = FIELD("adc1", "V", FLOAT16, 1000),
+    [TF_ADC2] = FIELD("adc2", "V", FLOAT16, 1000),
+    [TF_THROTTLE] = FIELD("throttle", "", FLOAT16, 10000),
+    [TF_ERPM] = FIELD("erpm", "ERPM", FLOAT32, 1),
+    [TF_DUTY_CYCLE] = FIELD("duty_cycle", "", FLOAT16, 10000),
+    [TF_SETPOINT] = FIELD("setpoint", "deg", FLOAT16, 100),
+    [TF_ATR_OFFSET] = FIELD("atr_offset", "deg", FLOAT16, 100),
+    [TF_BRAKETILT_OFFSET] = FIELD("braketilt_offset", "deg", FLOAT16, 100),
+    [TF_TORQUE_TILT_OFFSET] = FIELD("torque_tilt_offset", "deg", FLOAT16, 100),
+    [TF_TURNTILT] = FIELD("turntilt", "deg", FLOAT16, 100),
+    [TF_INPUTTILT] = FIELD("inputtilt", "deg", FLOAT16, 100),
+    [TF_PID_VALUE] = FIELD("pid_value", "A", FLOAT16, 10),
+    [TF_ATR_FILTERED_CURRENT] = FIELD("atr_filtered_current", "A", FLOAT16, 10),
+    [TF_ATR_ACCEL_DIFF] = FIELD("atr_accel_diff", "", FLOAT32, 1000),
+    [TF_ATR_SPEED_BOOST] = FIELD("atr_speed_boost", "", FLOAT32, 1000),
+    [TF_BOOSTER_CURRENT] = FIELD("booster_current", "A", FLOAT16, 10),
+    [TF_CHARGING_CURRENT] = FIELD("charging_current", "A", FLOAT16, 100),
+    [TF_CHARGING_VOLTAGE] = FIELD("charging_voltage", "V", FLOAT16, 10),
+    [TF_RATE_P] = FIELD("rate_p", "A", FLOAT16, 10),
+    [TF_MOTOR_CURRENT] = FIELD("motor_current", "A", FLOAT16, 10),
+};
+
+const TelemetryField *telemetry_field(TelemetryFieldId id) {
+    return &fields[id];
+}
+
+float telemetry_value(const Snapshot *s, TelemetryFieldId id) {
+    switch (id) {
+    case TF_STATE:
+        return s->state.state;
+    case TF_MODE:
+        return s->state.mode;
+    case TF_SAT:
+        return s->state.sat;
+    case TF_STOP_CONDITION:
+        return s->state.stop_condition;
+    case TF_FOOTPAD_STATE:
+        return s->footpad_state;
+    case TF_CHARGING:
+        return s->state.charging;
+    case TF_DARKRIDE:
+        return s->state.darkride;
+    case TF_WHEELSLIP:
+        return s->state.wheelslip;
+    case TF_BEEP_REASON:
+        return s->beep_reason;
+    case TF_PITCH:
+        return s->pitch;
+    case TF_BALANCE_PITCH:
+        return s->balance_pitch;
+    case TF_ROLL:
+        return s->roll;
+    case TF_IMU_PITCH:
+        return s->imu_pitch;
+    case TF_ADC1:
+        return s->adc1;
+    case TF_ADC2:
+        return s->adc2;
+    case TF_THROTTLE:
+        return s->throttle;
+    case TF_ERPM:
+        return s->erpm;
+    case TF_DUTY_CYCLE:
+        return s->duty_cycle;
+    case TF_SETPOINT:
+        return s->setpoint;
+    case TF_ATR_OFFSET:
+        return s->atr_offset;
+    case TF_BRAKETILT_OFFSET:
+        return s->braketilt_offset;
+    case TF_TORQUE_TILT_OFFSET:
+        return s->torque_tilt_offset;
+    case TF_TURNTILT:
+        return s->turntilt;
+    case TF_INPUTTILT:
+        return s->inputtilt;
+    case TF_PID_VALUE:
+        return s->pid_value;
+    case TF_ATR_FILTERED_CURRENT:
+        return s->atr_filtered_current;
+    case TF_ATR_ACCEL_DIFF:
+        return s->atr_accel_diff;
+    case TF_ATR_SPEED_BOOST:
+        return s->atr_speed_boost;
+    case TF_BOOSTER_CURRENT:
+        return s->booster_current;
+    case TF_CHARGING_CURRENT:
+        return s->charging_current;
+    case TF_CHARGING_VOLTAGE:
+        return s->charging_voltage;
+    case TF_RATE_P:
+        return s->rate_p;
+    case TF_MOTOR_CURRENT:
+        return s->current;
+    case TELEMETRY_FIELD_COUNT:
+        break;
+    }
+    return 0;
+}
+
+static int32_t type_size(TelemetryType type) {
+    switch (type) {
+    case TELEMETRY_UINT8:
+        return 1;
+    case TELEMETRY_FLOAT16:
+        return 2;
+    case TELEMETRY_FLOAT32:
+        return 4;
+    }
+    return 0;
+}
+
+int32_t telemetry_packed_size(uint64_t mask) {
+    int32_t size = 0;
+    for (int i = 0; i < TELEMETRY_FIELD_COUNT; ++i) {
+        if (mask & (1ULL << i)) {
+            size += type_size(fields[i].type);
+        }
+    }
+    return size;
+}
+
+void telemetry_pack(const Snapshot *s, uint64_t mask, uint8_t *buffer, int32_t *ind) {
+    for (int i = 0; i < TELEMETRY_FIELD_COUNT; ++i) {
+        if (!(mask & (1ULL << i))) {
+            continue;
+        }
+
+        const TelemetryField *f = &fields[i];
+        float value = telemetry_value(s, i);
+        switch (f->type) {
+        case TELEMETRY_UINT8:
+            buffer[(*ind)++] = (uint8_t) value;
+            break;
+        case TELEMETRY_FLOAT16: {
+            // Saturate instead of wrapping around when out of range
+            float limit = INT16_MAX / f->scale;
+            buffer_append_float16(buffer, fminf(fmaxf(value, -limit), limit), f->scale, ind);
+            break;
+        }
+        case TELEMETRY_FLOAT32:
+            buffer_append_float32_auto(buffer, value, ind);
+            break;
+        }
+    }
+}
+
+uint8_t telemetry_describe(uint8_t first, uint8_t *buffer, int32_t *ind, int32_t size) {
+    uint8_t count = 0;
+    for (int i = first; i < TELEMETRY_FIELD_COUNT; ++i) {
+        const TelemetryField *f = &fields[i];
+        int32_t name_len = strlen(f->name) + 1;
+        int32_t unit_len = strlen(f->unit) + 1;
+        if (*ind + 6 + name_len + unit_len > size) {
+            break;
+        }
+
+        buffer[(*ind)++] = i;
+        buffer[(*ind)++] = f->type;
+        buffer_append_float32_auto(buffer, f->scale, ind);
+        memcpy(&buffer[*ind], f->name, name_len);
+        *ind += name_len;
+        memcpy(&buffer[*ind], f->unit, unit_len);
+        *ind += unit_len;
+        ++count;
+    }
+    return count;
+}
+
+void telemetry_append_mask(uint8_t *buffer, uint64_t mask, int32_t *ind) {
+    buffer_append_uint32(buffer, mask >> 32, ind);
+    buffer_append_uint32(buffer, mask, ind);
+}
+
+uint64_t telemetry_get_mask(const uint8_t *buffer, int32_t *ind) {
+    uint64_t mask = (uint64_t) buffer_get_uint32(buffer, ind) << 32;
+    mask |= buffer_get_uint32(buffer, ind);
+    return mask;
+}
@@ -0,0 +1,118 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "snapshot.h"
+
+#include <stdint.h>
+
+/**
+ * Telemetry field IDs, the bit positions in the field masks. IDs are never
+ * reused or reordered, new fields are added at the end.
+ */
+typedef enum {
+    TF_STATE = 0,
+    TF_MODE,
+    TF_SAT,
+    TF_STOP_CONDITION,
+    TF_FOOTPAD_STATE,
+    TF_CHARGING,
+    TF_DARKRIDE,
+    TF_WHEELSLIP,
+    TF_BEEP_REASON,
+    TF_PITCH,
+    TF_BALANCE_PITCH,
+    TF_ROLL,
+    TF_IMU_PITCH,
+    TF_ADC1,
+    TF_ADC2,
+    TF_THROTTLE,
+    TF_ERPM,
+    TF_DUTY_CYCLE,
+    TF_SETPOINT,
+    TF_ATR_OFFSET,
+    TF_BRAKETILT_OFFSET,
+    TF_TORQUE_TILT_OFFSET,
+    TF_TURNTILT,
+    TF_INPUTTILT,
+    TF_PID_VALUE,
+    TF_ATR_FILTERED_CURRENT,
+    TF_ATR_ACCEL_DIFF,
+    TF_ATR_SPEED_BOOST,
+    TF_BOOSTER_CURRENT,
+    TF_CHARGING_CURRENT,
+    TF_CHARGING_VOLTAGE,
+    TF_RATE_P,
+    TF_MOTOR_CURRENT,
+    TELEMETRY_FIELD_COUNT
+} TelemetryFieldId;
+
+_Static_assert(TELEMETRY_FIELD_COUNT <= 64, "Telemetry field masks are 64 bits");
+
+#define TELEMETRY_MASK_ALL (TELEMETRY_FIELD_COUNT == 64 ? ~0ULL : (1ULL << TELEMETRY_FIELD_COUNT) - 1)
+
+// How a field is packed in the plain frames, the compact frames encode every
+// field as a fixed-point integer (see telemetry_codec.h)
+typedef enum {
+    TELEMETRY_UINT8 = 0,  // the value truncated to a byte
+    TELEMETRY_FLOAT16 = 1,  // int16 of the value times the scale, saturated
+    TELEMETRY_FLOAT32 = 2  // buffer_append_float32_auto()
+} TelemetryType;
+
+/**
+ * Description of a telemetry field. No pointers, so that the table needs no
+ * relocation in the position independent package.
+ */
+typedef struct {
+    char name[24];
+    char unit[8];
+    TelemetryType type;
+    // Fixed-point resolution: the value times the scale, rounded, is what
+    // TELEMETRY_FLOAT16 and the compact frames send
+    float scale;
+} TelemetryField;
+
+const TelemetryField *telemetry_field(TelemetryFieldId id);
+
+float telemetry_value(const Snapshot *s, TelemetryFieldId id);
+
+/**
+ * Number of bytes the fields in @p mask take when packed.
+ */
+int32_t telemetry_packed_size(uint64_t mask);
+
+/**
+ * Appends the values of the fields in @p mask back to back, in ID order.
+ */
+void telemetry_pack(const Snapshot *s, uint64_t mask, uint8_t *buffer, int32_t *ind);
+
+/**
+ * Appends the descriptions of the fields from @p first on, as many as fit
+ * in @p size bytes of the buffer. Returns the number of fields appended.
+ *
+ * Each description is the ID, the type, the scale (float32_auto) and the
+ * name and unit as null-terminated strings.
+ */
+uint8_t telemetry_describe(uint8_t first, uint8_t *buffer, int32_t *ind, int32_t size);
+
+/**
+ * Field masks are sent as 8 bytes, big endian like the rest of the protocol.
+ */
+void telemetry_append_mask(uint8_t *buffer, uint64_t mask, int32_t *ind);
+
+uint64_t telemetry_get_mask(const uint8_t *buffer, int32_t *ind);
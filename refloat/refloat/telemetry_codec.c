@@ -0,0 +1,161 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "telemetry_codec.h"
+
+#include <math.h>
+
+// A zigzag varint of 32 bits takes at most 5 bytes
+#define VARINT_MAX_SIZE 5
+
+static int32_t quantize(float value, float scale) {
+    // Saturate to the int32 range (the largest float below 2^31)
+    float q = fminf(fmaxf(value * scale, -2147483520.0f), 2147483520.0f);
+    return lroundf(q);
+}
+
+// The differences wrap around in uint32, the decoder wraps them back
+static uint32_t zigzag(int32_t n) {
+    return ((uint32_t) n << 1) ^ (uint32_t) (n >> 31);
+}
+
+static int32_t unzigzag(uint32_t n) {
+    return (int32_t) (n >> 1) ^ -(int32_t) (n & 1);
+}
+
+static void append_varint(uint8_t *buffer, uint32_t n, int32_t *ind) {
+    while (n >= 0x80) {
+        buffer[(*ind)++] = (n & 0x7F) | 0x80;
+        n >>= 7;
+    }
+    buffer[(*ind)++] = n;
+}
+
+static bool get_varint(const uint8_t *buffer, int32_t len, int32_t *ind, uint32_t *n) {
+    *n = 0;
+    for (int shift = 0; shift < 7 * VARINT_MAX_SIZE && *ind < len; shift += 7) {
+        uint8_t byte = buffer[(*ind)++];
+        *n |= (uint32_t) (byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void telemetry_encoder_reset(TelemetryEncoder *e, uint8_t keyframe_interval) {
+    e->mask = 0;
+    e->counter = 0;
+    e->keyframe_interval = keyframe_interval > 0 ? keyframe_interval : 1;
+    e->until_keyframe = 0;
+}
+
+int32_t telemetry_encoded_max_size(uint64_t mask) {
+    int32_t size = 1 + 8;
+    for (int i = 0; i < TELEMETRY_FIELD_COUNT; ++i) {
+        if (mask & (1ULL << i)) {
+            size += VARINT_MAX_SIZE;
+        }
+    }
+    return size;
+}
+
+void telemetry_encode(
+    TelemetryEncoder *e, const Snapshot *s, uint64_t mask, uint8_t *buffer, int32_t *ind
+) {
+    mask &= TELEMETRY_MASK_ALL;
+
+    bool keyframe = e->until_keyframe == 0 || mask != e->mask;
+    if (keyframe) {
+        e->mask = mask;
+        e->until_keyframe = e->keyframe_interval;
+    }
+    --e->until_keyframe;
+
+    buffer[(*ind)++] = (keyframe ? TELEMETRY_KEYFRAME : 0) | e->counter;
+    e->counter = (e->counter + 1) & TELEMETRY_COUNTER_MASK;
+
+    if (keyframe) {
+        telemetry_append_mask(buffer, mask, ind);
+    }
+
+    for (int i = 0; i < TELEMETRY_FIELD_COUNT; ++i) {
+        if (!(mask & (1ULL << i))) {
+            continue;
+        }
+
+        int32_t q = quantize(telemetry_value(s, i), telemetry_field(i)->scale);
+        int32_t n = keyframe ? q : (int32_t) ((uint32_t) q - (uint32_t) e->last[i]);
+        append_varint(buffer, zigzag(n), ind);
+        e->last[i] = q;
+    }
+}
+
+void telemetry_decoder_reset(TelemetryDecoder *d) {
+    d->mask = 0;
+    d->counter = 0;
+    d->synced = false;
+}
+
+bool telemetry_decode(
+    TelemetryDecoder *d, const uint8_t *buffer, int32_t len, uint64_t *mask, float *values
+) {
+    int32_t ind = 0;
+    if (len < 1) {
+        return false;
+    }
+
+    uint8_t flags = buffer[ind++];
+    uint8_t counter = flags & TELEMETRY_COUNTER_MASK;
+    bool keyframe = flags & TELEMETRY_KEYFRAME;
+
+    if (keyframe) {
+        if (len < ind + 8) {
+            d->synced = false;
+            return false;
+        }
+        d->mask = telemetry_get_mask(buffer, &ind) & TELEMETRY_MASK_ALL;
+        d->synced = true;
+    } else if (counter != ((d->counter + 1) & TELEMETRY_COUNTER_MASK)) {
+        // A frame got lost, the deltas don't apply to the values we have
+        d->synced = false;
+    }
+    d->counter = counter;
+
+    if (!d->synced) {
+        return false;
+    }
+
+    for (int i = 0; i < TELEMETRY_FIELD_COUNT; ++i) {
+        if (!(d->mask & (1ULL << i))) {
+            continue;
+        }
+
+        uint32_t n;
+        if (!get_varint(buffer, len, &ind, &n)) {
+            d->synced = false;
+            return false;
+        }
+
+        int32_t v = unzigzag(n);
+        d->last[i] = keyframe ? v : (int32_t) ((uint32_t) d->last[i] + (uint32_t) v);
+        values[i] = d->last[i] / telemetry_field(i)->scale;
+    }
+
+    *mask = d->mask;
+    return true;
+}
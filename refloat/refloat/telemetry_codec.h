@@ -0,0 +1,92 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "snapshot.h"
+#include "telemetry.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Flags byte of a compact frame: the keyframe bit and a frame counter
+#define TELEMETRY_KEYFRAME 0x80
+#define TELEMETRY_COUNTER_MASK 0x7F
+
+/**
+ * Compact telemetry frames: every field is quantized to a fixed-point
+ * integer with the scale of its telemetry_field() and sent as a zigzag
+ * varint. A keyframe sends the field mask and the values themselves, the
+ * frames in between send only the differences from the previous frame, so
+ * a value that didn't change takes a single byte.
+ *
+ * Frame: flags (TELEMETRY_KEYFRAME | 7-bit frame counter), the field mask
+ * (keyframes only, see telemetry_append_mask()), then a varint per field in
+ * the mask, in ID order.
+ *
+ * The counter lets the decoder notice a lost frame, it then drops the delta
+ * frames until the next keyframe.
+ */
+typedef struct {
+    uint64_t mask;
+    int32_t last[TELEMETRY_FIELD_COUNT];
+    uint8_t counter;
+    uint8_t keyframe_interval;  // frames from one keyframe to the next
+    uint8_t until_keyframe;
+} TelemetryEncoder;
+
+/**
+ * The next frame will be a keyframe.
+ */
+void telemetry_encoder_reset(TelemetryEncoder *e, uint8_t keyframe_interval);
+
+/**
+ * Upper bound of the size of a compact frame with the fields in @p mask.
+ */
+int32_t telemetry_encoded_max_size(uint64_t mask);
+
+/**
+ * Appends a compact frame of the fields in @p mask. A change of the mask
+ * forces a keyframe.
+ */
+void telemetry_encode(
+    TelemetryEncoder *e, const Snapshot *s, uint64_t mask, uint8_t *buffer, int32_t *ind
+);
+
+/**
+ * Reference decoder for the host tools and as a specification for app
+ * decoders (the QML UI has a port of it).
+ */
+typedef struct {
+    uint64_t mask;
+    int32_t last[TELEMETRY_FIELD_COUNT];
+    uint8_t counter;
+    bool synced;
+} TelemetryDecoder;
+
+void telemetry_decoder_reset(TelemetryDecoder *d);
+
+/**
+ * Decodes a compact frame of @p len bytes into @p values, indexed by field
+ * ID, and sets @p mask to the fields present.
+ *
+ * @return false if the frame is malformed or is a delta frame that can't be
+ * decoded because of a lost frame, the decoder then waits for a keyframe.
+ */
+bool telemetry_decode(
+    TelemetryDecoder *d, const uint8_t *buffer, int32_t len, uint64_t *mask, float *values
+);
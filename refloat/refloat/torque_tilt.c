@@ -27,11 +27,13 @@ void torque_tilt_reset(TorqueTilt *tt) {
 }
 
 void torque_tilt_configure(TorqueTilt *tt, const RefloatConfig *config) {
-    tt->on_step_size = config->torquetilt_on_speed / config->hertz;
-    tt->off_step_size = config->torquetilt_off_speed / config->hertz;
+    tt->on_speed = config->torquetilt_on_speed;
+    tt->off_speed = config->torquetilt_off_speed;
 }
 
-void torque_tilt_update(TorqueTilt *tt, const MotorData *motor, const RefloatConfig *config) {
+void torque_tilt_update(
+    TorqueTilt *tt, const MotorData *motor, const RefloatConfig *config, float dt
+) {
     float strength =
         motor->braking ? config->torquetilt_strength_regen : config->torquetilt_strength;
 
@@ -48,19 +50,19 @@ void torque_tilt_update(TorqueTilt *tt, const MotorData *motor, const RefloatCon
         ) *
         sign(motor->atr_filtered_current);
 
-    float step_size = 0;
+    float speed = 0;
     if ((tt->offset - target_offset > 0 && target_offset > 0) ||
         (tt->offset - target_offset < 0 && target_offset < 0)) {
-        step_size = tt->off_step_size;
+        speed = tt->off_speed;
     } else {
-        step_size = tt->on_step_size;
+        speed = tt->on_speed;
     }
 
     if (motor->abs_erpm < 500) {
-        step_size /= 2;
+        speed /= 2;
     }
 
-    rate_limitf(&tt->offset, target_offset, step_size);
+    rate_limitf(&tt->offset, target_offset, speed * dt);
 }
 
 void torque_tilt_winddown(TorqueTilt *tt) {
@@ -0,0 +1,76 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "tune_handoff.h"
+
+#include "vesc_c_if.h"
+
+#include <stdbool.h>
+
+typedef enum {
+    HANDOFF_EMPTY = 0,
+    HANDOFF_WRITING,
+    HANDOFF_PENDING,
+    HANDOFF_READING
+} HandoffState;
+
+static bool transition(TuneHandoff *h, uint32_t from, uint32_t to) {
+    return __atomic_compare_exchange_n(
+        &h->state, &from, to, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED
+    );
+}
+
+void tune_handoff_init(TuneHandoff *h) {
+    __atomic_store_n(&h->state, HANDOFF_EMPTY, __ATOMIC_RELEASE);
+}
+
+TuneUpdate *tune_handoff_begin(TuneHandoff *h, const RefloatConfig *live) {
+    while (true) {
+        if (transition(h, HANDOFF_EMPTY, HANDOFF_WRITING)) {
+            h->update.config = *live;
+            h->update.apply = 0;
+            h->update.current_max = 0;
+            h->update.current_min = 0;
+            return &h->update;
+        }
+
+        if (transition(h, HANDOFF_PENDING, HANDOFF_WRITING)) {
+            return &h->update;
+        }
+
+        // The loop is copying the last update
+        VESC_IF->sleep_us(50);
+    }
+}
+
+void tune_handoff_publish(TuneHandoff *h, TuneApply apply) {
+    if (apply > h->update.apply) {
+        h->update.apply = apply;
+    }
+    __atomic_store_n(&h->state, HANDOFF_PENDING, __ATOMIC_RELEASE);
+}
+
+const TuneUpdate *tune_handoff_acquire(TuneHandoff *h) {
+    if (!transition(h, HANDOFF_PENDING, HANDOFF_READING)) {
+        return NULL;
+    }
+    return &h->update;
+}
+
+void tune_handoff_release(TuneHandoff *h) {
+    __atomic_store_n(&h->state, HANDOFF_EMPTY, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,84 @@
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "conf/datatypes.h"
+
+#include <stdint.h>
+
+typedef enum {
+    // Only the derived tune values and the control plan need updating
+    TUNE_APPLY_PLAN = 1,
+    // The filters and estimators need reconfiguring as well
+    TUNE_APPLY_RECONFIGURE = 2,
+    // The config is replaced as a whole (written from VESC Tool, leaving a
+    // special mode), everything is configured anew
+    TUNE_APPLY_CONFIGURE = 3
+} TuneApply;
+
+typedef struct {
+    RefloatConfig config;
+    TuneApply apply;
+    // Motor current limits, 0 keeps the current ones
+    float current_max, current_min;
+} TuneUpdate;
+
+/**
+ * Hands runtime tune changes and mode switches from the command handler over
+ * to the balance loop, so the loop never sees a half-written config. All
+ * changes of the live config outside the loop go through here, including
+ * writing the whole config from VESC Tool and restoring it from EEPROM, the
+ * loop replaces the live config with the update as a whole.
+ *
+ * The handler edits the pending update (a copy of the live config), then
+ * publishes it. The loop adopts it at the start of an iteration. A state word
+ * changed by atomic compare-and-swap guards the update: the loop never waits
+ * for the adoption, it skips it while the handler is writing, and the handler
+ * sleeps for the few microseconds the loop takes to copy it. Updates
+ * published before the loop adopts them are merged into one. The loop can
+ * publish an update itself (a mode switch), it then waits for a handler that
+ * is writing.
+ *
+ * The pending update is a second full RefloatConfig, about 570 bytes of the
+ * package memory.
+ */
+typedef struct {
+    TuneUpdate update;
+    uint32_t state;
+} TuneHandoff;
+
+void tune_handoff_init(TuneHandoff *h);
+
+/**
+ * Returns the pending update to edit. It starts as a copy of @p live, unless
+ * an earlier update is still pending, then it's that update.
+ */
+TuneUpdate *tune_handoff_begin(TuneHandoff *h, const RefloatConfig *live);
+
+/**
+ * Hands the update over to the loop, @p apply is merged with that of a still
+ * pending update.
+ */
+void tune_handoff_publish(TuneHandoff *h, TuneApply apply);
+
+/**
+ * Returns the published update or NULL. It has to be released once adopted.
+ */
+const TuneUpdate *tune_handoff_acquire(TuneHandoff *h);
+
+void tune_handoff_release(TuneHandoff *h);
@@ -26,6 +26,10 @@
 #include "conf/buffer.h"
 #include "conf/conf_default.h"
 
+#include "biquad.h"
+#include "fast_math.h"
+#include "kalman_pitch.h"
+
 #include <math.h>
 #include <string.h>
 
@@ -77,18 +81,6 @@ typedef enum {
 	ON
 } SwitchState;
 
-typedef struct{
-	float a0, a1, a2, b1, b2;
-	float c1, c2;
-	float x0, x1, x2, y1, y2;
-	float z1, z2;
-} Biquad;
-
-typedef enum {
-	BQ_LOWPASS,
-	BQ_HIGHPASS
-} BiquadType;
-
 // This is all persistent state of the application, which will be allocated in init. It
 // is put here because variables can only be read-only when this program is loaded
 // in flash without virtual memory in RAM (as all RAM already is dedicated to the
@@ -218,7 +210,8 @@ typedef struct {
 	Biquad pitch_biquad;
 	
 	// Kalman Filter
-	float P00, P01, P10, P11, bias, pitch_smooth_kalman;
+	KalmanPitch pitch_kalman;
+	float pitch_smooth_kalman;
 
 	// Throttle/Brake Scaling
 	float roll_pid_mod;
@@ -312,68 +305,6 @@ void beep_on(data *d, bool force)
 		EXT_BUZZER_ON();
 }
 
-// Utility Functions
-// Biquad 1 is for current Biquad 2 is for pitch
-static float biquad_process1(Biquad *biquad, float in) {
-    float out = in * biquad->a0 + biquad->c1;
-    biquad->c1 = in * biquad->a1 + biquad->c2 - biquad->b1 * out;
-    biquad->c2 = in * biquad->a2 - biquad->b2 * out;
-    return out;
-}
-
-static void biquad_config1(Biquad *biquad, BiquadType type, float Fc) {
-	float K = tanf(M_PI * Fc);	// -0.0159;
-	float Q = 0.707; // maximum sharpness (0.5 = maximum smoothness)
-	float norm = 1 / (1 + K / Q + K * K);
-	if (type == BQ_LOWPASS) {
-		biquad->a0 = K * K * norm;
-		biquad->a1 = 2 * biquad->a0;
-		biquad->a2 = biquad->a0;
-	}
-	else if (type == BQ_HIGHPASS) {
-		biquad->a0 = 1 * norm;
-		biquad->a1 = -2 * biquad->a0;
-		biquad->a2 = biquad->a0;
-	}
-	biquad->b1 = 2 * (K * K - 1) * norm;
-	biquad->b2 = (1 - K / Q + K * K) * norm;
-}
-
-static void biquad_reset1(Biquad *biquad) {
-	biquad->c1 = 0;
-	biquad->c2 = 0;
-}
-
-static float biquad_process2(Biquad *biquad, float in) {
-    float out = in * biquad->x0 + biquad->z1;
-    biquad->z1 = in * biquad->x1 + biquad->z2 - biquad->y1 * out;
-    biquad->z2 = in * biquad->x2 - biquad->y2 * out;
-    return out;
-}
-
-static void biquad_config2(Biquad *biquad, BiquadType type, float Fc) {
-	float K = tanf(M_PI * Fc);	// -0.0159;
-	float Q = 0.5; // maximum sharpness (0.5 = maximum smoothness)
-	float norm = 1 / (1 + K / Q + K * K);
-	if (type == BQ_LOWPASS) {
-		biquad->x0 = K * K * norm;
-		biquad->x1 = 2 * biquad->x0;
-		biquad->x2 = biquad->x0;
-	}
-	else if (type == BQ_HIGHPASS) {
-		biquad->x0 = 1 * norm;
-		biquad->x1 = -2 * biquad->x0;
-		biquad->x2 = biquad->x0;
-	}
-	biquad->y1 = 2 * (K * K - 1) * norm;
-	biquad->y2 = (1 - K / Q + K * K) * norm;
-}
-
-static void biquad_reset2(Biquad *biquad) {
-	biquad->z1 = 0;
-	biquad->z2 = 0;
-}
-
 // First start only, set initial state
 static void app_init(data *d) {
 	if (d->state != DISABLED) {
@@ -465,8 +396,10 @@ static void configure(data *d) {
 	float Fc1, Fc2; 
 	Fc1 = 5.0 / (float)d->tnt_conf.hertz; 
 	Fc2 = d->tnt_conf.pitch_filter / (float)d->tnt_conf.hertz; 
-	biquad_config1(&d->atr_current_biquad, BQ_LOWPASS, Fc1);
-	biquad_config2(&d->pitch_biquad, BQ_LOWPASS, Fc2);
+	biquad_configure(&d->atr_current_biquad, BQ_LOWPASS, Fc1);
+	biquad_configure_q(&d->pitch_biquad, BQ_LOWPASS, Fc2, 0.5, 0);
+	kalman_pitch_configure(&d->pitch_kalman, d->tnt_conf.kalman_factor1 / 10000,
+			d->tnt_conf.kalman_factor2 / 10000, d->tnt_conf.kalman_factor3 / 100000);
 	
 	// Allows smoothing of Remote Tilt
 	d->inputtilt_ramped_step_size = 0;
@@ -597,7 +530,7 @@ static void reset_vars(data *d) {
 	if (d->inputtilt_interpolated != d->stickytilt_val || !(VESC_IF->get_ppm_age() < 1)) { 	// Persistent sticky tilt value if we are at value with remote connected
 		d->inputtilt_interpolated = 0;			// Reset other values
 	}
-	biquad_reset1(&d->atr_current_biquad);
+	biquad_reset(&d->atr_current_biquad);
 	
 	//Control variables
 	d->pid_value = 0;
@@ -625,14 +558,10 @@ static void reset_vars(data *d) {
 	//Low pass pitch filter
 	d->prop_smooth = 0;
 	d->abs_prop_smooth = 0;
-	biquad_reset2(&d->pitch_biquad);
+	biquad_reset(&d->pitch_biquad);
 	
 	//Kalman filter
-	d->P00 = 0;
-	d->P01 = 0;
-	d->P10 = 0;
-	d->P11 = 0;
-	d->bias = 0;
+	kalman_pitch_reset(&d->pitch_kalman, d->pitch_angle);
 	d->pitch_smooth = d->pitch_angle;
 	d->pitch_smooth_kalman = d->pitch_angle;
 
@@ -1248,7 +1177,7 @@ static void check_traction(data *d){
 static void check_drop(data *d){
 	d->last_accel_z = d->accel[2];
 	VESC_IF->imu_get_accel(d->accel);
-	float accel_z_reduction = cosf(DEG2RAD_f(d->roll_angle)) * cosf(DEG2RAD_f(d->pitch_angle));		// Accel z is naturally reduced by the pitch and roll angles, so use geometry to compensate
+	float accel_z_reduction = fast_cosf(DEG2RAD_f(d->roll_angle)) * fast_cosf(DEG2RAD_f(d->pitch_angle));		// Accel z is naturally reduced by the pitch and roll angles, so use geometry to compensate
 	if (d->applied_accel_z_reduction > accel_z_reduction) {							// Accel z acts slower than pitch and roll so we need to delay accel z reduction as necessary
 		d->applied_accel_z_reduction = accel_z_reduction ;						// Roll or pitch are increasing. Do not delay
 	} else {
@@ -1359,44 +1288,10 @@ static void apply_rollkp(data *d, float new_pid_value){
 }
 
 static void apply_kalman(data *d){
-    // KasBot V2  -  Kalman filter module - http://www.x-firm.com/?page_id=145
-    // Modified by Kristian Lauszus
-    // See my blog post for more information: http://blog.tkjelectronics.dk/2012/09/a-practical-approach-to-kalman-filter-and-how-to-implement-it
-    // Discrete Kalman filter time update equations - Time Update ("Predict")
-    // Update xhat - Project the state ahead
-	float Q_angle = d->tnt_conf.kalman_factor1/10000;
-	float Q_bias = d->tnt_conf.kalman_factor2/10000;
-	float R_measure = d->tnt_conf.kalman_factor3/100000;
-	// Step 1
-	float rate = d->gyro[1] / 131 - d->bias; 
-	d->pitch_smooth_kalman += d->diff_time * rate;
-	// Update estimation error covariance - Project the error covariance ahead
-	// Step 2 
-	d->P00 += d->diff_time * (d->diff_time * d->P11 - d->P01 - d->P10 + Q_angle);
-	d->P01 -= d->diff_time * d->P11;
-	d->P10 -= d->diff_time * d->P11;
-	d->P11 += Q_bias * d->diff_time;
-	// Discrete Kalman filter measurement update equations - Measurement Update ("Correct")
-	// Step 4
-	float S = d->P00 + R_measure; // Estimate error
-	// Calculate Kalman gain
-	// Step 5
-	float K0 = d->P00 / S; // Kalman gain - This is a 2x1 vector
-	float K1 = d->P10 / S;
-	// Calculate angle and bias - Update estimate with measurement zk (newAngle)
-	// Step 3
-	float y = d->pitch_smooth - d->pitch_smooth_kalman; // Angle difference
-	// Step 6
-	d->pitch_smooth_kalman += K0 * y;
-	d->bias += K1 * y;
-	// Calculate estimation error covariance - Update the error covariance
-	// Step 7
-	float P00_temp = d->P00;
-	float P01_temp = d->P01;
-	d->P00 -= K0 * P00_temp;
-	d->P01 -= K0 * P01_temp;
-	d->P10 -= K1 * P00_temp;
-	d->P11 -= K1 * P01_temp;
+	// Noise terms are precomputed in configure(), see kalman_pitch.h
+	kalman_pitch_predict(&d->pitch_kalman, d->gyro[1] / 131, d->diff_time);
+	kalman_pitch_update(&d->pitch_kalman, d->pitch_smooth);
+	d->pitch_smooth_kalman = d->pitch_kalman.angle;
 }
 
 static float select_kp(data *d) {
@@ -1522,7 +1417,7 @@ static void tnt_thd(void *arg) {
 		// Read values for GUI
 		d->motor_current = VESC_IF->mc_get_tot_current_directional_filtered();
 		// Filter current (Biquad)
-		d->atr_filtered_current = biquad_process1(&d->atr_current_biquad, d->motor_current);
+		d->atr_filtered_current = biquad_process(&d->atr_current_biquad, d->motor_current);
 		
 		// Get the IMU Values
 		d->roll_angle = RAD2DEG_f(VESC_IF->ahrs_get_roll(&d->m_att_ref));
@@ -1535,7 +1430,7 @@ static void tnt_thd(void *arg) {
 
 		//Apply low pass and Kalman filters to pitch
 		if (d->tnt_conf.pitch_filter > 0) {
-			d->pitch_smooth = biquad_process2(&d->pitch_biquad, d->pitch_angle);
+			d->pitch_smooth = biquad_process(&d->pitch_biquad, d->pitch_angle);
 		} else {d->pitch_smooth = d->pitch_angle;}
 		if (d->tnt_conf.kalman_factor1 > 0) {
 			apply_kalman(d);